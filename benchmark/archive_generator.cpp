@@ -0,0 +1,420 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "archive_generator.hpp"
+#include <fstream>
+#include <algorithm>
+#include <string_view>
+#include <array>
+#include <span>
+#include <cstdio>
+#include <zlib.h>
+#include <lz4frame.h>
+
+namespace pragma::gamemount::benchmark {
+	template<typename T>
+	static void write_value(std::vector<uint8_t> &out, const T &value)
+	{
+		auto *p = reinterpret_cast<const uint8_t *>(&value);
+		out.insert(out.end(), p, p + sizeof(value));
+	}
+	static void write_string(std::vector<uint8_t> &out, std::string_view str, bool nullTerminated)
+	{
+		out.insert(out.end(), str.begin(), str.end());
+		if(nullTerminated)
+			out.push_back('\0');
+	}
+	static bool write_file_data(std::ofstream &f, uint64_t fileIndex, const ArchiveLayout &layout, std::vector<uint8_t> &buffer)
+	{
+		buffer.resize(layout.fileSize);
+		for(uint32_t i = 0; i < layout.fileSize; ++i)
+			buffer[i] = get_file_byte(fileIndex, i, layout.seed);
+		f.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+		return f.good();
+	}
+	static std::string get_directory_name(const ArchiveLayout &layout, uint32_t directoryIndex) { return layout.rootDirectory + "/dir" + std::to_string(directoryIndex); }
+	static std::string get_file_name(uint32_t fileIndex, std::string_view ext) { return "file" + std::to_string(fileIndex) + "." + std::string {ext}; }
+
+	// Name hash used by the BSA format. The path has to be lowercase and use backslashes.
+	static uint64_t get_bsa_hash(std::string_view path, bool isFolder)
+	{
+		auto root = path;
+		std::string_view ext;
+		if(isFolder == false) {
+			auto dot = path.rfind('.');
+			if(dot != std::string_view::npos) {
+				root = path.substr(0, dot);
+				ext = path.substr(dot);
+			}
+		}
+		uint32_t hash1 = 0;
+		auto len = root.length();
+		if(len > 0)
+			hash1 = static_cast<uint8_t>(root[len - 1]) | ((len > 2 ? static_cast<uint8_t>(root[len - 2]) : 0u) << 8) | (static_cast<uint32_t>(len) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(root[0])) << 24);
+		if(ext == ".kf")
+			hash1 |= 0x80;
+		else if(ext == ".nif")
+			hash1 |= 0x8000;
+		else if(ext == ".dds")
+			hash1 |= 0x8080;
+		else if(ext == ".wav")
+			hash1 |= 0x80000000;
+		uint32_t hash2 = 0;
+		for(size_t i = 1; i + 2 < len; ++i)
+			hash2 = hash2 * 0x1003f + static_cast<uint8_t>(root[i]);
+		uint32_t hash3 = 0;
+		for(auto c : ext)
+			hash3 = hash3 * 0x1003f + static_cast<uint8_t>(c);
+		return (static_cast<uint64_t>(hash2 + hash3) << 32) | hash1;
+	}
+};
+
+uint8_t pragma::gamemount::benchmark::get_file_byte(uint64_t fileIndex, uint64_t offset, uint32_t seed) { return static_cast<uint8_t>(fileIndex * 31 + offset * 7 + (offset >> 8) + seed * 101); }
+
+std::vector<std::string> pragma::gamemount::benchmark::write_vpk(const std::string &directory, const std::string &name, const ArchiveLayout &layout)
+{
+	constexpr uint32_t SIGNATURE = 0x55aa1234;
+	constexpr uint64_t MAX_CHUNK_SIZE = 256 * 1024 * 1024;
+	// Entries are grouped by extension and directory
+	std::vector<uint8_t> tree;
+	std::vector<std::string> paths;
+	paths.reserve(layout.GetFileCount());
+	std::vector<uint64_t> chunkFileCounts {0};
+	uint64_t chunkOffset = 0;
+	write_string(tree, "bin", true);
+	for(uint32_t i = 0; i < layout.directoryCount; ++i) {
+		auto dirName = get_directory_name(layout, i);
+		write_string(tree, dirName, true);
+		for(uint32_t j = 0; j < layout.filesPerDirectory; ++j) {
+			if(chunkOffset > 0 && chunkOffset + layout.fileSize > MAX_CHUNK_SIZE) {
+				chunkFileCounts.push_back(0);
+				chunkOffset = 0;
+			}
+			write_string(tree, "file" + std::to_string(j), true);
+			write_value(tree, uint32_t {0}); // CRC
+			write_value(tree, uint16_t {0}); // Preload bytes
+			write_value(tree, static_cast<uint16_t>(chunkFileCounts.size() - 1));
+			write_value(tree, static_cast<uint32_t>(chunkOffset));
+			write_value(tree, layout.fileSize);
+			write_value(tree, uint16_t {0xffff});
+			chunkOffset += layout.fileSize;
+			++chunkFileCounts.back();
+			paths.push_back(dirName + "/" + get_file_name(j, "bin"));
+		}
+		tree.push_back('\0');
+	}
+	tree.push_back('\0');
+	tree.push_back('\0');
+
+	std::vector<uint8_t> header;
+	write_value(header, SIGNATURE);
+	write_value(header, uint32_t {1});
+	write_value(header, static_cast<uint32_t>(tree.size()));
+	std::ofstream dirFile {directory + "/" + name + "_dir.vpk", std::ios::binary};
+	dirFile.write(reinterpret_cast<const char *>(header.data()), header.size());
+	dirFile.write(reinterpret_cast<const char *>(tree.data()), tree.size());
+	if(dirFile.good() == false)
+		return {};
+
+	std::vector<uint8_t> buffer;
+	uint64_t fileIndex = 0;
+	for(auto chunkIdx = decltype(chunkFileCounts.size()) {0u}; chunkIdx < chunkFileCounts.size(); ++chunkIdx) {
+		std::array<char, 8> suffix;
+		snprintf(suffix.data(), suffix.size(), "_%03u", static_cast<uint32_t>(chunkIdx));
+		std::ofstream chunkFile {directory + "/" + name + suffix.data() + ".vpk", std::ios::binary};
+		for(uint64_t i = 0; i < chunkFileCounts[chunkIdx]; ++i) {
+			if(write_file_data(chunkFile, fileIndex++, layout, buffer) == false)
+				return {};
+		}
+	}
+	return paths;
+}
+
+std::vector<std::string> pragma::gamemount::benchmark::write_bsa(const std::string &path, const ArchiveLayout &layout, const BsaOptions &options)
+{
+	struct File {
+		std::string name;
+		uint64_t hash;
+		uint64_t index;
+	};
+	struct Folder {
+		std::string name;
+		uint64_t hash;
+		std::vector<File> files;
+	};
+	// Folders and files are sorted by their hash
+	std::vector<Folder> folders;
+	std::vector<std::string> paths(layout.GetFileCount());
+	for(uint32_t i = 0; i < layout.directoryCount; ++i) {
+		Folder folder {"meshes/" + get_directory_name(layout, i)};
+		for(uint32_t j = 0; j < layout.filesPerDirectory; ++j) {
+			File file {get_file_name(j, "nif")};
+			file.hash = get_bsa_hash(file.name, false);
+			file.index = static_cast<uint64_t>(i) * layout.filesPerDirectory + j;
+			paths[file.index] = folder.name + "/" + file.name;
+			folder.files.push_back(std::move(file));
+		}
+		std::replace(folder.name.begin(), folder.name.end(), '/', '\\');
+		folder.hash = get_bsa_hash(folder.name, true);
+		std::sort(folder.files.begin(), folder.files.end(), [](const File &a, const File &b) { return a.hash < b.hash; });
+		folders.push_back(std::move(folder));
+	}
+	std::sort(folders.begin(), folders.end(), [](const Folder &a, const Folder &b) { return a.hash < b.hash; });
+
+	uint32_t totalFolderNameLength = 0;
+	uint32_t totalFileNameLength = 0;
+	uint32_t fileCount = 0;
+	for(auto &folder : folders) {
+		if(options.includeNames) {
+			totalFolderNameLength += folder.name.length() + 1;
+			for(auto &file : folder.files)
+				totalFileNameLength += file.name.length() + 1;
+		}
+		fileCount += folder.files.size();
+	}
+	constexpr uint32_t headerSize = 36;
+	constexpr uint32_t FLAG_DIRECTORY_NAMES = 0x1;
+	constexpr uint32_t FLAG_FILE_NAMES = 0x2;
+	constexpr uint32_t FLAG_COMPRESSED = 0x4;
+	constexpr uint32_t SIZE_COMPRESSION_TOGGLE = 0x40000000;
+	auto folderRecordSize = (options.version == 105) ? 24u : 16u;
+	auto fileRecordOffset = headerSize + layout.directoryCount * folderRecordSize;
+	// Each folder name is prefixed by its length
+	auto folderNamesLength = options.includeNames ? (layout.directoryCount + totalFolderNameLength) : 0;
+	auto fileNameOffset = fileRecordOffset + folderNamesLength + fileCount * 16;
+	uint64_t dataOffset = fileNameOffset + totalFileNameLength;
+
+	// The data is written first, since the file records contain the sizes of the compressed entries
+	std::ofstream f {path, std::ios::binary};
+	f.seekp(dataOffset);
+	std::vector<std::pair<uint32_t, uint64_t>> fileRecords(fileCount); // Size field and offset, by file index
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> compressed;
+	for(auto &folder : folders) {
+		for(auto &file : folder.files) {
+			buffer.resize(layout.fileSize);
+			for(uint32_t i = 0; i < layout.fileSize; ++i)
+				buffer[i] = get_file_byte(file.index, i, layout.seed);
+			auto &record = fileRecords[file.index];
+			record.second = f.tellp();
+			// Some entries of compressed archives are stored uncompressed, which is marked by the toggle bit
+			if(options.compressed == false || file.index % 7 == 6) {
+				record.first = layout.fileSize | (options.compressed ? SIZE_COMPRESSION_TOGGLE : 0);
+				f.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+				continue;
+			}
+			// Compressed entries are prefixed by their uncompressed size
+			size_t compressedSize;
+			if(options.version == 105) {
+				compressed.resize(LZ4F_compressFrameBound(buffer.size(), nullptr));
+				compressedSize = LZ4F_compressFrame(compressed.data(), compressed.size(), buffer.data(), buffer.size(), nullptr);
+				if(LZ4F_isError(compressedSize))
+					return {};
+			}
+			else {
+				uLongf zlibSize = compressBound(buffer.size());
+				compressed.resize(zlibSize);
+				if(compress2(compressed.data(), &zlibSize, buffer.data(), buffer.size(), Z_BEST_SPEED) != Z_OK)
+					return {};
+				compressedSize = zlibSize;
+			}
+			record.first = static_cast<uint32_t>(sizeof(uint32_t) + compressedSize);
+			f.write(reinterpret_cast<const char *>(&layout.fileSize), sizeof(layout.fileSize));
+			f.write(reinterpret_cast<const char *>(compressed.data()), compressedSize);
+		}
+	}
+
+	std::vector<uint8_t> out;
+	write_string(out, "BSA", true);
+	write_value(out, options.version);
+	write_value(out, headerSize);
+	auto flags = (options.includeNames ? (FLAG_DIRECTORY_NAMES | FLAG_FILE_NAMES) : 0) | (options.compressed ? FLAG_COMPRESSED : 0);
+	write_value(out, flags);
+	write_value(out, layout.directoryCount);
+	write_value(out, fileCount);
+	write_value(out, totalFolderNameLength);
+	write_value(out, totalFileNameLength);
+	write_value(out, uint32_t {0});
+	// Folder offsets include the size of the file name block
+	auto folderOffset = fileRecordOffset;
+	for(auto &folder : folders) {
+		write_value(out, folder.hash);
+		write_value(out, static_cast<uint32_t>(folder.files.size()));
+		if(options.version == 105) {
+			write_value(out, uint32_t {0});
+			write_value(out, static_cast<uint64_t>(folderOffset + totalFileNameLength));
+		}
+		else
+			write_value(out, folderOffset + totalFileNameLength);
+		folderOffset += (options.includeNames ? (1 + folder.name.length() + 1) : 0) + folder.files.size() * 16;
+	}
+	for(auto &folder : folders) {
+		if(options.includeNames) {
+			out.push_back(static_cast<uint8_t>(folder.name.length() + 1));
+			write_string(out, folder.name, true);
+		}
+		for(auto &file : folder.files) {
+			auto &record = fileRecords[file.index];
+			write_value(out, file.hash);
+			write_value(out, record.first);
+			write_value(out, static_cast<uint32_t>(record.second));
+		}
+	}
+	if(options.includeNames) {
+		for(auto &folder : folders) {
+			for(auto &file : folder.files)
+				write_string(out, file.name, true);
+		}
+	}
+	f.seekp(0);
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+	if(f.good() == false)
+		return {};
+	return paths;
+}
+
+std::vector<std::string> pragma::gamemount::benchmark::write_ba2(const std::string &path, const ArchiveLayout &layout)
+{
+	constexpr size_t HEADER_SIZE = 24;
+	constexpr size_t RECORD_SIZE = 36;
+	auto fileCount = layout.GetFileCount();
+	std::vector<std::string> paths;
+	paths.reserve(fileCount);
+	for(uint32_t i = 0; i < layout.directoryCount; ++i) {
+		auto dirName = "meshes/" + get_directory_name(layout, i);
+		for(uint32_t j = 0; j < layout.filesPerDirectory; ++j)
+			paths.push_back(dirName + "/" + get_file_name(j, "nif"));
+	}
+	uint64_t dataOffset = HEADER_SIZE + fileCount * RECORD_SIZE;
+	auto nameTableOffset = dataOffset + fileCount * layout.fileSize;
+
+	std::vector<uint8_t> out;
+	write_string(out, "BTDX", false);
+	write_value(out, uint32_t {1});
+	write_string(out, "GNRL", false);
+	write_value(out, static_cast<uint32_t>(fileCount));
+	write_value(out, nameTableOffset);
+	for(uint64_t i = 0; i < fileCount; ++i) {
+		// The name and directory hashes are not used for lookups
+		write_value(out, uint32_t {0});
+		write_string(out, "nif", true);
+		write_value(out, uint32_t {0});
+		write_value(out, uint32_t {0x100100});
+		write_value(out, dataOffset + i * layout.fileSize);
+		write_value(out, uint32_t {0}); // Uncompressed
+		write_value(out, layout.fileSize);
+		write_value(out, uint32_t {0xbaadf00d});
+	}
+	std::ofstream f {path, std::ios::binary};
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+	std::vector<uint8_t> buffer;
+	for(uint64_t i = 0; i < fileCount; ++i) {
+		if(write_file_data(f, i, layout, buffer) == false)
+			return {};
+	}
+	out.clear();
+	for(auto &filePath : paths) {
+		auto name = filePath;
+		std::replace(name.begin(), name.end(), '/', '\\');
+		write_value(out, static_cast<uint16_t>(name.length()));
+		write_string(out, name, false);
+	}
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+	if(f.good() == false)
+		return {};
+	return paths;
+}
+
+std::vector<std::string> pragma::gamemount::benchmark::write_ba2_textures(const std::string &path, const ArchiveLayout &layout)
+{
+	constexpr size_t HEADER_SIZE = 24;
+	constexpr size_t RECORD_SIZE = 24;
+	constexpr size_t CHUNK_SIZE = 24;
+	constexpr uint8_t FORMAT_BC1 = 71; // Written with a legacy DDS header
+	constexpr uint8_t FORMAT_BC7 = 98; // Requires the DX10 header extension
+	auto fileCount = layout.GetFileCount();
+	std::vector<std::string> paths;
+	paths.reserve(fileCount);
+	for(uint32_t i = 0; i < layout.directoryCount; ++i) {
+		auto dirName = "textures/" + get_directory_name(layout, i);
+		for(uint32_t j = 0; j < layout.filesPerDirectory; ++j)
+			paths.push_back(dirName + "/" + get_file_name(j, "dds"));
+	}
+	// The file is split into up to three chunks of odd sizes, the middle one of which is stored uncompressed
+	std::vector<uint32_t> chunkSizes;
+	for(auto remaining = layout.fileSize; remaining > 0 && chunkSizes.size() < 3;) {
+		auto size = (chunkSizes.size() < 2) ? std::min<uint32_t>(remaining, (remaining / 2) | 1) : remaining;
+		chunkSizes.push_back(size);
+		remaining -= size;
+	}
+	uint64_t dataOffset = HEADER_SIZE + fileCount * (RECORD_SIZE + chunkSizes.size() * CHUNK_SIZE);
+
+	// The records are written once the offsets of the chunks are known
+	std::ofstream f {path, std::ios::binary};
+	f.seekp(dataOffset);
+	std::vector<uint8_t> records;
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> compressed;
+	for(uint64_t i = 0; i < fileCount; ++i) {
+		buffer.resize(layout.fileSize);
+		for(uint32_t j = 0; j < layout.fileSize; ++j)
+			buffer[j] = get_file_byte(i, j, layout.seed);
+		write_value(records, uint32_t {0}); // The name and directory hashes are not used for lookups
+		write_string(records, "dds", true);
+		write_value(records, uint32_t {0});
+		records.push_back(0);
+		records.push_back(static_cast<uint8_t>(chunkSizes.size()));
+		write_value(records, static_cast<uint16_t>(CHUNK_SIZE));
+		write_value(records, uint16_t {256}); // Height
+		write_value(records, uint16_t {256}); // Width
+		records.push_back(static_cast<uint8_t>(chunkSizes.size()));
+		records.push_back((i % 2 == 0) ? FORMAT_BC1 : FORMAT_BC7);
+		records.push_back(0); // Not a cubemap
+		records.push_back(8); // Tile mode
+		uint32_t chunkOffset = 0;
+		for(auto j = decltype(chunkSizes.size()) {0u}; j < chunkSizes.size(); ++j) {
+			auto size = chunkSizes[j];
+			std::span<const uint8_t> data {buffer.data() + chunkOffset, size};
+			uint32_t packedSize = 0;
+			if(j != 1) {
+				auto compressedSize = compressBound(size);
+				compressed.resize(compressedSize);
+				if(compress2(compressed.data(), &compressedSize, data.data(), size, Z_BEST_SPEED) != Z_OK)
+					return {};
+				data = {compressed.data(), compressedSize};
+				packedSize = static_cast<uint32_t>(compressedSize);
+			}
+			write_value(records, static_cast<uint64_t>(f.tellp()));
+			write_value(records, packedSize);
+			write_value(records, size);
+			write_value(records, static_cast<uint16_t>(j)); // First mip
+			write_value(records, static_cast<uint16_t>(j)); // Last mip
+			write_value(records, uint32_t {0xbaadf00d});
+			f.write(reinterpret_cast<const char *>(data.data()), data.size());
+			chunkOffset += size;
+		}
+	}
+	uint64_t nameTableOffset = f.tellp();
+	std::vector<uint8_t> out;
+	for(auto &filePath : paths) {
+		auto name = filePath;
+		std::replace(name.begin(), name.end(), '/', '\\');
+		write_value(out, static_cast<uint16_t>(name.length()));
+		write_string(out, name, false);
+	}
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+
+	out.clear();
+	write_string(out, "BTDX", false);
+	write_value(out, uint32_t {1});
+	write_string(out, "DX10", false);
+	write_value(out, static_cast<uint32_t>(fileCount));
+	write_value(out, nameTableOffset);
+	out.insert(out.end(), records.begin(), records.end());
+	f.seekp(0);
+	f.write(reinterpret_cast<const char *>(out.data()), out.size());
+	if(f.good() == false)
+		return {};
+	return paths;
+}
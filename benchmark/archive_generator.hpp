@@ -0,0 +1,50 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UTIL_ARCHIVE_BENCHMARK_ARCHIVE_GENERATOR_HPP__
+#define __UTIL_ARCHIVE_BENCHMARK_ARCHIVE_GENERATOR_HPP__
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+
+namespace pragma::gamemount::benchmark {
+	// Synthetic archives consist of directoryCount directories with filesPerDirectory files each, which all have the
+	// same size. The contents are derived from the index of the file and the seed, so they can be verified after
+	// reading. Archives with different seeds have different contents.
+	struct ArchiveLayout {
+		uint32_t directoryCount = 100;
+		uint32_t filesPerDirectory = 100;
+		uint32_t fileSize = 16 * 1024;
+		// Top-level directory of all files, which allows mounting several archives without overlapping paths
+		std::string rootDirectory = "synthetic";
+		uint32_t seed = 0;
+		uint64_t GetFileCount() const { return static_cast<uint64_t>(directoryCount) * filesPerDirectory; }
+	};
+	uint8_t get_file_byte(uint64_t fileIndex, uint64_t offset, uint32_t seed = 0);
+
+	// The writers return the paths of all files in the order of their index, relative to the game directory and
+	// separated by '/'. An empty vector is returned if the archive could not be written.
+
+	// Writes "<name>_dir.vpk" (version 1) into the directory. The file data is split into chunk archives
+	// ("<name>_000.vpk", ...) like in the archives shipped with games.
+	std::vector<std::string> write_vpk(const std::string &directory, const std::string &name, const ArchiveLayout &layout);
+	struct BsaOptions {
+		// 104 (Skyrim) or 105 (Skyrim Special Edition)
+		uint32_t version = 104;
+		// Entries are compressed with zlib in version 104 and as LZ4 frames in version 105. Every seventh entry is
+		// stored uncompressed regardless.
+		bool compressed = false;
+		// Archives without names can only be searched by the hashes of the paths
+		bool includeNames = true;
+	};
+	std::vector<std::string> write_bsa(const std::string &path, const ArchiveLayout &layout, const BsaOptions &options = {});
+	// Uncompressed version 1 general BA2
+	std::vector<std::string> write_ba2(const std::string &path, const ArchiveLayout &layout);
+	// Version 1 texture BA2 ("DX10"). The file data is the pixel data of each texture, split into chunks of odd sizes
+	// that are zlib-compressed or stored, and alternates between formats with and without a DX10 DDS header.
+	std::vector<std::string> write_ba2_textures(const std::string &path, const ArchiveLayout &layout);
+};
+
+#endif
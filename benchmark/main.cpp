@@ -0,0 +1,949 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+// Benchmark suite for util_archive. Synthetic archives are generated in a work directory, mounted as a game and
+// then used to measure mounting, lookups, find_files and reads. The results are printed and written as JSON.
+// Internals of the library, like the individual archive readers, are measured by the component benchmarks.
+//
+// Usage: util_archive_benchmark [options]
+//   --formats <list>      Comma-separated archive formats to benchmark: vpk, bsa, ba2 (default: all available)
+//   --directories <n>     Number of directories per archive (default: 100)
+//   --files <n>           Number of files per directory (default: 100)
+//   --file-size <bytes>   Size of each file (default: 16384)
+//   --lookups <n>         Number of lookups for each latency measurement (default: 100000)
+//   --min-time <seconds>  Minimum duration of each throughput measurement (default: 0.5)
+//   --batch-size <n>      Number of files per load_batch call (default: 1024)
+//   --mount-timeout <s>   Maximum time to wait for a game to be mounted (default: 600)
+//   --remount-cycles <n>  Number of times games are unmounted and mounted again while files are loaded (default: 10)
+//   --components <list>   Comma-separated component benchmarks to run, or "all" (default: none)
+//   --work-dir <path>     Directory for the generated archives (default: <temp>/util_archive_benchmark)
+//   --output <path>       Path of the JSON results (default: benchmark_results.json)
+//   --keep                Don't delete the generated archives afterwards
+
+#include "archive_generator.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <optional>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+
+
+import pragma.gamemount;
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	std::vector<std::string> formats;
+	pragma::gamemount::benchmark::ArchiveLayout layout {};
+	uint32_t lookupCount = 100'000;
+	uint32_t batchSize = 1024;
+	double minTime = 0.5;
+	double mountTimeout = 600.0;
+	uint32_t remountCycles = 10;
+	std::vector<std::string> components;
+	std::string workDir;
+	std::string outputPath = "benchmark_results.json";
+	bool keep = false;
+};
+
+struct LatencyStats {
+	double meanNs = 0.0;
+	double p50Ns = 0.0;
+	double p99Ns = 0.0;
+};
+
+struct ThroughputStats {
+	uint64_t operations = 0;
+	uint64_t bytes = 0;
+	double seconds = 0.0;
+	double GetOperationsPerSecond() const { return (seconds > 0.0) ? operations / seconds : 0.0; }
+	double GetBytesPerSecond() const { return (seconds > 0.0) ? bytes / seconds : 0.0; }
+};
+
+struct FindFilesStats {
+	std::string pattern;
+	uint64_t matches = 0;
+	ThroughputStats throughput;
+};
+
+struct FormatResult {
+	std::string format;
+	uint64_t fileCount = 0;
+	uint64_t archiveSize = 0;
+	double generateSeconds = 0.0;
+	double mountSeconds = 0.0;
+	LatencyStats lookupHit;
+	LatencyStats lookupMiss;
+	std::vector<FindFilesStats> findFiles;
+	ThroughputStats read;
+	ThroughputStats readPooled;
+	ThroughputStats readHeader;
+	// The same randomly ordered files, loaded with load_batch and with a loop of load calls
+	uint32_t batchSize = 0;
+	ThroughputStats loadLoop;
+	ThroughputStats loadBatch;
+	uint64_t verificationErrors = 0;
+	uint64_t peakRss = 0;
+};
+
+// Games that are mounted and unmounted while files are loaded from another game, which stays mounted. Two of the games
+// have a VPK with the same name, so only one of them is mounted at a time.
+struct RuntimeMountResult {
+	uint32_t cycles = 0;
+	double mountSeconds = 0.0;
+	double unmountSeconds = 0.0;
+	// Time until the VPK that was skipped as a duplicate can be found, after the game that provided it has been unmounted
+	double releasedArchiveSeconds = 0.0;
+	// Time to mount an additional directory of archives into the game that stays mounted
+	double hotAddSeconds = 0.0;
+	ThroughputStats loads;
+	uint64_t verificationErrors = 0;
+};
+
+// Textures of a BA2 archive, which are decompressed chunk by chunk when they're streamed. Every texture is read with
+// load_streamed in reads of odd sizes and with backward seeks, and compared against the result of load.
+struct TextureStreamingResult {
+	uint64_t fileCount = 0;
+	ThroughputStats load;
+	ThroughputStats loadStreamed;
+	uint64_t verificationErrors = 0;
+};
+
+static double to_seconds(Clock::duration dt) { return std::chrono::duration<double>(dt).count(); }
+
+// The peak resident set size is reset before each format, so the peak of a format doesn't include the formats
+// that were benchmarked before it
+static void reset_peak_rss()
+{
+#ifdef __linux__
+	std::ofstream f {"/proc/self/clear_refs"};
+	f << "5";
+#endif
+}
+// Peak resident set size of the process in bytes since the last reset, or 0 if it is unknown
+static uint64_t get_peak_rss()
+{
+#ifdef __linux__
+	std::ifstream f {"/proc/self/status"};
+	std::string line;
+	while(std::getline(f, line)) {
+		if(line.starts_with("VmHWM:"))
+			return std::stoull(line.substr(6)) * 1024; // Kilobytes
+	}
+#endif
+	return 0;
+}
+
+static LatencyStats get_latency_stats(std::vector<double> &samples)
+{
+	LatencyStats stats {};
+	if(samples.empty())
+		return stats;
+	std::sort(samples.begin(), samples.end());
+	stats.meanNs = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+	stats.p50Ns = samples[samples.size() / 2];
+	stats.p99Ns = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+	return stats;
+}
+
+// Runs the operation until the minimum time has passed. The operation returns the number of bytes it processed.
+static ThroughputStats measure_throughput(double minTime, const std::function<uint64_t(uint64_t iteration)> &op)
+{
+	ThroughputStats stats {};
+	auto t0 = Clock::now();
+	do {
+		stats.bytes += op(stats.operations++);
+		stats.seconds = to_seconds(Clock::now() - t0);
+	} while(stats.seconds < minTime);
+	return stats;
+}
+
+// Mounting happens in the background, the progress callback reports when it has finished
+struct MountWaiter {
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::string game;
+	std::optional<pragma::gamemount::GameMountState> finalState;
+};
+static MountWaiter g_mountWaiter;
+
+static std::optional<double> mount(const pragma::gamemount::GameMountInfo &mountInfo, double timeout)
+{
+	{
+		std::scoped_lock lock {g_mountWaiter.mutex};
+		g_mountWaiter.game = mountInfo.identifier;
+		g_mountWaiter.finalState = {};
+	}
+	auto t0 = Clock::now();
+	if(pragma::gamemount::mount_game(mountInfo) == false)
+		return {};
+	// The mount state is polled as well, so a lost callback fails the benchmark instead of blocking it
+	std::unique_lock lock {g_mountWaiter.mutex};
+	while(g_mountWaiter.finalState.has_value() == false) {
+		if(g_mountWaiter.condition.wait_for(lock, std::chrono::milliseconds {100}, []() { return g_mountWaiter.finalState.has_value(); }))
+			break;
+		auto state = pragma::gamemount::get_game_mount_state(mountInfo.identifier);
+		if(state == pragma::gamemount::GameMountState::Ready || state == pragma::gamemount::GameMountState::Failed) {
+			g_mountWaiter.finalState = state;
+			break;
+		}
+		if(to_seconds(Clock::now() - t0) > timeout) {
+			std::cerr << "Game '" << mountInfo.identifier << "' has not been mounted after " << timeout << " s!" << std::endl;
+			return {};
+		}
+	}
+	auto t1 = Clock::now();
+	if(*g_mountWaiter.finalState != pragma::gamemount::GameMountState::Ready)
+		return {};
+	return to_seconds(t1 - t0);
+}
+
+static std::optional<FormatResult> run_format(const Options &options, const std::string &format)
+{
+	namespace bm = pragma::gamemount::benchmark;
+	FormatResult result {};
+	result.format = format;
+	auto gameDir = std::filesystem::path {options.workDir} / format;
+	std::filesystem::remove_all(gameDir);
+	std::filesystem::create_directories(gameDir);
+
+	pragma::gamemount::GameMountInfo mountInfo {};
+	mountInfo.identifier = "benchmark_" + format;
+	mountInfo.absolutePath = gameDir.generic_string() + "/";
+	std::vector<std::string> paths;
+	auto t0 = Clock::now();
+	if(format == "vpk") {
+		paths = bm::write_vpk(gameDir.string(), "synthetic", options.layout);
+		auto *settings = static_cast<pragma::gamemount::SourceEngineSettings *>(mountInfo.SetEngine(pragma::gamemount::GameEngine::SourceEngine));
+		settings->vpkList["synthetic_dir.vpk"] = {};
+	}
+#ifdef ENABLE_BETHESDA_FORMATS
+	else if(format == "bsa") {
+		paths = bm::write_bsa((gameDir / "synthetic.bsa").string(), options.layout);
+		auto *settings = static_cast<pragma::gamemount::GamebryoSettings *>(mountInfo.SetEngine(pragma::gamemount::GameEngine::Gamebryo));
+		settings->bsaList["synthetic.bsa"] = {};
+	}
+	else if(format == "ba2") {
+		paths = bm::write_ba2((gameDir / "synthetic.ba2").string(), options.layout);
+		auto *settings = static_cast<pragma::gamemount::CreationEngineSettings *>(mountInfo.SetEngine(pragma::gamemount::GameEngine::CreationEngine));
+		settings->ba2List["synthetic.ba2"] = {};
+	}
+#endif
+	else {
+		std::cerr << "Unsupported format '" << format << "'!" << std::endl;
+		return {};
+	}
+	if(paths.empty()) {
+		std::cerr << "Failed to generate " << format << " archive in '" << gameDir.string() << "'!" << std::endl;
+		return {};
+	}
+	result.generateSeconds = to_seconds(Clock::now() - t0);
+	result.fileCount = paths.size();
+	for(auto &entry : std::filesystem::directory_iterator {gameDir})
+		result.archiveSize += entry.is_regular_file() ? entry.file_size() : 0;
+
+	reset_peak_rss();
+	auto mountTime = mount(mountInfo, options.mountTimeout);
+	if(mountTime.has_value() == false) {
+		std::cerr << "Failed to mount " << format << " archive!" << std::endl;
+		return {};
+	}
+	result.mountSeconds = *mountTime;
+
+	// Lookups in random order, so they aren't served from the same cache lines every time
+	std::mt19937_64 rng {42};
+	std::uniform_int_distribution<size_t> dist {0, paths.size() - 1};
+	std::vector<double> samples;
+	samples.reserve(options.lookupCount);
+	for(uint32_t i = 0; i < options.lookupCount; ++i) {
+		auto &path = paths[dist(rng)];
+		auto t = Clock::now();
+		auto found = pragma::gamemount::exists(path);
+		samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+		result.verificationErrors += found ? 0 : 1;
+	}
+	result.lookupHit = get_latency_stats(samples);
+	samples.clear();
+	for(uint32_t i = 0; i < options.lookupCount; ++i) {
+		auto path = paths[dist(rng)] + ".missing";
+		auto t = Clock::now();
+		auto found = pragma::gamemount::exists(path);
+		samples.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t).count());
+		result.verificationErrors += found ? 1 : 0;
+	}
+	result.lookupMiss = get_latency_stats(samples);
+
+	// A single directory, all directories and the entire tree
+	auto root = paths.front().substr(0, paths.front().find("/dir"));
+	for(auto &pattern : {root + "/dir0/*", root + "/*", root + "/**"}) {
+		FindFilesStats stats {};
+		stats.pattern = pattern;
+		stats.throughput = measure_throughput(options.minTime, [&pattern, &stats](uint64_t) -> uint64_t {
+			uint64_t matches = 0;
+			pragma::gamemount::find_files(pattern, [&matches](std::string_view, bool) { ++matches; });
+			stats.matches = matches;
+			return 0;
+		});
+		result.findFiles.push_back(std::move(stats));
+	}
+
+	// Every file is verified once, the remaining iterations only check the size
+	std::vector<uint8_t> data;
+	result.read = measure_throughput(options.minTime, [&](uint64_t i) -> uint64_t {
+		auto fileIdx = i % paths.size();
+		if(pragma::gamemount::load(paths[fileIdx], data) == false || data.size() != options.layout.fileSize) {
+			++result.verificationErrors;
+			return 0;
+		}
+		if(i < paths.size()) {
+			for(size_t j = 0; j < data.size(); ++j) {
+				if(data[j] != bm::get_file_byte(fileIdx, j)) {
+					++result.verificationErrors;
+					break;
+				}
+			}
+		}
+		return data.size();
+	});
+	result.readPooled = measure_throughput(options.minTime, [&](uint64_t i) -> uint64_t {
+		auto buffer = pragma::gamemount::load_pooled(paths[i % paths.size()]);
+		if(buffer == nullptr) {
+			++result.verificationErrors;
+			return 0;
+		}
+		return buffer->GetSize();
+	});
+	// Header scan of the first bytes of each file
+	std::array<uint8_t, 64> header;
+	result.readHeader = measure_throughput(options.minTime, [&](uint64_t i) -> uint64_t {
+		auto numRead = pragma::gamemount::read_range(paths[i % paths.size()], 0, header.data(), header.size());
+		if(numRead.has_value() == false) {
+			++result.verificationErrors;
+			return 0;
+		}
+		return *numRead;
+	});
+
+	// Files requested in random order, like the assets of a level. The contents are verified in the first iteration.
+	std::vector<std::string> batch;
+	std::vector<size_t> batchFileIndices;
+	batch.reserve(options.batchSize);
+	batchFileIndices.reserve(options.batchSize);
+	for(uint32_t i = 0; i < options.batchSize; ++i) {
+		batchFileIndices.push_back(dist(rng));
+		batch.push_back(paths[batchFileIndices.back()]);
+	}
+	auto verify = [&](size_t fileIdx, const std::vector<uint8_t> &fileData) {
+		if(fileData.size() != options.layout.fileSize) {
+			++result.verificationErrors;
+			return;
+		}
+		for(size_t j = 0; j < fileData.size(); ++j) {
+			if(fileData[j] != bm::get_file_byte(fileIdx, j)) {
+				++result.verificationErrors;
+				return;
+			}
+		}
+	};
+	result.batchSize = options.batchSize;
+	result.loadLoop = measure_throughput(options.minTime, [&](uint64_t iteration) -> uint64_t {
+		uint64_t size = 0;
+		for(size_t i = 0; i < batch.size(); ++i) {
+			if(pragma::gamemount::load(batch[i], data) == false) {
+				++result.verificationErrors;
+				continue;
+			}
+			if(iteration == 0)
+				verify(batchFileIndices[i], data);
+			size += data.size();
+		}
+		return size;
+	});
+	result.loadBatch = measure_throughput(options.minTime, [&](uint64_t iteration) -> uint64_t {
+		uint64_t size = 0;
+		auto batchData = pragma::gamemount::load_batch(batch);
+		for(size_t i = 0; i < batchData.size(); ++i) {
+			if(batchData[i] == nullptr) {
+				++result.verificationErrors;
+				continue;
+			}
+			if(iteration == 0)
+				verify(batchFileIndices[i], *batchData[i]);
+			size += batchData[i]->size();
+		}
+		if(batchData.size() != batch.size())
+			++result.verificationErrors;
+		return size;
+	});
+
+	result.peakRss = get_peak_rss();
+	pragma::gamemount::unmount_game(mountInfo.identifier);
+	if(options.keep == false)
+		std::filesystem::remove_all(gameDir);
+	return result;
+}
+
+static bool verify_file(const std::vector<uint8_t> &data, size_t fileIdx, uint32_t fileSize)
+{
+	if(data.size() != fileSize)
+		return false;
+	for(size_t j = 0; j < data.size(); ++j) {
+		if(data[j] != pragma::gamemount::benchmark::get_file_byte(fileIdx, j))
+			return false;
+	}
+	return true;
+}
+
+static std::optional<RuntimeMountResult> run_runtime_mounts(const Options &options)
+{
+	namespace bm = pragma::gamemount::benchmark;
+	RuntimeMountResult result {};
+	auto workDir = std::filesystem::path {options.workDir} / "runtime";
+	std::filesystem::remove_all(workDir);
+	auto layout = options.layout;
+	// Only the number of files matters for the mount times, not their size
+	layout.fileSize = std::min<uint32_t>(layout.fileSize, 1024);
+	auto createGame = [&](const std::string &identifier, const std::string &vpkName) -> std::optional<std::pair<pragma::gamemount::GameMountInfo, std::vector<std::string>>> {
+		auto gameDir = workDir / identifier;
+		std::filesystem::create_directories(gameDir);
+		auto gameLayout = layout;
+		gameLayout.rootDirectory = identifier;
+		auto paths = bm::write_vpk(gameDir.string(), vpkName, gameLayout);
+		if(paths.empty())
+			return {};
+		pragma::gamemount::GameMountInfo mountInfo {};
+		mountInfo.identifier = identifier;
+		mountInfo.absolutePath = gameDir.generic_string() + "/";
+		auto *settings = static_cast<pragma::gamemount::SourceEngineSettings *>(mountInfo.SetEngine(pragma::gamemount::GameEngine::SourceEngine));
+		settings->vpkList[vpkName + "_dir.vpk"] = {};
+		return std::pair {std::move(mountInfo), std::move(paths)};
+	};
+	auto base = createGame("runtime_base", "base");
+	std::array<std::optional<std::pair<pragma::gamemount::GameMountInfo, std::vector<std::string>>>, 2> games {createGame("runtime_first", "shared"), createGame("runtime_second", "shared")};
+	if(!base || !games[0] || !games[1]) {
+		std::cerr << "Failed to generate archives in '" << workDir.string() << "'!" << std::endl;
+		return {};
+	}
+	for(auto *game : {&*base, &*games[0], &*games[1]}) {
+		if(mount(game->first, options.mountTimeout).has_value() == false) {
+			std::cerr << "Failed to mount game '" << game->first.identifier << "'!" << std::endl;
+			return {};
+		}
+	}
+	// The VPK of the second game is skipped, since the first game has already mounted a VPK with the same name
+	auto isMounted = [](const std::vector<std::string> &paths) { return pragma::gamemount::exists(paths.front()); };
+	if(isMounted(games[0]->second) == false || isMounted(games[1]->second))
+		++result.verificationErrors;
+
+	// Files of the game that stays mounted are loaded and verified the whole time
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> loadCount = 0;
+	std::atomic<uint64_t> loadBytes = 0;
+	std::atomic<uint64_t> loadErrors = 0;
+	std::vector<std::thread> readers;
+	auto t0 = Clock::now();
+	for(uint32_t i = 0; i < 2; ++i) {
+		readers.push_back(std::thread {[&, i]() {
+			std::mt19937_64 rng {i};
+			std::uniform_int_distribution<size_t> dist {0, base->second.size() - 1};
+			std::vector<uint8_t> data;
+			while(stop == false) {
+				auto fileIdx = dist(rng);
+				if(pragma::gamemount::load(base->second[fileIdx], data) == false || verify_file(data, fileIdx, layout.fileSize) == false)
+					++loadErrors;
+				++loadCount;
+				loadBytes += data.size();
+			}
+		}});
+	}
+
+	// The game whose VPK has been mounted is unmounted, after which the VPK of the other game takes its place. The
+	// unmounted game is then mounted again, and its VPK is skipped.
+	auto waitUntilMounted = [&options](const std::vector<std::string> &paths) -> std::optional<double> {
+		auto t0 = Clock::now();
+		while(pragma::gamemount::exists(paths.front()) == false) {
+			if(to_seconds(Clock::now() - t0) > options.mountTimeout)
+				return {};
+			std::this_thread::sleep_for(std::chrono::microseconds {100});
+		}
+		return to_seconds(Clock::now() - t0);
+	};
+	for(uint32_t i = 0; i < options.remountCycles; ++i) {
+		auto &mountedGame = *games[i % 2];
+		auto &skippingGame = *games[(i + 1) % 2];
+		auto t = Clock::now();
+		if(pragma::gamemount::unmount_game(mountedGame.first.identifier) == false) {
+			++result.verificationErrors;
+			break;
+		}
+		result.unmountSeconds += to_seconds(Clock::now() - t);
+		auto releasedArchiveTime = waitUntilMounted(skippingGame.second);
+		if(releasedArchiveTime.has_value() == false) {
+			std::cerr << "The VPK of game '" << skippingGame.first.identifier << "' has not been mounted after game '" << mountedGame.first.identifier << "' was unmounted!" << std::endl;
+			++result.verificationErrors;
+			break;
+		}
+		result.releasedArchiveSeconds += *releasedArchiveTime;
+		auto mountTime = mount(mountedGame.first, options.mountTimeout);
+		if(mountTime.has_value() == false) {
+			++result.verificationErrors;
+			break;
+		}
+		result.mountSeconds += *mountTime;
+		if(isMounted(mountedGame.second))
+			++result.verificationErrors;
+		++result.cycles;
+	}
+
+	// An addon that has been added after the game was mounted
+	auto addonDir = workDir / "runtime_addon";
+	std::filesystem::create_directories(addonDir);
+	auto addonLayout = layout;
+	addonLayout.rootDirectory = "runtime_addon";
+	auto addonPaths = bm::write_vpk(addonDir.string(), "addon", addonLayout);
+	auto t = Clock::now();
+	if(addonPaths.empty() || pragma::gamemount::mount_game_archive(base->first.identifier, addonDir.generic_string() + "/") == false)
+		++result.verificationErrors;
+	else {
+		result.hotAddSeconds = to_seconds(Clock::now() - t);
+		std::vector<uint8_t> data;
+		if(pragma::gamemount::load(addonPaths.back(), data) == false || verify_file(data, addonPaths.size() - 1, layout.fileSize) == false)
+			++result.verificationErrors;
+	}
+
+	stop = true;
+	for(auto &reader : readers)
+		reader.join();
+	result.loads.operations = loadCount;
+	result.loads.bytes = loadBytes;
+	result.loads.seconds = to_seconds(Clock::now() - t0);
+	result.verificationErrors += loadErrors;
+	if(result.cycles > 0) {
+		result.mountSeconds /= result.cycles;
+		result.unmountSeconds /= result.cycles;
+		result.releasedArchiveSeconds /= result.cycles;
+	}
+	for(auto *game : {&*base, &*games[0], &*games[1]})
+		pragma::gamemount::unmount_game(game->first.identifier);
+	if(options.keep == false)
+		std::filesystem::remove_all(workDir);
+	return result;
+}
+
+#ifdef ENABLE_BETHESDA_FORMATS
+static std::optional<TextureStreamingResult> run_texture_streaming(const Options &options)
+{
+	namespace bm = pragma::gamemount::benchmark;
+	TextureStreamingResult result {};
+	auto gameDir = std::filesystem::path {options.workDir} / "ba2_textures";
+	std::filesystem::remove_all(gameDir);
+	std::filesystem::create_directories(gameDir);
+	auto paths = bm::write_ba2_textures((gameDir / "textures.ba2").string(), options.layout);
+	if(paths.empty()) {
+		std::cerr << "Failed to generate texture archive in '" << gameDir.string() << "'!" << std::endl;
+		return {};
+	}
+	result.fileCount = paths.size();
+	pragma::gamemount::GameMountInfo mountInfo {};
+	mountInfo.identifier = "benchmark_ba2_textures";
+	mountInfo.absolutePath = gameDir.generic_string() + "/";
+	auto *settings = static_cast<pragma::gamemount::CreationEngineSettings *>(mountInfo.SetEngine(pragma::gamemount::GameEngine::CreationEngine));
+	settings->ba2List["textures.ba2"] = {};
+	if(mount(mountInfo, options.mountTimeout).has_value() == false) {
+		std::cerr << "Failed to mount texture archive!" << std::endl;
+		return {};
+	}
+
+	// Read sizes that don't line up with the chunks or the DDS header
+	constexpr std::array<size_t, 5> readSizes {1, 7, 4093, 13, 65537};
+	auto readStreamed = [](const auto &f, size_t offset, size_t len, std::vector<uint8_t> &out) {
+		f->Seek(offset);
+		out.resize(len);
+		out.resize(f->Read(out.data(), len));
+	};
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> streamed;
+	std::vector<uint8_t> range;
+	std::vector<uint8_t> buffer(readSizes.back());
+	for(size_t fileIdx = 0; fileIdx < paths.size(); ++fileIdx) {
+		auto &path = paths[fileIdx];
+		// The pixel data follows a DDS header with or without the DX10 extension
+		if(pragma::gamemount::load(path, data) == false || data.size() < options.layout.fileSize + 128 || memcmp(data.data(), "DDS ", 4) != 0) {
+			++result.verificationErrors;
+			continue;
+		}
+		auto headerSize = data.size() - options.layout.fileSize;
+		if(headerSize != ((fileIdx % 2 == 0) ? 128 : 148)) {
+			++result.verificationErrors;
+			continue;
+		}
+		for(size_t j = 0; j < options.layout.fileSize; ++j) {
+			if(data[headerSize + j] != bm::get_file_byte(fileIdx, j)) {
+				++result.verificationErrors;
+				break;
+			}
+		}
+		auto stat = pragma::gamemount::stat_file(path);
+		if(stat.has_value() == false || stat->size != data.size())
+			++result.verificationErrors;
+
+		auto f = pragma::gamemount::load_streamed(path);
+		if(f == nullptr || f->GetSize() != data.size()) {
+			++result.verificationErrors;
+			continue;
+		}
+		streamed.clear();
+		for(size_t i = 0; streamed.size() < data.size(); ++i) {
+			auto numRead = f->Read(buffer.data(), std::min(readSizes[i % readSizes.size()], data.size() - streamed.size()));
+			if(numRead == 0)
+				break;
+			streamed.insert(streamed.end(), buffer.begin(), buffer.begin() + numRead);
+		}
+		if(streamed != data)
+			++result.verificationErrors;
+		// Backwards into the middle of a chunk, into the header and across the end of the header
+		for(auto [offset, len] : std::array<std::pair<size_t, size_t>, 4> {{{data.size() / 2, 4093}, {3, 1}, {headerSize - 5, 31}, {data.size() - 7, 7}}}) {
+			len = std::min(len, data.size() - offset);
+			readStreamed(f, offset, len, streamed);
+			if(streamed.size() != len || memcmp(streamed.data(), data.data() + offset, len) != 0)
+				++result.verificationErrors;
+			range.resize(len);
+			auto numRead = pragma::gamemount::read_range(path, offset, range.data(), len);
+			if(numRead != len || memcmp(range.data(), data.data() + offset, len) != 0)
+				++result.verificationErrors;
+		}
+	}
+
+	result.load = measure_throughput(options.minTime, [&](uint64_t i) -> uint64_t {
+		if(pragma::gamemount::load(paths[i % paths.size()], data) == false) {
+			++result.verificationErrors;
+			return 0;
+		}
+		return data.size();
+	});
+	buffer.resize(readSizes[2]);
+	result.loadStreamed = measure_throughput(options.minTime, [&](uint64_t i) -> uint64_t {
+		auto f = pragma::gamemount::load_streamed(paths[i % paths.size()]);
+		if(f == nullptr) {
+			++result.verificationErrors;
+			return 0;
+		}
+		uint64_t size = 0;
+		for(auto numRead = f->Read(buffer.data(), buffer.size()); numRead > 0; numRead = f->Read(buffer.data(), buffer.size()))
+			size += numRead;
+		return size;
+	});
+
+	pragma::gamemount::unmount_game(mountInfo.identifier);
+	if(options.keep == false)
+		std::filesystem::remove_all(gameDir);
+	return result;
+}
+#endif
+
+static void print_result(const FormatResult &result)
+{
+	auto toMiB = [](double bytes) { return bytes / (1024.0 * 1024.0); };
+	std::cout << "[" << result.format << "] " << result.fileCount << " files, " << toMiB(result.archiveSize) << " MiB" << std::endl;
+	std::cout << "  generate:      " << result.generateSeconds << " s" << std::endl;
+	std::cout << "  mount:         " << result.mountSeconds << " s" << std::endl;
+	std::cout << "  lookup (hit):  " << result.lookupHit.meanNs << " ns mean, " << result.lookupHit.p50Ns << " ns p50, " << result.lookupHit.p99Ns << " ns p99" << std::endl;
+	std::cout << "  lookup (miss): " << result.lookupMiss.meanNs << " ns mean, " << result.lookupMiss.p50Ns << " ns p50, " << result.lookupMiss.p99Ns << " ns p99" << std::endl;
+	for(auto &stats : result.findFiles)
+		std::cout << "  find_files(\"" << stats.pattern << "\"): " << stats.throughput.GetOperationsPerSecond() << " calls/s, " << (stats.throughput.GetOperationsPerSecond() * stats.matches) << " entries/s" << std::endl;
+	std::cout << "  load:          " << toMiB(result.read.GetBytesPerSecond()) << " MiB/s, " << result.read.GetOperationsPerSecond() << " files/s" << std::endl;
+	std::cout << "  load_pooled:   " << toMiB(result.readPooled.GetBytesPerSecond()) << " MiB/s, " << result.readPooled.GetOperationsPerSecond() << " files/s" << std::endl;
+	std::cout << "  read_range:    " << result.readHeader.GetOperationsPerSecond() << " headers/s" << std::endl;
+	std::cout << "  load (loop):   " << toMiB(result.loadLoop.GetBytesPerSecond()) << " MiB/s, " << (result.loadLoop.GetOperationsPerSecond() * result.batchSize) << " files/s" << std::endl;
+	std::cout << "  load_batch:    " << toMiB(result.loadBatch.GetBytesPerSecond()) << " MiB/s, " << (result.loadBatch.GetOperationsPerSecond() * result.batchSize) << " files/s (" << result.batchSize << " files per batch)" << std::endl;
+	std::cout << "  peak RSS:      " << toMiB(result.peakRss) << " MiB" << std::endl;
+	if(result.verificationErrors > 0)
+		std::cout << "  " << result.verificationErrors << " verification errors!" << std::endl;
+}
+
+static void print_result(const RuntimeMountResult &result)
+{
+	std::cout << "[runtime mounting] " << result.cycles << " cycles" << std::endl;
+	std::cout << "  mount:          " << result.mountSeconds << " s" << std::endl;
+	std::cout << "  unmount:        " << result.unmountSeconds << " s" << std::endl;
+	std::cout << "  released VPK:   " << result.releasedArchiveSeconds << " s until mounted" << std::endl;
+	std::cout << "  hot-add:        " << result.hotAddSeconds << " s" << std::endl;
+	std::cout << "  load meanwhile: " << result.loads.GetOperationsPerSecond() << " files/s" << std::endl;
+	if(result.verificationErrors > 0)
+		std::cout << "  " << result.verificationErrors << " verification errors!" << std::endl;
+}
+
+static void print_result(const TextureStreamingResult &result)
+{
+	auto toMiB = [](double bytes) { return bytes / (1024.0 * 1024.0); };
+	std::cout << "[ba2 textures] " << result.fileCount << " files" << std::endl;
+	std::cout << "  load:          " << toMiB(result.load.GetBytesPerSecond()) << " MiB/s, " << result.load.GetOperationsPerSecond() << " files/s" << std::endl;
+	std::cout << "  load_streamed: " << toMiB(result.loadStreamed.GetBytesPerSecond()) << " MiB/s, " << result.loadStreamed.GetOperationsPerSecond() << " files/s" << std::endl;
+	if(result.verificationErrors > 0)
+		std::cout << "  " << result.verificationErrors << " verification errors!" << std::endl;
+}
+
+static void print_result(const pragma::gamemount::benchmark::ComponentResult &result)
+{
+	std::cout << "[component " << result.name << "]" << std::endl;
+	for(auto &metric : result.metrics)
+		std::cout << "  " << metric.name << ": " << metric.value << " " << metric.unit << std::endl;
+	for(auto &note : result.notes)
+		std::cout << "  " << note << std::endl;
+	if(result.verificationErrors > 0)
+		std::cout << "  " << result.verificationErrors << " verification errors!" << std::endl;
+}
+
+static std::string to_json_string(std::string_view str)
+{
+	std::string out = "\"";
+	for(auto c : str) {
+		if(c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+static void write_json(std::ostream &out, const LatencyStats &stats) { out << "{\"mean_ns\": " << stats.meanNs << ", \"p50_ns\": " << stats.p50Ns << ", \"p99_ns\": " << stats.p99Ns << "}"; }
+static void write_json(std::ostream &out, const ThroughputStats &stats)
+{
+	out << "{\"operations\": " << stats.operations << ", \"bytes\": " << stats.bytes << ", \"seconds\": " << stats.seconds << ", \"operations_per_second\": " << stats.GetOperationsPerSecond()
+	    << ", \"bytes_per_second\": " << stats.GetBytesPerSecond() << "}";
+}
+static bool write_results(const Options &options, const std::vector<FormatResult> &results, const std::optional<RuntimeMountResult> &runtimeMountResult, const std::optional<TextureStreamingResult> &textureStreamingResult,
+  const std::vector<pragma::gamemount::benchmark::ComponentResult> &componentResults)
+{
+	std::ofstream out {options.outputPath};
+	if(out.good() == false)
+		return false;
+	auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	out << "{\n";
+	out << "  \"timestamp\": " << timestamp << ",\n";
+	out << "  \"config\": {\"directories\": " << options.layout.directoryCount << ", \"files_per_directory\": " << options.layout.filesPerDirectory << ", \"file_size\": " << options.layout.fileSize
+	    << ", \"lookups\": " << options.lookupCount << ", \"batch_size\": " << options.batchSize << ", \"min_time\": " << options.minTime << "},\n";
+	out << "  \"results\": [";
+	for(auto i = decltype(results.size()) {0u}; i < results.size(); ++i) {
+		auto &result = results[i];
+		out << (i > 0 ? ",\n" : "\n") << "    {\n";
+		out << "      \"format\": " << to_json_string(result.format) << ",\n";
+		out << "      \"file_count\": " << result.fileCount << ",\n";
+		out << "      \"archive_size\": " << result.archiveSize << ",\n";
+		out << "      \"generate_seconds\": " << result.generateSeconds << ",\n";
+		out << "      \"mount_seconds\": " << result.mountSeconds << ",\n";
+		out << "      \"lookup_hit\": ";
+		write_json(out, result.lookupHit);
+		out << ",\n      \"lookup_miss\": ";
+		write_json(out, result.lookupMiss);
+		out << ",\n      \"find_files\": [";
+		for(auto j = decltype(result.findFiles.size()) {0u}; j < result.findFiles.size(); ++j) {
+			auto &stats = result.findFiles[j];
+			out << (j > 0 ? ", " : "") << "{\"pattern\": " << to_json_string(stats.pattern) << ", \"matches\": " << stats.matches << ", \"throughput\": ";
+			write_json(out, stats.throughput);
+			out << "}";
+		}
+		out << "],\n      \"load\": ";
+		write_json(out, result.read);
+		out << ",\n      \"load_pooled\": ";
+		write_json(out, result.readPooled);
+		out << ",\n      \"read_range_header\": ";
+		write_json(out, result.readHeader);
+		out << ",\n      \"batch\": {\"size\": " << result.batchSize << ", \"loop\": ";
+		write_json(out, result.loadLoop);
+		out << ", \"load_batch\": ";
+		write_json(out, result.loadBatch);
+		out << "},\n      \"verification_errors\": " << result.verificationErrors << ",\n";
+		out << "      \"peak_rss_bytes\": " << result.peakRss << "\n";
+		out << "    }";
+	}
+	out << "\n  ]";
+	if(runtimeMountResult.has_value()) {
+		auto &result = *runtimeMountResult;
+		out << ",\n  \"runtime_mounting\": {\"cycles\": " << result.cycles << ", \"mount_seconds\": " << result.mountSeconds << ", \"unmount_seconds\": " << result.unmountSeconds
+		    << ", \"released_archive_seconds\": " << result.releasedArchiveSeconds << ", \"hot_add_seconds\": " << result.hotAddSeconds << ", \"loads\": ";
+		write_json(out, result.loads);
+		out << ", \"verification_errors\": " << result.verificationErrors << "}";
+	}
+	if(textureStreamingResult.has_value()) {
+		auto &result = *textureStreamingResult;
+		out << ",\n  \"texture_streaming\": {\"file_count\": " << result.fileCount << ", \"load\": ";
+		write_json(out, result.load);
+		out << ", \"load_streamed\": ";
+		write_json(out, result.loadStreamed);
+		out << ", \"verification_errors\": " << result.verificationErrors << "}";
+	}
+	if(componentResults.empty() == false) {
+		out << ",\n  \"components\": [";
+		for(auto i = decltype(componentResults.size()) {0u}; i < componentResults.size(); ++i) {
+			auto &result = componentResults[i];
+			out << (i > 0 ? ",\n" : "\n") << "    {\"name\": " << to_json_string(result.name) << ", \"metrics\": [";
+			for(auto j = decltype(result.metrics.size()) {0u}; j < result.metrics.size(); ++j) {
+				auto &metric = result.metrics[j];
+				out << (j > 0 ? ", " : "") << "{\"name\": " << to_json_string(metric.name) << ", \"value\": " << metric.value << ", \"unit\": " << to_json_string(metric.unit) << "}";
+			}
+			out << "], \"notes\": [";
+			for(auto j = decltype(result.notes.size()) {0u}; j < result.notes.size(); ++j)
+				out << (j > 0 ? ", " : "") << to_json_string(result.notes[j]);
+			out << "], \"verification_errors\": " << result.verificationErrors << "}";
+		}
+		out << "\n  ]";
+	}
+	out << "\n}\n";
+	return out.good();
+}
+
+static bool parse_options(int argc, char *argv[], Options &options)
+{
+	options.workDir = (std::filesystem::temp_directory_path() / "util_archive_benchmark").string();
+	for(int i = 1; i < argc; ++i) {
+		std::string_view arg {argv[i]};
+		if(arg == "--keep") {
+			options.keep = true;
+			continue;
+		}
+		if(i + 1 >= argc) {
+			std::cerr << "Missing value for option '" << arg << "'!" << std::endl;
+			return false;
+		}
+		std::string value {argv[++i]};
+		if(arg == "--formats") {
+			options.formats.clear();
+			std::stringstream ss {value};
+			std::string format;
+			while(std::getline(ss, format, ','))
+				options.formats.push_back(format);
+		}
+		else if(arg == "--directories")
+			options.layout.directoryCount = std::stoul(value);
+		else if(arg == "--files")
+			options.layout.filesPerDirectory = std::stoul(value);
+		else if(arg == "--file-size")
+			options.layout.fileSize = std::stoul(value);
+		else if(arg == "--lookups")
+			options.lookupCount = std::stoul(value);
+		else if(arg == "--batch-size")
+			options.batchSize = std::stoul(value);
+		else if(arg == "--min-time")
+			options.minTime = std::stod(value);
+		else if(arg == "--mount-timeout")
+			options.mountTimeout = std::stod(value);
+		else if(arg == "--remount-cycles")
+			options.remountCycles = std::stoul(value);
+		else if(arg == "--components") {
+			options.components.clear();
+			std::stringstream ss {value};
+			std::string component;
+			while(std::getline(ss, component, ',')) {
+				if(component == "all")
+					options.components = pragma::gamemount::benchmark::get_component_benchmarks();
+				else
+					options.components.push_back(component);
+			}
+		}
+		else if(arg == "--work-dir")
+			options.workDir = value;
+		else if(arg == "--output")
+			options.outputPath = value;
+		else {
+			std::cerr << "Unknown option '" << arg << "'!" << std::endl;
+			return false;
+		}
+	}
+	if(options.layout.directoryCount == 0 || options.layout.filesPerDirectory == 0) {
+		std::cerr << "The archives need at least one directory and one file!" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	Options options {};
+#ifdef ENABLE_BETHESDA_FORMATS
+	options.formats = {"vpk", "bsa", "ba2"};
+#else
+	options.formats = {"vpk"};
+#endif
+	if(parse_options(argc, argv, options) == false)
+		return EXIT_FAILURE;
+
+	pragma::gamemount::set_mount_progress_callback([](const std::string &game, pragma::gamemount::GameMountState state, float) {
+		if(state != pragma::gamemount::GameMountState::Ready && state != pragma::gamemount::GameMountState::Failed)
+			return;
+		{
+			std::scoped_lock lock {g_mountWaiter.mutex};
+			if(game != g_mountWaiter.game)
+				return;
+			g_mountWaiter.finalState = state;
+		}
+		g_mountWaiter.condition.notify_all();
+	});
+	pragma::gamemount::initialize();
+
+	std::vector<FormatResult> results;
+	auto success = true;
+	for(auto &format : options.formats) {
+		auto result = run_format(options, format);
+		if(result.has_value() == false) {
+			success = false;
+			continue;
+		}
+		print_result(*result);
+		success = success && (result->verificationErrors == 0);
+		results.push_back(std::move(*result));
+	}
+	// VPK archives are the only ones that are deduplicated across games
+	std::optional<RuntimeMountResult> runtimeMountResult;
+	if(options.remountCycles > 0 && std::find(options.formats.begin(), options.formats.end(), "vpk") != options.formats.end()) {
+		runtimeMountResult = run_runtime_mounts(options);
+		if(runtimeMountResult.has_value())
+			print_result(*runtimeMountResult);
+		success = success && runtimeMountResult.has_value() && (runtimeMountResult->verificationErrors == 0);
+	}
+	std::optional<TextureStreamingResult> textureStreamingResult;
+#ifdef ENABLE_BETHESDA_FORMATS
+	if(std::find(options.formats.begin(), options.formats.end(), "ba2") != options.formats.end()) {
+		textureStreamingResult = run_texture_streaming(options);
+		if(textureStreamingResult.has_value())
+			print_result(*textureStreamingResult);
+		success = success && textureStreamingResult.has_value() && (textureStreamingResult->verificationErrors == 0);
+	}
+#endif
+	// The components run while the library is initialized, since some of them need HLLib
+	std::vector<pragma::gamemount::benchmark::ComponentResult> componentResults;
+	for(auto &component : options.components) {
+		auto result = pragma::gamemount::benchmark::run_component_benchmark(component, (std::filesystem::path {options.workDir} / "components").string());
+		if(result.has_value() == false) {
+			std::cerr << "Component benchmark '" << component << "' is unknown or could not be set up!" << std::endl;
+			success = false;
+			continue;
+		}
+		print_result(*result);
+		success = success && (result->verificationErrors == 0);
+		componentResults.push_back(std::move(*result));
+	}
+	pragma::gamemount::close();
+	if(write_results(options, results, runtimeMountResult, textureStreamingResult, componentResults) == false) {
+		std::cerr << "Failed to write results to '" << options.outputPath << "'!" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Results written to '" << options.outputPath << "'" << std::endl;
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
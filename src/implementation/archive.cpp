@@ -19,14 +19,18 @@ module;
 #include <unordered_set>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <filesystem>
+#include <condition_variable>
+#include <shared_mutex>
+#include <future>
+#include <cstring>
 
 #ifdef __linux__
 #include <cstdlib>
 #endif
 
 #ifdef ENABLE_BETHESDA_FORMATS
-#include <libbsa/libbsa.h>
-#include <bsa_asset.h>
 #include <BA2.h>
 #endif
 
@@ -41,20 +45,422 @@ module pragma.gamemount;
 import :info;
 import :archive;
 import :archivedata;
+import :pathindex;
+import :vpkarchive;
+import :bsaarchive;
+import :mappedfile;
+import :archivefile;
+import :entrycache;
+import :bloomfilter;
+import :indexcache;
+import :iopool;
+import :pathnormalizer;
+import :globpattern;
+import :directoryindex;
+import :bufferpool;
+import :decompressstream;
+import :benchmark;
 
 static util::LogHandler g_logHandler;
 static util::LogSeverity g_logSeverity = util::LogSeverity::Info;
 static std::vector<util::Path> g_steamRootPaths;
+static pragma::gamemount::EntryCache g_entryCache;
+static pragma::gamemount::IndexCache g_indexCache;
+// Buffers keep the pool alive, so they may outlive this reference
+static std::shared_ptr<pragma::gamemount::BufferPool> g_bufferPool = std::make_shared<pragma::gamemount::BufferPool>();
+static pragma::gamemount::MountProgressCallback g_mountProgressCallback;
 
 void pragma::gamemount::set_log_handler(const util::LogHandler &loghandler) { g_logHandler = loghandler; }
+void pragma::gamemount::set_mount_progress_callback(const MountProgressCallback &callback) { g_mountProgressCallback = callback; }
 void pragma::gamemount::set_log_severity(util::LogSeverity severity) { g_logSeverity = severity; }
 static bool should_log(util::LogSeverity severity) { return g_logHandler != nullptr && (umath::to_integral(severity) >= umath::to_integral(g_logSeverity)); }
 static void log(const std::string &msg, util::LogSeverity severity)
 {
 	if(!should_log(severity))
 		return;
+	// Messages may be emitted by multiple mount workers at once
+	static std::mutex logMutex;
+	std::scoped_lock lock {logMutex};
 	g_logHandler(msg, severity);
 }
+static void report_mount_progress(const std::string &identifier, pragma::gamemount::GameMountState state, float progress)
+{
+	if(g_mountProgressCallback == nullptr)
+		return;
+	// Progress is reported by multiple mount workers at once
+	static std::mutex progressMutex;
+	std::scoped_lock lock {progressMutex};
+	g_mountProgressCallback(identifier, state, progress);
+}
+
+// Returns true for the numbered data files of multi-part VPK archives, e.g. 'pak01_000.vpk'. A file only counts as a
+// data file if the matching directory file (e.g. 'pak01_dir.vpk') is among the files of the same directory, otherwise
+// it may be a standalone archive that just happens to end with a number.
+static bool is_vpk_data_file(std::string_view fileName, const std::vector<std::string> &siblingFiles)
+{
+	constexpr std::string_view ext = ".vpk";
+	if(fileName.length() < ext.length() + 4 || ustring::compare<std::string_view>(fileName.substr(fileName.length() - ext.length()), ext, false) == false)
+		return false;
+	auto suffix = fileName.substr(fileName.length() - ext.length() - 4, 4);
+	if(suffix[0] != '_' || std::all_of(suffix.begin() + 1, suffix.end(), [](char c) { return c >= '0' && c <= '9'; }) == false)
+		return false;
+	constexpr std::string_view dirSuffix = "_dir.vpk";
+	auto stem = fileName.substr(0, fileName.length() - ext.length() - 4);
+	return std::any_of(siblingFiles.begin(), siblingFiles.end(), [&stem, &dirSuffix](const std::string &f) {
+		std::string_view sibling {f};
+		return sibling.length() == stem.length() + dirSuffix.length() && ustring::compare<std::string_view>(sibling.substr(0, stem.length()), stem, false) && ustring::compare<std::string_view>(sibling.substr(stem.length()), dirSuffix, false);
+	});
+}
+
+#ifdef ENABLE_BETHESDA_FORMATS
+namespace pragma::gamemount {
+	// The name table of a BA2 archive can only be searched linearly, so a case-folded index of it is built when the
+	// archive is opened
+	struct Ba2Archive {
+		BA2 archive;
+		std::unordered_map<std::string, uint32_t, PathHash, PathEqual> nameIndex;
+		void BuildNameIndex()
+		{
+			nameIndex.clear();
+			nameIndex.reserve(archive.nameTable.size());
+			for(auto i = decltype(archive.nameTable.size()) {0u}; i < archive.nameTable.size(); ++i)
+				nameIndex.emplace(NormalizedPath {archive.nameTable[i], PathConvention::Gamebryo}.GetString(), static_cast<uint32_t>(i));
+		}
+		std::optional<uint32_t> FindEntry(const NormalizedPath &path) const
+		{
+			auto it = nameIndex.find(path);
+			if(it == nameIndex.end())
+				return {};
+			return it->second;
+		}
+
+		// The file records are read directly, so entries can be inspected and uncompressed entries read without
+		// extracting them. Texture entries are split into chunks of mip levels, which are compressed separately.
+		struct Chunk {
+			uint64_t offset = 0;
+			// 0 if the chunk is stored uncompressed
+			uint32_t packedSize = 0;
+			uint32_t size = 0;
+		};
+		struct Record {
+			// General entries consist of a single chunk
+			uint32_t firstChunk = 0;
+			uint32_t chunkCount = 0;
+			// Decoded size, including the DDS header of textures
+			uint64_t size = 0;
+			uint64_t storedSize = 0;
+			bool compressed = false;
+			// Only set for textures, which are stored without a DDS header
+			bool texture = false;
+			bool cubemap = false;
+			uint8_t mipCount = 0;
+			uint8_t format = 0;
+			uint16_t width = 0;
+			uint16_t height = 0;
+		};
+		std::unique_ptr<MappedFile> file;
+		std::vector<Record> records;
+		std::vector<Chunk> chunks;
+		// Version 3 archives may use LZ4 blocks instead of zlib, which can't be decompressed incrementally
+		bool lz4Compression = false;
+		void LoadRecords(const std::string &path)
+		{
+			constexpr uint32_t SIGNATURE = 0x58445442;    // "BTDX"
+			constexpr uint32_t TYPE_GENERAL = 0x4c524e47; // "GNRL"
+			constexpr uint32_t TYPE_TEXTURE = 0x30315844; // "DX10"
+			constexpr size_t GENERAL_RECORD_SIZE = 36;
+			constexpr size_t TEXTURE_RECORD_SIZE = 24;
+			constexpr size_t TEXTURE_CHUNK_SIZE = 24;
+			records.clear();
+			chunks.clear();
+			file = MappedFile::Open(path);
+			if(file == nullptr || file->GetSize() < 24)
+				return;
+			auto *data = file->GetData();
+			auto readU32 = [data](size_t offset) {
+				uint32_t value;
+				memcpy(&value, data + offset, sizeof(value));
+				return value;
+			};
+			auto readU16 = [data](size_t offset) {
+				uint16_t value;
+				memcpy(&value, data + offset, sizeof(value));
+				return value;
+			};
+			auto type = readU32(8);
+			if(readU32(0) != SIGNATURE || (type != TYPE_GENERAL && type != TYPE_TEXTURE))
+				return;
+			// Version 2 and 3 archives have additional header fields
+			size_t headerSize;
+			switch(readU32(4)) {
+			case 1:
+			case 7:
+			case 8:
+				headerSize = 24;
+				break;
+			case 2:
+				headerSize = 32;
+				break;
+			case 3:
+				headerSize = 36;
+				lz4Compression = (readU32(32) == 3);
+				break;
+			default:
+				return;
+			}
+			auto fileCount = readU32(12);
+			if(fileCount != archive.nameTable.size())
+				return;
+			// The header of extracted LZ4 textures is created by BA2, so their size is only known once they have been extracted
+			if(type == TYPE_TEXTURE && lz4Compression)
+				return;
+			auto isChunkValid = [this](const Chunk &chunk) { return chunk.offset + ((chunk.packedSize != 0) ? chunk.packedSize : chunk.size) <= file->GetSize(); };
+			records.resize(fileCount);
+			if(type == TYPE_GENERAL) {
+				if(headerSize + static_cast<uint64_t>(fileCount) * GENERAL_RECORD_SIZE > file->GetSize()) {
+					records.clear();
+					return;
+				}
+				chunks.resize(fileCount);
+				for(auto i = decltype(fileCount) {0u}; i < fileCount; ++i) {
+					auto recordOffset = headerSize + i * GENERAL_RECORD_SIZE;
+					auto &chunk = chunks[i];
+					memcpy(&chunk.offset, data + recordOffset + 16, sizeof(chunk.offset));
+					chunk.packedSize = readU32(recordOffset + 24);
+					chunk.size = readU32(recordOffset + 28);
+					if(isChunkValid(chunk) == false) {
+						records.clear();
+						chunks.clear();
+						return;
+					}
+					auto &record = records[i];
+					record.firstChunk = i;
+					record.chunkCount = 1;
+					record.size = chunk.size;
+					record.compressed = (chunk.packedSize != 0);
+					record.storedSize = record.compressed ? chunk.packedSize : chunk.size;
+				}
+				return;
+			}
+			// Each texture record is followed by the records of its chunks
+			size_t recordOffset = headerSize;
+			for(auto i = decltype(fileCount) {0u}; i < fileCount; ++i) {
+				if(recordOffset + TEXTURE_RECORD_SIZE > file->GetSize()) {
+					records.clear();
+					chunks.clear();
+					return;
+				}
+				auto &record = records[i];
+				auto chunkCount = data[recordOffset + 13];
+				auto chunkRecordSize = readU16(recordOffset + 14);
+				record.texture = true;
+				record.height = readU16(recordOffset + 16);
+				record.width = readU16(recordOffset + 18);
+				record.mipCount = data[recordOffset + 20];
+				record.format = data[recordOffset + 21];
+				// Followed by the tile mode, which is only relevant for console archives
+				record.cubemap = (data[recordOffset + 22] != 0);
+				record.firstChunk = static_cast<uint32_t>(chunks.size());
+				record.chunkCount = chunkCount;
+				record.size = get_dds_header(record).size();
+				recordOffset += TEXTURE_RECORD_SIZE;
+				if(chunkRecordSize != TEXTURE_CHUNK_SIZE || recordOffset + static_cast<uint64_t>(chunkCount) * TEXTURE_CHUNK_SIZE > file->GetSize()) {
+					records.clear();
+					chunks.clear();
+					return;
+				}
+				for(auto j = decltype(chunkCount) {0u}; j < chunkCount; ++j) {
+					Chunk chunk {};
+					memcpy(&chunk.offset, data + recordOffset, sizeof(chunk.offset));
+					chunk.packedSize = readU32(recordOffset + 8);
+					chunk.size = readU32(recordOffset + 12);
+					recordOffset += TEXTURE_CHUNK_SIZE;
+					if(isChunkValid(chunk) == false) {
+						records.clear();
+						chunks.clear();
+						return;
+					}
+					record.size += chunk.size;
+					record.compressed = record.compressed || (chunk.packedSize != 0);
+					record.storedSize += (chunk.packedSize != 0) ? chunk.packedSize : chunk.size;
+					chunks.push_back(chunk);
+				}
+			}
+		}
+		const Record *GetRecord(uint32_t entryIdx) const { return (entryIdx < records.size()) ? &records[entryIdx] : nullptr; }
+		// Returns the data of a general entry that is stored uncompressed, or nullptr for any other entry
+		const uint8_t *GetStoredData(const Record &record) const
+		{
+			if(record.texture || record.compressed)
+				return nullptr;
+			return file->GetData() + chunks[record.firstChunk].offset;
+		}
+		// Incremental decoder for a compressed general entry or a texture, which decodes one chunk at a time. Returns
+		// nullptr if the entry is stored uncompressed or can only be extracted in full.
+		std::unique_ptr<SegmentedStream> OpenStream(uint32_t entryIdx) const
+		{
+			auto *record = GetRecord(entryIdx);
+			if(record == nullptr || lz4Compression || GetStoredData(*record))
+				return nullptr;
+			std::vector<SegmentedStream::Segment> segments;
+			segments.reserve(record->chunkCount);
+			for(auto i = record->firstChunk; i < record->firstChunk + record->chunkCount; ++i) {
+				auto &chunk = chunks[i];
+				auto compressed = (chunk.packedSize != 0);
+				segments.push_back({{file->GetData() + chunk.offset, compressed ? chunk.packedSize : chunk.size}, chunk.size, compressed});
+			}
+			return std::make_unique<SegmentedStream>(record->texture ? get_dds_header(*record) : std::vector<uint8_t> {}, std::move(segments), DecompressStream::Format::Zlib);
+		}
+
+		// BA2 textures only contain the pixel data, the DDS header is created from the texture record. Formats
+		// that can be described without the DX10 header extension are written with a legacy pixel format.
+		static std::vector<uint8_t> get_dds_header(const Record &record)
+		{
+			constexpr uint32_t DDSD_CAPS = 0x1, DDSD_HEIGHT = 0x2, DDSD_WIDTH = 0x4, DDSD_PITCH = 0x8, DDSD_PIXELFORMAT = 0x1000, DDSD_MIPMAPCOUNT = 0x20000, DDSD_LINEARSIZE = 0x80000;
+			constexpr uint32_t DDPF_ALPHAPIXELS = 0x1, DDPF_FOURCC = 0x4, DDPF_RGB = 0x40, DDPF_LUMINANCE = 0x20000;
+			constexpr uint32_t DDSCAPS_COMPLEX = 0x8, DDSCAPS_TEXTURE = 0x1000, DDSCAPS_MIPMAP = 0x400000, DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00;
+			constexpr uint32_t D3D10_RESOURCE_DIMENSION_TEXTURE2D = 3, D3D10_RESOURCE_MISC_TEXTURECUBE = 0x4;
+			auto fourCC = [](const char(&code)[5]) { return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) | (static_cast<uint32_t>(code[2]) << 16) | (static_cast<uint32_t>(code[3]) << 24); };
+			struct PixelFormat {
+				uint32_t flags = 0;
+				uint32_t fourCC = 0;
+				uint32_t bitCount = 0;
+				std::array<uint32_t, 4> masks {};
+			};
+			// Values of DXGI_FORMAT
+			std::optional<PixelFormat> legacyFormat;
+			uint32_t blockSize = 0;
+			uint32_t bitsPerPixel = 0;
+			switch(record.format) {
+			case 28: // R8G8B8A8_UNORM
+				legacyFormat = PixelFormat {DDPF_RGB | DDPF_ALPHAPIXELS, 0, 32, {0xff, 0xff00, 0xff0000, 0xff000000}};
+				bitsPerPixel = 32;
+				break;
+			case 61: // R8_UNORM
+				legacyFormat = PixelFormat {DDPF_LUMINANCE, 0, 8, {0xff, 0, 0, 0}};
+				bitsPerPixel = 8;
+				break;
+			case 71: // BC1_UNORM
+				legacyFormat = PixelFormat {DDPF_FOURCC, fourCC("DXT1")};
+				blockSize = 8;
+				break;
+			case 74: // BC2_UNORM
+				legacyFormat = PixelFormat {DDPF_FOURCC, fourCC("DXT3")};
+				blockSize = 16;
+				break;
+			case 77: // BC3_UNORM
+				legacyFormat = PixelFormat {DDPF_FOURCC, fourCC("DXT5")};
+				blockSize = 16;
+				break;
+			case 80: // BC4_UNORM
+				legacyFormat = PixelFormat {DDPF_FOURCC, fourCC("ATI1")};
+				blockSize = 8;
+				break;
+			case 83: // BC5_UNORM
+				legacyFormat = PixelFormat {DDPF_FOURCC, fourCC("ATI2")};
+				blockSize = 16;
+				break;
+			case 87: // B8G8R8A8_UNORM
+				legacyFormat = PixelFormat {DDPF_RGB | DDPF_ALPHAPIXELS, 0, 32, {0xff0000, 0xff00, 0xff, 0xff000000}};
+				bitsPerPixel = 32;
+				break;
+			case 88: // B8G8R8X8_UNORM
+				legacyFormat = PixelFormat {DDPF_RGB, 0, 32, {0xff0000, 0xff00, 0xff, 0}};
+				bitsPerPixel = 32;
+				break;
+			case 29: // R8G8B8A8_UNORM_SRGB
+			case 91: // B8G8R8A8_UNORM_SRGB
+				bitsPerPixel = 32;
+				break;
+			case 72: // BC1_UNORM_SRGB
+			case 81: // BC4_SNORM
+				blockSize = 8;
+				break;
+			case 75: // BC2_UNORM_SRGB
+			case 78: // BC3_UNORM_SRGB
+			case 84: // BC5_SNORM
+			case 95: // BC6H_UF16
+			case 96: // BC6H_SF16
+			case 98: // BC7_UNORM
+			case 99: // BC7_UNORM_SRGB
+				blockSize = 16;
+				break;
+			}
+
+			std::vector<uint8_t> header;
+			header.reserve(148);
+			auto write = [&header](uint32_t value) { header.insert(header.end(), reinterpret_cast<uint8_t *>(&value), reinterpret_cast<uint8_t *>(&value) + sizeof(value)); };
+			write(fourCC("DDS "));
+			write(124); // Size of the header
+			auto flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT;
+			uint32_t pitchOrLinearSize = 0;
+			if(blockSize > 0) {
+				flags |= DDSD_LINEARSIZE;
+				pitchOrLinearSize = std::max<uint32_t>(1, (record.width + 3) / 4) * std::max<uint32_t>(1, (record.height + 3) / 4) * blockSize;
+			}
+			else if(bitsPerPixel > 0) {
+				flags |= DDSD_PITCH;
+				pitchOrLinearSize = (record.width * bitsPerPixel + 7) / 8;
+			}
+			write(flags);
+			write(record.height);
+			write(record.width);
+			write(pitchOrLinearSize);
+			write(0); // Depth
+			write(std::max<uint32_t>(record.mipCount, 1));
+			for(uint32_t i = 0; i < 11; ++i)
+				write(0); // Reserved
+			auto pixelFormat = legacyFormat.value_or(PixelFormat {DDPF_FOURCC, fourCC("DX10")});
+			write(32); // Size of the pixel format
+			write(pixelFormat.flags);
+			write(pixelFormat.fourCC);
+			write(pixelFormat.bitCount);
+			for(auto mask : pixelFormat.masks)
+				write(mask);
+			auto caps = DDSCAPS_TEXTURE;
+			if(record.mipCount > 1)
+				caps |= DDSCAPS_COMPLEX | DDSCAPS_MIPMAP;
+			if(record.cubemap)
+				caps |= DDSCAPS_COMPLEX;
+			write(caps);
+			write(record.cubemap ? DDSCAPS2_CUBEMAP_ALLFACES : 0);
+			write(0); // Caps 3
+			write(0); // Caps 4
+			write(0); // Reserved
+			if(legacyFormat.has_value() == false) {
+				write(record.format);
+				write(D3D10_RESOURCE_DIMENSION_TEXTURE2D);
+				write(record.cubemap ? D3D10_RESOURCE_MISC_TEXTURECUBE : 0);
+				write(1); // Array size
+				write(0); // Alpha mode
+			}
+			return header;
+		}
+	};
+};
+#endif
+
+// Sequential reads continue where the previous read stopped, seeking backwards restarts decompression.
+// owner has to keep the compressed data alive.
+template<class TStream>
+static pragma::gamemount::ArchiveEntryFile::Reader make_stream_reader(std::shared_ptr<const void> owner, std::unique_ptr<TStream> stream)
+{
+	return [owner = std::move(owner), stream = std::shared_ptr<TStream> {std::move(stream)}](void *dst, size_t offset, size_t len) -> size_t {
+		if(stream->Tell() != offset && stream->Seek(offset) == false)
+			return 0;
+		auto numRead = stream->Read({static_cast<uint8_t *>(dst), len});
+		return stream->HasFailed() ? 0 : numRead;
+	};
+}
+
+static pragma::gamemount::PathConvention get_path_convention(pragma::gamemount::GameEngine engine)
+{
+#ifdef ENABLE_BETHESDA_FORMATS
+	if(engine == pragma::gamemount::GameEngine::Gamebryo || engine == pragma::gamemount::GameEngine::CreationEngine)
+		return pragma::gamemount::PathConvention::Gamebryo;
+#endif
+	return pragma::gamemount::PathConvention::Source;
+}
 
 pragma::gamemount::GameEngine pragma::gamemount::engine_name_to_enum(const std::string &name)
 {
@@ -113,28 +519,135 @@ pragma::gamemount::BaseEngineSettings *pragma::gamemount::GameMountInfo::SetEngi
 namespace pragma::gamemount {
 	void setup();
 	void initialize(bool bWait);
-	class BaseMountedGame {
+	class BaseMountedGame : public std::enable_shared_from_this<BaseMountedGame> {
 	  public:
+		static std::unique_ptr<BaseMountedGame> Create(const std::string &identifier, GameEngine gameEngine);
+		virtual ~BaseMountedGame();
 		const std::vector<util::Path> &GetMountedPaths() const;
 		const std::vector<ArchiveFileTable> &GetArchives() const;
-		void FindFiles(const std::string &fpath, std::vector<std::string> *optOutFiles, std::vector<std::string> *optOutDirs, bool keepAbsPaths = false);
+		// Applies the path conventions of the game engine
+		std::string GetSearchPath(const std::string &path) const;
+		// Reports the files and directories in the mounted paths on disk that match the pattern. The same path
+		// may be reported once per mounted path.
+		void FindSystemFiles(const std::string &searchPath, const GlobPattern &pattern, bool keepAbsPaths, const std::function<void(std::string path, bool isDirectory)> &callback) const;
+		// Merged directory tree of all archives of this game. The provider of each entry is its archive index.
+		const DirectoryIndex &GetDirectoryIndex() const
+		{
+			EnsureIndexed();
+			return m_directoryIndex;
+		}
 		bool Load(const std::string &path, std::vector<uint8_t> &data);
-		VFilePtr Load(const std::string &path, std::optional<std::string> *optOutSourcePath = nullptr);
+		// If streamed is true, compressed entries are decompressed while they are read instead of up front
+		VFilePtr Load(const std::string &path, std::optional<std::string> *optOutSourcePath = nullptr, bool streamed = false);
+		bool LoadFromArchive(uint32_t archiveIdx, const std::string &path, std::vector<uint8_t> &data);
+		// Goes through the entry cache
+		EntryCache::Buffer LoadFromArchive(uint32_t archiveIdx, const std::string &path);
+		// Reads into a buffer from the buffer pool. Cached entries are copied from the entry cache.
+		std::shared_ptr<PooledBuffer> LoadPooledFromArchive(uint32_t archiveIdx, const std::string &path);
+		// Returns the memory the entry is read into, once its size is known. May return nullptr to cancel the read.
+		using ReadAllocator = std::function<uint8_t *(size_t size)>;
+		bool ReadFromArchive(uint32_t archiveIdx, const std::string &path, const ReadAllocator &allocate);
+		bool ReadFromArchive(uint32_t archiveIdx, const std::string &path, std::vector<uint8_t> &data);
+		// Returns the data file and offset of the entry within the archive, which can be used to order reads.
+		// Archives that don't expose this return {0, 0}.
+		std::pair<uint32_t, uint64_t> GetDataLocation(uint32_t archiveIdx, const std::string &path) const;
+		VFilePtr OpenFromArchive(uint32_t archiveIdx, const std::string &path, bool streamed = false);
+		bool Exists(const std::string &path) const;
+		// Only checks the mounted paths, not the archives
+		bool ExistsOnDisk(const std::string &path) const;
+		// Files on disk take precedence over archived files, same as for Load
+		std::optional<FileStat> Stat(const std::string &path);
+		std::optional<size_t> ReadRange(const std::string &path, size_t offset, void *dst, size_t len);
+		std::optional<FileStat> StatArchiveFile(uint32_t archiveIdx, const std::string &path) const;
+		std::optional<size_t> ReadRangeFromArchive(uint32_t archiveIdx, const std::string &path, size_t offset, void *dst, size_t len) const;
 
 		void MountPath(const std::string &path);
 		ArchiveFileTable &AddArchiveFileTable(const std::string &fileName, const std::shared_ptr<void> &phandle);
+		ArchiveFileTable &AddArchiveFileTable(ArchiveFileTable &&fileTable);
 		const std::string &GetIdentifier() const { return m_identifier; }
+		GameEngine GetGameEngine() const { return m_gameEngine; }
+
+		// Has to be called once all archives have been added
+		void BuildPathIndex();
+		NormalizedPath GetIndexPath(std::string_view path) const { return NormalizedPath {path, get_path_convention(m_gameEngine)}; }
+		const std::vector<PathIndex::Entry> *FindArchiveFile(const NormalizedPath &indexPath) const
+		{
+			if(MayContainDeferred(indexPath) == false)
+				return nullptr;
+			EnsureIndexed();
+			return m_pathIndex.Find(indexPath);
+		}
+		bool ContainsArchiveFile(const NormalizedPath &indexPath) const { return FindArchiveFile(indexPath) != nullptr; }
+
+		// The lookup filter contains the index paths of all files in the mounted paths and archives of this game,
+		// which allows rejecting missing files without touching the file system. It has to be rebuilt whenever
+		// the mounted paths or their contents change, loose files added afterwards are definite misses until then.
+		void RebuildLookupFilter();
+		void InvalidateLookupFilter();
+		bool MayContain(const NormalizedPath &indexPath) const;
+
+		// Archives that have been found on mount, but have not been opened or indexed yet
+		struct DeferredArchive {
+			std::string path;
+			std::string identifier;
+			std::string rootDir;
+			bool lazyHandle = false;
+			// Loaded from the index cache, if available
+			std::shared_ptr<const ArchiveSummary> summary = nullptr;
+		};
+		void AddDeferredArchive(DeferredArchive &&archive);
+		bool HasDeferredArchives() const { return m_deferredArchives.empty() == false; }
+		// Indexes the deferred archives if there are any. This happens once, on the first lookup that reaches this game.
+		// Misses reach every game. If the index cache provides a summary for every deferred archive, most misses are
+		// ruled out by the summaries, otherwise the first missing file that is looked up indexes all games.
+		void EnsureIndexed() const;
+		bool IsIndexed() const { return m_indexed.load(std::memory_order_acquire); }
+		// Whether the deferred archives may contain the file or root directory. Always true once the game has been
+		// indexed, or if any deferred archive has no summary.
+		bool MayContainDeferred(const NormalizedPath &indexPath) const;
+		bool MayContainDeferredRootDirectory(std::string_view name) const;
+		// Number of threads used to index the deferred archives
+		void SetIndexWorkerCount(uint32_t count) { m_indexWorkerCount = std::max(count, 1u); }
 
 		void SetGameMountInfoIndex(uint32_t gameMountInfoIdx) { m_gameMountInfoIdx = gameMountInfoIdx; }
 		uint32_t GetGameMountInfoIndex() const { return m_gameMountInfoIdx; }
+		// Only accessed by the mount manager while holding the game list lock
+		void SetPriority(int32_t priority) { m_priority = priority; }
+		int32_t GetPriority() const { return m_priority; }
+
+		// VPK archives this game has registered for deduplication, which are released again when it is unmounted
+		void AddRegisteredVpkArchive(const std::string &fileName, const util::Path &path) { m_registeredVpkArchives.push_back({fileName, path}); }
+		const std::vector<std::pair<std::string, util::Path>> &GetRegisteredVpkArchives() const { return m_registeredVpkArchives; }
+
+		// Creates a new version of this game with additional archives. The file tables and archive handles of this game
+		// are shared with the new version, only the path indices are rebuilt and the lookup filter is extended by the new
+		// files. Indexes this game first, if it hasn't been indexed yet.
+		std::shared_ptr<BaseMountedGame> Extend(std::vector<ArchiveFileTable> &&archives, const std::vector<std::pair<std::string, util::Path>> &registeredVpkArchives) const;
 	  protected:
 		BaseMountedGame(const std::string &identifier, GameEngine gameEngine);
 	  private:
+		void IndexDeferredArchives();
+		void BuildLookupFilter();
+		std::vector<DeferredArchive> m_deferredArchives {};
+		// Kept separately from the deferred archives, which are cleared by the indexing while lookups may still read
+		// the summaries. Empty if any deferred archive has no summary.
+		std::vector<std::shared_ptr<const ArchiveSummary>> m_deferredSummaries {};
+		bool m_hasDeferredSummaries = true;
+		mutable std::once_flag m_indexOnce;
+		mutable std::atomic<bool> m_indexed = true;
+		uint32_t m_indexWorkerCount = 1;
 		GameEngine m_gameEngine = GameEngine::Invalid;
 		uint32_t m_gameMountInfoIdx = 0;
+		int32_t m_priority = 0;
+		PathIndex m_pathIndex {};
+		// Merged directory tree of all archives, used for wildcard searches
+		DirectoryIndex m_directoryIndex {};
+		std::shared_ptr<const BloomFilter> m_lookupFilter = nullptr;
+		mutable std::mutex m_lookupFilterMutex;
 		std::string m_identifier;
 		std::vector<util::Path> m_mountedPaths {};
 		std::vector<ArchiveFileTable> m_archives {};
+		std::vector<std::pair<std::string, util::Path>> m_registeredVpkArchives {};
 	};
 
 	class SourceEngineMountedGame : public BaseMountedGame {
@@ -165,39 +678,76 @@ namespace pragma::gamemount {
 		GameMountManager(const GameMountManager &) = delete;
 		GameMountManager &operator=(const GameMountManager &) = delete;
 		~GameMountManager();
+		// Games mounted after initialization are mounted in the background. A game that has been unmounted or
+		// has failed to mount can be mounted again with the same identifier.
 		bool MountGame(const GameMountInfo &mountInfo);
+		// Waits until the game has finished mounting. Readers that are still using the game keep it alive.
+		// VPK archives of other games that were skipped as duplicates of this game's archives are mounted in the background.
+		bool UnmountGame(const std::string &identifier);
+		// Mounts an archive, or all archives in a directory, into a mounted game. Blocks until the archives have been indexed.
+		bool MountGameArchives(const std::string &identifier, const std::string &path);
 		void Start();
+		// Can be called from any number of threads
 		void WaitUntilInitializationComplete();
-
-		void InitializeGame(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx);
-		const std::vector<std::unique_ptr<BaseMountedGame>> &GetMountedGames() const;
-		const std::vector<GameMountInfo> &GetGameMountInfos() const { return m_mountedGameInfos; }
-		void UpdateGamePriorities();
-
-		const GameMountInfo *FindGameMountInfo(const std::string &identifier) const
+		bool IsInitializationComplete();
+
+		void MountGames(const std::vector<uint32_t> &gameMountInfoIndices);
+		void SetWorkerCount(uint32_t count);
+		void SetLazyIndexing(bool lazy) { m_lazyIndexing = lazy; }
+		uint32_t GetWorkerCount() const;
+		std::vector<GameMountInfo> GetGameMountInfos() const;
+		GameMountInfo GetGameMountInfo(uint32_t gameMountInfoIdx) const;
+
+		// Immutable snapshot of the games that are ready, sorted by priority. Games that are still being mounted
+		// are added as soon as they are ready, existing snapshots are not affected by this.
+		using GameList = std::vector<std::shared_ptr<BaseMountedGame>>;
+		std::shared_ptr<const GameList> GetMountedGames() const;
+		// Blocks until no game that is still being mounted has precedence over the games that contain the file
+		// according to the predicate, and returns the mounted games at that point. If no game contains the file,
+		// the fallback predicate is evaluated once for the games that are ready at that point.
+		std::shared_ptr<const GameList> WaitForGames(const std::function<bool(const BaseMountedGame &)> &contains, const std::function<bool(const BaseMountedGame &)> &fallback = nullptr);
+		// Waits for the games that may provide the file. While games are mounting, only the archive indices are
+		// consulted. The mounted paths are probed only once, and only if no archive contains the file.
+		std::shared_ptr<const GameList> WaitForGames(const std::string &path);
+		// Blocks until the specified game is either ready or has failed to mount
+		std::shared_ptr<BaseMountedGame> WaitForGame(const std::string &identifier);
+		std::optional<GameMountState> GetGameState(const std::string &identifier) const;
+		std::optional<int32_t> GetGamePriority(const std::string &identifier) const;
+		void SetGamePriority(const std::string &identifier, int32_t priority);
+
+		std::optional<uint32_t> FindGameMountInfoIndex(const std::string &identifier) const
 		{
-			auto &gameMountInfos = GetGameMountInfos();
+			std::shared_lock lock {m_gameInfoMutex};
+			auto &gameMountInfos = m_mountedGameInfos;
 			auto it = std::find_if(gameMountInfos.begin(), gameMountInfos.end(), [&identifier](const GameMountInfo &mountInfo) { return ustring::compare(mountInfo.identifier, identifier, false); });
 			if(it == gameMountInfos.end())
-				return nullptr;
-			return &*it;
+				return {};
+			return it - gameMountInfos.begin();
 		}
 
-		const BaseMountedGame *FindMountedGameByIdentifier(const std::string &identifier) const { return const_cast<GameMountManager *>(this)->FindMountedGameByIdentifier(identifier); }
-		BaseMountedGame *FindMountedGameByIdentifier(const std::string &identifier)
+		std::shared_ptr<BaseMountedGame> FindMountedGameByIdentifier(const std::string &identifier) const
 		{
-			auto &gameMountInfos = GetGameMountInfos();
-			auto it = std::find_if(gameMountInfos.begin(), gameMountInfos.end(), [&identifier](const GameMountInfo &mountInfo) { return ustring::compare(mountInfo.identifier, identifier, false); });
-			if(it == gameMountInfos.end())
+			auto idx = FindGameMountInfoIndex(identifier);
+			if(idx.has_value() == false)
 				return nullptr;
-			auto idx = it - gameMountInfos.begin();
-			auto itGame = std::find_if(m_mountedGames.begin(), m_mountedGames.end(), [idx](const std::unique_ptr<BaseMountedGame> &game) { return game->GetGameMountInfoIndex() == idx; });
-			if(itGame == m_mountedGames.end())
+			auto games = GetMountedGames();
+			auto itGame = std::find_if(games->begin(), games->end(), [idx](const std::shared_ptr<BaseMountedGame> &game) { return game->GetGameMountInfoIndex() == *idx; });
+			if(itGame == games->end())
 				return nullptr;
-			return itGame->get();
+			return *itGame;
 		}
 
-		const std::unordered_map<std::string, util::Path> &GetMountedVpkArchives() const { return m_mountedVPKArchives; }
+		std::unordered_map<std::string, util::Path> GetMountedVpkArchives() const;
+		bool Load(const std::string &path, std::vector<uint8_t> &data);
+		EntryCache::Buffer Load(const std::string &path);
+		std::vector<EntryCache::Buffer> Load(const std::vector<std::string> &paths);
+		std::shared_ptr<PooledBuffer> LoadPooled(const std::string &path);
+		// Searches the specified game, or all mounted games if it is nullptr. Every path is only reported once.
+		void FindFiles(const std::string &path, const std::shared_ptr<BaseMountedGame> &game, bool keepAbsPaths, const FindFilesCallback &callback);
+
+		// Opens the archive and builds its file table, or loads the file table from the index cache.
+		// Returns an empty optional if the archive could not be opened.
+		static std::optional<ArchiveFileTable> IndexArchive(GameEngine gameEngine, const std::string &archivePath, const std::string &rootDir, bool lazyHandle);
 
 		static std::string GetNormalizedPath(const std::string &path);
 		static std::string GetNormalizedSourceEnginePath(const std::string &path);
@@ -205,28 +755,349 @@ namespace pragma::gamemount {
 		static std::string GetNormalizedGamebryoPath(const std::string &path);
 #endif
 	  private:
-		static void InitializeArchiveFileTable(pragma::gamemount::ArchiveFileTable::Item &archiveDir, const pragma::gamemount::hl::Archive::Directory &dir);
+		// Archive that has to be opened and indexed for a game. The candidate paths are tried in order.
+		struct ArchiveMountJob {
+			uint32_t gameMountInfoIndex = 0;
+			GameEngine gameEngine = GameEngine::Invalid;
+			std::string name;
+			std::string rootDir;
+			bool mountAllCandidates = false;
+			// If set, the candidates are the archives matching this pattern at the time the job is executed
+			std::string searchPattern;
+			// Workshop addons are mounted in addition to the game archives, so they are not deduplicated
+			bool workshop = false;
+			// Closes the archive once it has been indexed, it is reopened when a file is loaded from it
+			bool lazyHandle = false;
+			// Only checks whether the archives exist, they are indexed when the game is first accessed
+			bool deferIndexing = false;
+			// Set if the archive has already been mounted by another game, in which case the job is not executed
+			bool duplicate = false;
+			std::vector<util::Path> candidatePaths;
+			std::vector<std::pair<util::Path, ArchiveFileTable>> results;
+			std::vector<std::pair<util::Path, BaseMountedGame::DeferredArchive>> deferredResults;
+			// Whether the archives of this job take part in the VPK deduplication
+			bool IsDeduplicated() const { return (gameEngine == GameEngine::SourceEngine || gameEngine == GameEngine::Source2) && workshop == false; }
+		};
+		std::unique_ptr<BaseMountedGame> CreateGame(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx, std::vector<ArchiveMountJob> &outJobs);
+		static void ExecuteArchiveMountJob(ArchiveMountJob &job);
+		// Has to be called while holding m_vpkArchiveMutex. Returns false if the archive is a duplicate, in which case it is
+		// remembered, so it can be mounted once the game that provides it has been unmounted.
+		bool RegisterVpkArchive(const ArchiveMountJob &job, const std::string &fileName, const util::Path &path, std::vector<std::pair<std::string, util::Path>> &outRegistered);
+		void AddSkippedVpkArchive(const ArchiveMountJob &job, std::vector<util::Path> candidatePaths);
+		// Indexes the archives of the jobs and publishes a new version of the game that includes them. Readers that are
+		// still using the previous version are not affected. Returns false if no archive could be added to the game.
+		bool ExtendGame(const std::string &identifier, std::vector<ArchiveMountJob> &jobs);
+		// Runs the task on a background thread, unless the manager is being closed
+		bool StartMountThread(const std::function<void()> &task);
+		static std::vector<ArchiveType> GetArchiveTypes(GameEngine gameEngine);
+		void FinalizeGame(std::unique_ptr<BaseMountedGame> game, std::vector<ArchiveMountJob> &jobs);
+		void PublishGame(std::shared_ptr<BaseMountedGame> game);
+		// Merged directory tree of the archives of all mounted games using the engine that have been indexed, in order of
+		// their priority. The provider of each entry is its game mount info index.
+		std::shared_ptr<const DirectoryIndex> GetUnionDirectoryIndex(GameEngine gameEngine);
+		// Has to be called whenever a game is added or removed, or a priority changes
+		void InvalidateUnionDirectoryIndices();
+		void SetGameState(uint32_t gameMountInfoIdx, GameMountState state, float progress);
+		// Marks the games that are still pending or mounting as failed
+		void FailUnfinishedGames(const std::vector<uint32_t> &gameMountInfoIndices);
+		// Has to be called whenever a game is added or a priority changes
+		void UpdateMountOrder();
+		// Returns true if a game that comes before the specified rank in the mount order is still being mounted
+		bool IsMountPending(uint32_t rank) const;
+		bool HasPrecedence(const BaseMountedGame &game0, const BaseMountedGame &game1) const;
+		struct ArchiveLocation {
+			std::shared_ptr<BaseMountedGame> game;
+			uint32_t archiveIndex = 0;
+		};
+		// Returns all archives containing the path, sorted by game priority
+		std::vector<ArchiveLocation> FindArchives(const std::string &path);
+		static std::shared_ptr<void> OpenArchive(ArchiveType type, const std::string &path, const std::string &rootDir);
+		// Builds the file table from the archive handle
+		static void InitializeArchiveFileTable(ArchiveFileTable &fileTable);
+		static void InitializeArchiveFileTable(pragma::gamemount::ArchiveFileTable &fileTable, ArchiveFileTable::NodeIndex archiveDir, const pragma::gamemount::hl::Archive::Directory &dir);
 
 		std::vector<util::Path> FindSteamGamePaths(const std::string &relPath);
-		void MountWorkshopAddons(BaseMountedGame &game, SteamSettings::AppId appId);
+		// Adds a job for each workshop addon of the game. The addon directories are only searched for archives by
+		// the mount workers.
+		void AddWorkshopMountJobs(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx, std::vector<ArchiveMountJob> &outJobs);
 
+		// Games can be added at runtime, so the mount infos are only accessed while holding this lock
 		std::vector<GameMountInfo> m_mountedGameInfos {};
-		std::vector<std::unique_ptr<BaseMountedGame>> m_mountedGames {};
+		mutable std::shared_mutex m_gameInfoMutex;
+		std::shared_ptr<const GameList> m_mountedGames = std::make_shared<const GameList>();
+		mutable std::mutex m_gameListMutex;
 
 		std::thread m_loadThread;
-		bool m_initialized = false;
+		// Threads for games that are mounted after initialization
+		struct MountThread {
+			std::thread thread;
+			std::shared_ptr<std::atomic<bool>> complete;
+		};
+		std::vector<MountThread> m_mountThreads;
+		std::mutex m_mountThreadMutex;
+		// Guards the mount states and the initialization state
+		mutable std::mutex m_stateMutex;
+		std::condition_variable m_stateCondition;
+		std::vector<GameMountState> m_gameStates {};
+		// Incremented whenever a mount state changes
+		uint64_t m_stateVersion = 0;
+		bool m_initComplete = false;
+		std::atomic<bool> m_initialized = false;
 		std::atomic<bool> m_cancel = false;
+		uint32_t m_workerCount = 0;
+		std::atomic<bool> m_lazyIndexing = false;
+
+		// Game mount info indices sorted by priority, and the position of each game in that order
+		std::vector<uint32_t> m_mountOrder {};
+		std::vector<uint32_t> m_mountRanks {};
 
 		std::unordered_map<std::string, util::Path> m_mountedVPKArchives {};
+		// Duplicate VPK archives that have been skipped, and the names that have been released by an unmounted game
+		// and are reserved for the game that mounts the skipped archive in their place
+		std::vector<ArchiveMountJob> m_skippedVpkArchives {};
+		std::unordered_map<std::string, uint32_t> m_reservedVpkArchives {};
+		mutable std::mutex m_vpkArchiveMutex;
+		// Serializes replacing and removing games, so an unmount can't be undone by a game version that is published later
+		std::mutex m_gameVersionMutex;
+
+		// Union views are rebuilt on the first search after the mounted games have changed
+		struct UnionDirectoryIndex {
+			std::shared_ptr<const DirectoryIndex> index;
+			// Games that haven't been indexed yet are left out, the index is rebuilt once more games have been indexed
+			size_t gameCount = 0;
+		};
+		std::unordered_map<GameEngine, UnionDirectoryIndex> m_unionDirectoryIndices {};
+		std::mutex m_unionDirectoryIndexMutex;
 	};
 };
 
 pragma::gamemount::BaseMountedGame::BaseMountedGame(const std::string &identifier, GameEngine gameEngine) : m_gameEngine {gameEngine}, m_identifier {identifier} {}
+std::unique_ptr<pragma::gamemount::BaseMountedGame> pragma::gamemount::BaseMountedGame::Create(const std::string &identifier, GameEngine gameEngine)
+{
+	switch(gameEngine) {
+	case GameEngine::SourceEngine:
+		return std::make_unique<SourceEngineMountedGame>(identifier, gameEngine);
+	case GameEngine::Source2:
+		return std::make_unique<Source2MountedGame>(identifier, gameEngine);
+#ifdef ENABLE_BETHESDA_FORMATS
+	case GameEngine::Gamebryo:
+		return std::make_unique<GamebryoMountedGame>(identifier, gameEngine);
+	case GameEngine::CreationEngine:
+		return std::make_unique<CreationEngineMountedGame>(identifier, gameEngine);
+#endif
+	}
+	return nullptr;
+}
+pragma::gamemount::BaseMountedGame::~BaseMountedGame()
+{
+	// Games are only destroyed once no reader is using them anymore, so no new entries can be cached for the
+	// archives at this point. The entries have to be removed before the handle addresses can be reused, which is
+	// only the case once no other version of the game shares the handle.
+	for(auto &archive : m_archives) {
+		if(archive.ReleaseShare() == false)
+			continue;
+		auto *handle = archive.GetLoadedHandle();
+		if(handle)
+			g_entryCache.Flush(handle);
+	}
+}
+std::shared_ptr<pragma::gamemount::BaseMountedGame> pragma::gamemount::BaseMountedGame::Extend(std::vector<ArchiveFileTable> &&archives, const std::vector<std::pair<std::string, util::Path>> &registeredVpkArchives) const
+{
+	EnsureIndexed();
+	std::shared_ptr<BaseMountedGame> game = Create(m_identifier, m_gameEngine);
+	if(game == nullptr)
+		return nullptr;
+	game->m_gameMountInfoIdx = m_gameMountInfoIdx;
+	game->m_indexWorkerCount = m_indexWorkerCount;
+	game->m_mountedPaths = m_mountedPaths;
+	game->m_registeredVpkArchives = m_registeredVpkArchives;
+	game->m_registeredVpkArchives.insert(game->m_registeredVpkArchives.end(), registeredVpkArchives.begin(), registeredVpkArchives.end());
+
+	// New archives are kept in heap-allocated tables, so each version only keeps the originally mounted version alive
+	// (which owns the data of the initial tables), instead of every version that came before it
+	game->m_archives.reserve(m_archives.size() + archives.size());
+	auto self = shared_from_this();
+	for(auto &archive : m_archives)
+		game->m_archives.push_back(archive.Share(self));
+	std::shared_ptr<BloomFilter> lookupFilter = nullptr;
+	{
+		std::scoped_lock lock {m_lookupFilterMutex};
+		if(m_lookupFilter)
+			lookupFilter = std::make_shared<BloomFilter>(*m_lookupFilter);
+	}
+	for(auto &archive : archives) {
+		if(lookupFilter)
+			archive.GetFilePaths([&lookupFilter](const std::string &filePath) { lookupFilter->Add(filePath); });
+		auto table = std::make_shared<ArchiveFileTable>(std::move(archive));
+		game->m_archives.push_back(table->Share(table));
+		// The table only keeps the data alive, the new version is the only one using the handle so far
+		table->ReleaseShare();
+	}
+	game->BuildPathIndex();
+	// Games without a lookup filter don't reject any lookups, which is still the case for the new version
+	game->m_lookupFilter = std::move(lookupFilter);
+	return game;
+}
 void pragma::gamemount::BaseMountedGame::MountPath(const std::string &path)
 {
 	if(m_mountedPaths.size() == m_mountedPaths.capacity())
 		m_mountedPaths.reserve(m_mountedPaths.size() * 1.5f + 100);
 	m_mountedPaths.push_back(path);
+	InvalidateLookupFilter();
+}
+void pragma::gamemount::BaseMountedGame::AddDeferredArchive(DeferredArchive &&archive)
+{
+	if(archive.summary && m_hasDeferredSummaries)
+		m_deferredSummaries.push_back(archive.summary);
+	else {
+		m_hasDeferredSummaries = false;
+		m_deferredSummaries.clear();
+	}
+	m_deferredArchives.push_back(std::move(archive));
+	m_indexed = false;
+}
+bool pragma::gamemount::BaseMountedGame::MayContainDeferred(const NormalizedPath &indexPath) const
+{
+	if(IsIndexed() || m_hasDeferredSummaries == false)
+		return true;
+	return std::any_of(m_deferredSummaries.begin(), m_deferredSummaries.end(), [&indexPath](const std::shared_ptr<const ArchiveSummary> &summary) { return summary->filter.MayContainHash(indexPath.GetHash()); });
+}
+bool pragma::gamemount::BaseMountedGame::MayContainDeferredRootDirectory(std::string_view name) const
+{
+	if(IsIndexed() || m_hasDeferredSummaries == false)
+		return true;
+	return std::any_of(m_deferredSummaries.begin(), m_deferredSummaries.end(), [name](const std::shared_ptr<const ArchiveSummary> &summary) { return summary->ContainsRootDirectory(name); });
+}
+void pragma::gamemount::BaseMountedGame::EnsureIndexed() const
+{
+	if(m_indexed.load(std::memory_order_acquire))
+		return;
+	std::call_once(m_indexOnce, [this]() { const_cast<BaseMountedGame *>(this)->IndexDeferredArchives(); });
+}
+void pragma::gamemount::BaseMountedGame::IndexDeferredArchives()
+{
+	if(should_log(util::LogSeverity::Info))
+		log("[" + GetIdentifier() + "] Indexing " + std::to_string(m_deferredArchives.size()) + " archives on first access...", util::LogSeverity::Info);
+	std::vector<std::optional<ArchiveFileTable>> fileTables(m_deferredArchives.size());
+	auto numWorkers = std::min<size_t>(m_indexWorkerCount, m_deferredArchives.size());
+	std::atomic<size_t> nextArchive = 0;
+	auto worker = [this, &fileTables, &nextArchive]() {
+		for(;;) {
+			auto archiveIdx = nextArchive++;
+			if(archiveIdx >= m_deferredArchives.size())
+				return;
+			auto &archive = m_deferredArchives[archiveIdx];
+			fileTables[archiveIdx] = GameMountManager::IndexArchive(m_gameEngine, archive.path, archive.rootDir, archive.lazyHandle);
+		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(numWorkers);
+	for(auto i = decltype(numWorkers) {1u}; i < numWorkers; ++i) {
+		workers.push_back(std::thread {worker});
+		util::set_thread_name(workers.back(), "uarch_index_worker");
+	}
+	worker();
+	for(auto &t : workers)
+		t.join();
+
+	for(auto i = decltype(fileTables.size()) {0u}; i < fileTables.size(); ++i) {
+		auto &fileTable = fileTables[i];
+		if(fileTable.has_value() == false) {
+			if(should_log(util::LogSeverity::Warning))
+				log("[" + GetIdentifier() + "] Unable to open archive '" + m_deferredArchives[i].path + "'!", util::LogSeverity::Warning);
+			continue;
+		}
+		fileTable->identifier = std::move(m_deferredArchives[i].identifier);
+		AddArchiveFileTable(std::move(*fileTable));
+	}
+	m_deferredArchives.clear();
+	m_deferredArchives.shrink_to_fit();
+	BuildPathIndex();
+	BuildLookupFilter();
+	m_indexed.store(true, std::memory_order_release);
+}
+void pragma::gamemount::BaseMountedGame::RebuildLookupFilter()
+{
+	EnsureIndexed();
+	BuildLookupFilter();
+}
+void pragma::gamemount::BaseMountedGame::BuildLookupFilter()
+{
+	std::vector<std::string> diskFiles;
+	for(auto &path : GetMountedPaths()) {
+		std::error_code ec;
+		auto rootPath = std::filesystem::path {path.GetString()}.generic_string();
+		if(rootPath.empty() == false && rootPath.back() != '/')
+			rootPath += '/';
+		// Symlinked directories are followed, since files in them can be loaded from the mounted path as well
+		std::filesystem::recursive_directory_iterator it {rootPath, std::filesystem::directory_options::skip_permission_denied | std::filesystem::directory_options::follow_directory_symlink, ec};
+		std::error_code ecExists;
+		if(ec && std::filesystem::exists(rootPath, ecExists) == false)
+			continue;
+		for(; !ec && it != std::filesystem::recursive_directory_iterator {}; it.increment(ec)) {
+			std::error_code ecFile;
+			if(it->is_regular_file(ecFile) == false)
+				continue;
+			auto filePath = it->path().generic_string();
+			if(filePath.length() <= rootPath.length())
+				continue;
+			filePath.erase(0, rootPath.length());
+			ustring::to_lower(filePath);
+			diskFiles.push_back(std::move(filePath));
+		}
+		if(ec) {
+			// An incomplete filter would reject files that exist (e.g. behind a symlink cycle), so none is used
+			if(should_log(util::LogSeverity::Warning))
+				log("[" + GetIdentifier() + "] Unable to scan '" + rootPath + "' for the lookup filter: " + ec.message(), util::LogSeverity::Warning);
+			std::scoped_lock lock {m_lookupFilterMutex};
+			m_lookupFilter = nullptr;
+			return;
+		}
+	}
+	auto count = diskFiles.size();
+	for(auto &archive : m_archives)
+		count += archive.GetFileCount();
+	auto filter = std::make_shared<BloomFilter>(count);
+	for(auto &filePath : diskFiles)
+		filter->Add(filePath);
+	for(auto &archive : m_archives)
+		archive.GetFilePaths([&filter](const std::string &filePath) { filter->Add(filePath); });
+	if(should_log(util::LogSeverity::Debug))
+		log("[" + GetIdentifier() + "] Built lookup filter for " + std::to_string(count) + " files (" + std::to_string(filter->GetMemoryUsage()) + " bytes).", util::LogSeverity::Debug);
+
+	std::scoped_lock lock {m_lookupFilterMutex};
+	m_lookupFilter = std::move(filter);
+}
+void pragma::gamemount::BaseMountedGame::InvalidateLookupFilter()
+{
+	std::scoped_lock lock {m_lookupFilterMutex};
+	m_lookupFilter = nullptr;
+}
+bool pragma::gamemount::BaseMountedGame::MayContain(const NormalizedPath &indexPath) const
+{
+	// The lookup filter is only built once the game has been indexed. Until then, files in the archives are ruled out
+	// by the summaries in FindArchiveFile, and the mounted paths are probed by the caller.
+	if(IsIndexed() == false && m_hasDeferredSummaries)
+		return true;
+	EnsureIndexed();
+	// Paths outside of the mounted directories are not covered by the filter
+	if(indexPath.GetString().starts_with("../"))
+		return true;
+	std::shared_ptr<const BloomFilter> filter;
+	{
+		std::scoped_lock lock {m_lookupFilterMutex};
+		filter = m_lookupFilter;
+	}
+	return filter == nullptr || filter->MayContainHash(indexPath.GetHash());
+}
+void pragma::gamemount::BaseMountedGame::BuildPathIndex()
+{
+	m_pathIndex.Clear();
+	m_directoryIndex.Clear();
+	for(auto i = decltype(m_archives.size()) {0u}; i < m_archives.size(); ++i) {
+		m_pathIndex.AddArchiveFileTable(m_archives[i], m_gameMountInfoIdx, i);
+		m_directoryIndex.AddArchiveFileTable(m_archives[i], i);
+	}
 }
 pragma::gamemount::ArchiveFileTable &pragma::gamemount::BaseMountedGame::AddArchiveFileTable(const std::string &fileName, const std::shared_ptr<void> &phandle)
 {
@@ -236,96 +1107,88 @@ pragma::gamemount::ArchiveFileTable &pragma::gamemount::BaseMountedGame::AddArch
 	m_archives.back().identifier = fileName;
 	return m_archives.back();
 }
+pragma::gamemount::ArchiveFileTable &pragma::gamemount::BaseMountedGame::AddArchiveFileTable(ArchiveFileTable &&fileTable)
+{
+	if(m_archives.size() == m_archives.capacity())
+		m_archives.reserve(m_archives.size() * 1.5 + 50);
+	m_archives.push_back(std::move(fileTable));
+	return m_archives.back();
+}
 
 const std::vector<util::Path> &pragma::gamemount::BaseMountedGame::GetMountedPaths() const { return m_mountedPaths; }
-const std::vector<pragma::gamemount::ArchiveFileTable> &pragma::gamemount::BaseMountedGame::GetArchives() const { return m_archives; }
+const std::vector<pragma::gamemount::ArchiveFileTable> &pragma::gamemount::BaseMountedGame::GetArchives() const
+{
+	EnsureIndexed();
+	return m_archives;
+}
 
-void pragma::gamemount::BaseMountedGame::FindFiles(const std::string &fpath, std::vector<std::string> *optOutFiles, std::vector<std::string> *optOutDirs, bool keepAbsPaths)
+std::string pragma::gamemount::BaseMountedGame::GetSearchPath(const std::string &path) const
 {
-	auto npath = fpath;
 	switch(m_gameEngine) {
 	case GameEngine::SourceEngine:
 	case GameEngine::Source2:
-		npath = GameMountManager::GetNormalizedSourceEnginePath(npath);
-		break;
+		return GameMountManager::GetNormalizedSourceEnginePath(path);
 #ifdef ENABLE_BETHESDA_FORMATS
 	case GameEngine::Gamebryo:
 	case GameEngine::CreationEngine:
-		npath = GameMountManager::GetNormalizedGamebryoPath(npath);
-		break;
+		return GameMountManager::GetNormalizedGamebryoPath(path);
 #endif
 	}
-
+	return path;
+}
+void pragma::gamemount::BaseMountedGame::FindSystemFiles(const std::string &searchPath, const GlobPattern &pattern, bool keepAbsPaths, const std::function<void(std::string path, bool isDirectory)> &callback) const
+{
+	std::vector<std::string> files;
+	std::vector<std::string> dirs;
 	for(auto &path : GetMountedPaths()) {
-		auto foffset = optOutFiles ? optOutFiles->size() : 0;
-		auto doffset = optOutDirs ? optOutDirs->size() : 0;
-		auto searchPath = util::Path::CreatePath(FileManager::GetCanonicalizedPath(path.GetString() + ufile::get_path_from_filename(npath)));
-		FileManager::FindSystemFiles((searchPath.GetString() + ufile::get_file_from_filename(npath)).c_str(), optOutFiles, optOutDirs);
-		if(keepAbsPaths) {
-			if(optOutFiles) {
-				for(auto i = foffset; i < optOutFiles->size(); ++i)
-					(*optOutFiles)[i] = (searchPath + util::Path::CreateFile((*optOutFiles)[i])).GetString();
-			}
-			if(optOutDirs) {
-				for(auto i = doffset; i < optOutDirs->size(); ++i)
-					(*optOutDirs)[i] = (searchPath + util::Path::CreateFile((*optOutDirs)[i])).GetString();
+		if(pattern.HasWildcardDirectories()) {
+			// Paths are matched relative to the first directory containing a wildcard. The pattern is lowercase, so the
+			// directory is taken from the search path to find it on case-sensitive file systems.
+			auto literalDir = pattern.GetLiteralDirectory(searchPath);
+			auto rootPath = util::Path::CreatePath(FileManager::GetCanonicalizedPath(path.GetString() + (literalDir.has_value() ? *literalDir : pattern.GetLiteralDirectory())));
+			auto &components = pattern.GetComponents();
+			auto recursive = std::any_of(components.begin(), components.end(), [](const GlobPattern::Component &component) { return component.recursive; });
+			auto maxDepth = static_cast<int>(components.size() - pattern.GetLiteralDirectoryCount()) - 1;
+			auto rootPathStr = rootPath.GetString();
+			std::error_code ec;
+			for(std::filesystem::recursive_directory_iterator it {rootPathStr, ec}, end; ec == std::error_code {} && it != end; it.increment(ec)) {
+				if(recursive == false && it.depth() >= maxDepth)
+					it.disable_recursion_pending();
+				auto relPath = it->path().generic_string().substr(rootPathStr.length());
+				if(pattern.Matches(relPath, pattern.GetLiteralDirectoryCount()) == false)
+					continue;
+				// A separate error code is used, otherwise a failed status query would end the iteration
+				std::error_code ecStatus;
+				auto isDirectory = it->is_directory(ecStatus);
+				if(ecStatus)
+					continue;
+				if(relPath.empty() == false && relPath.front() == '/')
+					relPath.erase(relPath.begin());
+				callback(keepAbsPaths ? (rootPath + util::Path::CreateFile(relPath)).GetString() : std::move(relPath), isDirectory);
 			}
+			continue;
 		}
+		files.clear();
+		dirs.clear();
+		auto dirPath = util::Path::CreatePath(FileManager::GetCanonicalizedPath(path.GetString() + ufile::get_path_from_filename(searchPath)));
+		FileManager::FindSystemFiles((dirPath.GetString() + ufile::get_file_from_filename(searchPath)).c_str(), &files, &dirs);
+		for(auto &f : files)
+			callback(keepAbsPaths ? (dirPath + util::Path::CreateFile(f)).GetString() : std::move(f), false);
+		for(auto &d : dirs)
+			callback(keepAbsPaths ? (dirPath + util::Path::CreateFile(d)).GetString() : std::move(d), true);
 	}
-	if(keepAbsPaths)
-		return;
-	npath = GameMountManager::GetNormalizedPath(npath);
-	const auto fSearchArchive = [optOutFiles, optOutDirs, &npath](const auto &data) {
-		util::Path archPath {npath};
-		auto pathList = archPath.ToComponents();
-		auto itBegin = pathList.begin();
-		auto itEnd = pathList.end();
-		for(auto &arch : data) {
-			auto *dir = &arch.root;
-			for(auto it = itBegin; it != itEnd; ++it) {
-				auto &d = *it;
-				if(it == itEnd - 1) {
-					for(auto &child : dir->children) {
-						if(ustring::match(child.name, d) == false)
-							continue;
-						if(child.directory == false) {
-							if(optOutFiles != nullptr)
-								optOutFiles->push_back(child.name);
-						}
-						else {
-							if(optOutDirs != nullptr)
-								optOutDirs->push_back(child.name);
-						}
-					}
-				}
-				else {
-					auto itChild = std::find_if(dir->children.begin(), dir->children.end(), [&d](const decltype(*dir) &dirSub) { return (dirSub.directory == true && ustring::match(dirSub.name, d) == true) ? true : false; });
-					if(itChild == dir->children.end())
-						break;
-					dir = &(*itChild);
-				}
-			}
-		}
-	};
-	fSearchArchive(m_archives);
 }
-VFilePtr pragma::gamemount::BaseMountedGame::Load(const std::string &fileName, std::optional<std::string> *optOutSourcePath)
+VFilePtr pragma::gamemount::BaseMountedGame::Load(const std::string &fileName, std::optional<std::string> *optOutSourcePath, bool streamed)
 {
 	if(should_log(util::LogSeverity::Trace))
 		log("[" + GetIdentifier() + "] Loading file '" + fileName + "'...", util::LogSeverity::Trace);
-	auto npath = fileName;
-	switch(m_gameEngine) {
-	case GameEngine::SourceEngine:
-	case GameEngine::Source2:
-		npath = GameMountManager::GetNormalizedSourceEnginePath(npath);
-		break;
-#ifdef ENABLE_BETHESDA_FORMATS
-	case GameEngine::Gamebryo:
-	case GameEngine::CreationEngine:
-		npath = GameMountManager::GetNormalizedGamebryoPath(npath);
-		break;
-#endif
+	auto indexPath = GetIndexPath(fileName);
+	if(MayContain(indexPath) == false) {
+		if(should_log(util::LogSeverity::Trace))
+			log("[" + GetIdentifier() + "] File is not part of this game!", util::LogSeverity::Trace);
+		return nullptr;
 	}
+	auto npath = GetSearchPath(fileName);
 
 	for(auto &path : GetMountedPaths()) {
 		auto filePath = path;
@@ -343,97 +1206,512 @@ VFilePtr pragma::gamemount::BaseMountedGame::Load(const std::string &fileName, s
 	}
 	if(should_log(util::LogSeverity::Trace))
 		log("[" + GetIdentifier() + "] File not found on disk within mounted games!", util::LogSeverity::Trace);
-	auto data = std::make_shared<std::vector<uint8_t>>();
-	if(Load(fileName, *data) == false)
+	auto *entries = FindArchiveFile(indexPath);
+	if(entries == nullptr)
+		return nullptr;
+	for(auto &entry : *entries) {
+		auto f = OpenFromArchive(entry.archiveIndex, fileName, streamed);
+		if(f == nullptr)
+			continue;
+		if(optOutSourcePath)
+			*optOutSourcePath = npath;
+		return f;
+	}
+	return nullptr;
+}
+VFilePtr pragma::gamemount::BaseMountedGame::OpenFromArchive(uint32_t archiveIdx, const std::string &fileName, bool streamed)
+{
+	if(archiveIdx >= m_archives.size())
+		return nullptr;
+	auto &archive = m_archives[archiveIdx];
+	auto &handle = archive.GetHandle();
+	if(handle == nullptr)
+		return nullptr;
+	switch(archive.type) {
+	case ArchiveType::Vpk:
+		{
+			auto pArchive = std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle);
+			auto *entry = pArchive->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return nullptr;
+			// Entries stored in one piece are referenced directly within the mapped archive
+			std::span<const uint8_t> view;
+			if(pArchive->GetView(*entry, view))
+				return std::make_shared<ArchiveEntryFile>(pArchive, view);
+			return std::make_shared<ArchiveEntryFile>([pArchive, entry = *entry](void *dst, size_t offset, size_t len) -> size_t { return pArchive->Read(entry, dst, offset, len); }, entry->GetSize());
+		}
+	case ArchiveType::HLLib:
+		{
+			auto pArchive = std::static_pointer_cast<pragma::gamemount::hl::Archive>(handle);
+			auto stream = pArchive->OpenFile(GameMountManager::GetNormalizedSourceEnginePath(fileName));
+			if(stream == nullptr)
+				return nullptr;
+			auto size = stream->GetSize();
+			return std::make_shared<ArchiveEntryFile>([stream = std::move(stream)](void *dst, size_t offset, size_t len) -> size_t { return stream->Read(dst, offset, len); }, size);
+		}
+#ifdef ENABLE_BETHESDA_FORMATS
+	case ArchiveType::Bsa:
+		{
+			// Uncompressed entries are referenced directly within the mapped archive
+			auto pArchive = std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle);
+			auto *entry = pArchive->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return nullptr;
+			std::span<const uint8_t> view;
+			if(pArchive->GetView(*entry, view))
+				return std::make_shared<ArchiveEntryFile>(pArchive, view);
+			if(streamed == false)
+				break;
+			auto stream = pArchive->OpenStream(*entry);
+			if(stream == nullptr)
+				break;
+			auto size = stream->GetSize();
+			return std::make_shared<ArchiveEntryFile>(make_stream_reader(pArchive, std::move(stream)), size);
+		}
+	case ArchiveType::Ba2:
+		{
+			if(streamed == false)
+				break;
+			auto ba2Handle = std::static_pointer_cast<Ba2Archive>(handle);
+			auto entryIdx = ba2Handle->FindEntry(GetIndexPath(fileName));
+			if(entryIdx.has_value() == false)
+				return nullptr;
+			auto stream = ba2Handle->OpenStream(*entryIdx);
+			if(stream == nullptr)
+				break;
+			auto size = stream->GetSize();
+			return std::make_shared<ArchiveEntryFile>(make_stream_reader(ba2Handle, std::move(stream)), size);
+		}
+#endif
+	default:
+		break;
+	}
+	// Compressed entries have to be decoded in full
+	if(g_entryCache.IsEnabled() == false) {
+		auto buffer = LoadPooledFromArchive(archiveIdx, fileName);
+		if(buffer == nullptr)
+			return nullptr;
+		auto view = buffer->GetSpan();
+		return std::make_shared<ArchiveEntryFile>(std::move(buffer), view);
+	}
+	auto data = LoadFromArchive(archiveIdx, fileName);
+	if(data == nullptr)
 		return nullptr;
-	if(optOutSourcePath)
-		*optOutSourcePath = npath;
-	FileManager::AddVirtualFile(npath, data);
-	return FileManager::OpenFile(npath.c_str(), "rb");
+	return std::make_shared<ArchiveEntryFile>(std::move(data));
 }
 bool pragma::gamemount::BaseMountedGame::Load(const std::string &fileName, std::vector<uint8_t> &data)
 {
 	if(should_log(util::LogSeverity::Trace))
 		log("[" + GetIdentifier() + "] Loading file '" + fileName + "' from mounted archives...", util::LogSeverity::Trace);
-	initialize(true);
 
+	auto *entries = FindArchiveFile(GetIndexPath(fileName));
+	if(entries) {
+		for(auto &entry : *entries) {
+			if(LoadFromArchive(entry.archiveIndex, fileName, data))
+				return true;
+		}
+	}
+	if(should_log(util::LogSeverity::Trace))
+		log("[" + GetIdentifier() + "] Not found in mounted archives...", util::LogSeverity::Trace);
+	return false;
+}
+bool pragma::gamemount::BaseMountedGame::LoadFromArchive(uint32_t archiveIdx, const std::string &fileName, std::vector<uint8_t> &data)
+{
+	if(g_entryCache.IsEnabled() == false)
+		return ReadFromArchive(archiveIdx, fileName, data);
+	auto buffer = LoadFromArchive(archiveIdx, fileName);
+	if(buffer == nullptr)
+		return false;
+	data = *buffer;
+	return true;
+}
+pragma::gamemount::EntryCache::Buffer pragma::gamemount::BaseMountedGame::LoadFromArchive(uint32_t archiveIdx, const std::string &fileName)
+{
+	if(archiveIdx >= m_archives.size())
+		return nullptr;
+	auto *handle = m_archives[archiveIdx].GetHandle().get();
+	if(handle == nullptr)
+		return nullptr;
+	auto indexPath = GetIndexPath(fileName);
+	auto buffer = g_entryCache.Find(handle, indexPath);
+	if(buffer)
+		return buffer;
+	auto data = std::make_shared<std::vector<uint8_t>>();
+	if(ReadFromArchive(archiveIdx, fileName, *data) == false)
+		return nullptr;
+	g_entryCache.Insert(handle, indexPath, data);
+	return data;
+}
+std::shared_ptr<pragma::gamemount::PooledBuffer> pragma::gamemount::BaseMountedGame::LoadPooledFromArchive(uint32_t archiveIdx, const std::string &fileName)
+{
+	if(g_entryCache.IsEnabled()) {
+		auto cached = LoadFromArchive(archiveIdx, fileName);
+		if(cached == nullptr)
+			return nullptr;
+		auto buffer = g_bufferPool->Acquire(cached->size());
+		if(cached->empty() == false)
+			memcpy(buffer->GetData(), cached->data(), cached->size());
+		return buffer;
+	}
+	std::shared_ptr<PooledBuffer> buffer = nullptr;
+	if(ReadFromArchive(archiveIdx, fileName, [&buffer](size_t size) -> uint8_t * {
+		   buffer = g_bufferPool->Acquire(size);
+		   return buffer->GetData();
+	   })
+	  == false)
+		return nullptr;
+	return buffer;
+}
+std::pair<uint32_t, uint64_t> pragma::gamemount::BaseMountedGame::GetDataLocation(uint32_t archiveIdx, const std::string &fileName) const
+{
+	if(archiveIdx >= m_archives.size())
+		return {0, 0};
+	auto &archive = m_archives[archiveIdx];
+	if(archive.type != ArchiveType::Vpk && archive.type != ArchiveType::Bsa)
+		return {0, 0};
+	auto &handle = archive.GetHandle();
+	if(handle == nullptr)
+		return {0, 0};
+	if(archive.type == ArchiveType::Bsa) {
+		auto *entry = std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle)->FindEntry(GetIndexPath(fileName));
+		if(entry == nullptr)
+			return {0, 0};
+		return {0, entry->offset};
+	}
+	auto *entry = std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle)->FindEntry(GetIndexPath(fileName));
+	if(entry == nullptr)
+		return {0, 0};
+	return {entry->archiveIndex, entry->offset};
+}
+bool pragma::gamemount::BaseMountedGame::ReadFromArchive(uint32_t archiveIdx, const std::string &fileName, std::vector<uint8_t> &data)
+{
+	return ReadFromArchive(archiveIdx, fileName, [&data](size_t size) -> uint8_t * {
+		data.resize(size);
+		return data.data();
+	});
+}
+bool pragma::gamemount::BaseMountedGame::ReadFromArchive(uint32_t archiveIdx, const std::string &fileName, const ReadAllocator &allocate)
+{
+	if(archiveIdx >= m_archives.size())
+		return false;
+	auto &archive = m_archives[archiveIdx];
+	auto &handle = archive.GetHandle();
+	if(handle == nullptr)
+		return false;
 	switch(m_gameEngine) {
 	case GameEngine::SourceEngine:
 	case GameEngine::Source2:
 		{
-			auto srcPath = GameMountManager::GetNormalizedSourceEnginePath(fileName);
-			for(auto &archive : m_archives) {
-				auto pArchive = std::static_pointer_cast<pragma::gamemount::hl::Archive>(archive.handle);
-				if(should_log(util::LogSeverity::Trace))
-					log("[" + GetIdentifier() + "] Checking archive '" + archive.identifier + "'...", util::LogSeverity::Trace);
-				auto stream = pArchive->OpenFile(srcPath);
-				if(stream == nullptr)
-					continue;
-				if(should_log(util::LogSeverity::Trace))
-					log("[" + GetIdentifier() + "] Found!", util::LogSeverity::Trace);
-				if(stream->Read(data) == true)
-					return true;
-				if(should_log(util::LogSeverity::Trace))
-					log("[" + GetIdentifier() + "] Failed to read data stream.", util::LogSeverity::Trace);
+			if(should_log(util::LogSeverity::Trace))
+				log("[" + GetIdentifier() + "] Checking archive '" + archive.identifier + "'...", util::LogSeverity::Trace);
+			if(archive.type == ArchiveType::Vpk) {
+				auto pArchive = std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle);
+				auto *entry = pArchive->FindEntry(GetIndexPath(fileName));
+				if(entry == nullptr)
+					return false;
+				size_t size = entry->GetSize();
+				auto *dst = allocate(size);
+				return dst && pArchive->Read(*entry, dst, 0, size) == size;
 			}
-			break;
+			auto srcPath = GameMountManager::GetNormalizedSourceEnginePath(fileName);
+			auto pArchive = std::static_pointer_cast<pragma::gamemount::hl::Archive>(handle);
+			auto stream = pArchive->OpenFile(srcPath);
+			if(stream == nullptr)
+				return false;
+			if(should_log(util::LogSeverity::Trace))
+				log("[" + GetIdentifier() + "] Found!", util::LogSeverity::Trace);
+			size_t size = stream->GetSize();
+			auto *dst = allocate(size);
+			if(dst && stream->Read(dst, 0, size) == size)
+				return true;
+			if(should_log(util::LogSeverity::Trace))
+				log("[" + GetIdentifier() + "] Failed to read data stream.", util::LogSeverity::Trace);
+			return false;
 		}
 #ifdef ENABLE_BETHESDA_FORMATS
 	case GameEngine::Gamebryo:
 		{
-			auto gamebyroPath = GameMountManager::GetNormalizedGamebryoPath(fileName);
-			for(auto &archive : m_archives) {
-				auto bsaHandle = std::static_pointer_cast<bsa_handle>(archive.handle);
-				bool result;
-				auto r = bsa_contains_asset(*bsaHandle, gamebyroPath.c_str(), &result);
-				if(r != LIBBSA_OK || result == false)
-					continue;
-				const uint8_t *pdata = nullptr;
-				std::size_t size = 0;
-				r = bsa_extract_asset_to_memory(*bsaHandle, gamebyroPath.c_str(), &pdata, &size);
-				if(r != LIBBSA_OK)
-					continue;
-				data.resize(size);
-				memcpy(data.data(), pdata, size);
-				return true;
-			}
-			break;
+			// Decompressed straight into the output buffer
+			auto bsaHandle = std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle);
+			auto *entry = bsaHandle->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return false;
+			auto size = bsaHandle->GetSize(*entry);
+			if(size.has_value() == false)
+				return false;
+			auto *dst = allocate(*size);
+			return dst && bsaHandle->Extract(*entry, {dst, *size});
 		}
 	case GameEngine::CreationEngine:
 		{
-			auto creationPath = GameMountManager::GetNormalizedGamebryoPath(fileName);
-			for(auto &archive : m_archives) {
-				auto ba2Handle = std::static_pointer_cast<BA2>(archive.handle);
-				auto it = std::find_if(ba2Handle->nameTable.begin(), ba2Handle->nameTable.end(), [&creationPath](const std::string &other) { return ustring::compare(other, creationPath, false); });
-				if(it == ba2Handle->nameTable.end())
-					continue;
-				data.clear();
-				if(ba2Handle->Extract(it - ba2Handle->nameTable.begin(), data) != 1)
-					continue;
+			auto ba2Handle = std::static_pointer_cast<Ba2Archive>(handle);
+			auto entryIdx = ba2Handle->FindEntry(GetIndexPath(fileName));
+			if(entryIdx.has_value() == false)
+				return false;
+			// Entries are copied or decompressed straight into the output buffer, textures behind their DDS header
+			auto *record = ba2Handle->GetRecord(*entryIdx);
+			if(auto *stored = record ? ba2Handle->GetStoredData(*record) : nullptr) {
+				auto *dst = allocate(record->size);
+				if(dst == nullptr)
+					return false;
+				if(record->size > 0)
+					memcpy(dst, stored, record->size);
 				return true;
 			}
-			break;
+			if(auto stream = ba2Handle->OpenStream(*entryIdx)) {
+				auto *dst = allocate(record->size);
+				return dst && stream->Read({dst, record->size}) == record->size && stream->HasFailed() == false;
+			}
+			std::vector<uint8_t> data;
+			if(ba2Handle->archive.Extract(*entryIdx, data) != 1)
+				return false;
+			auto *dst = allocate(data.size());
+			if(dst == nullptr)
+				return false;
+			if(data.empty() == false)
+				memcpy(dst, data.data(), data.size());
+			return true;
 		}
 #endif
 	}
-	if(should_log(util::LogSeverity::Trace))
-		log("[" + GetIdentifier() + "] Not found in mounted archives...", util::LogSeverity::Trace);
 	return false;
 }
-
-pragma::gamemount::GameMountManager::~GameMountManager()
-{
-	m_cancel = true;
-	if(m_loadThread.joinable())
-		m_loadThread.join();
-	hlShutdown();
-}
-
-std::vector<util::Path> pragma::gamemount::GameMountManager::FindSteamGamePaths(const std::string &relPath)
+std::optional<pragma::gamemount::FileStat> pragma::gamemount::BaseMountedGame::StatArchiveFile(uint32_t archiveIdx, const std::string &fileName) const
 {
-	if(should_log(util::LogSeverity::Info))
-		log("Searching for steam game path '" + relPath + "'...", util::LogSeverity::Info);
-
+	if(archiveIdx >= m_archives.size())
+		return {};
+	auto &archive = m_archives[archiveIdx];
+	auto &handle = archive.GetHandle();
+	if(handle == nullptr)
+		return {};
+	FileStat stat {};
+	stat.archived = true;
+	switch(archive.type) {
+	case ArchiveType::Vpk:
+		{
+			auto *entry = std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle)->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return {};
+			stat.size = stat.storedSize = entry->GetSize();
+			return stat;
+		}
+	case ArchiveType::HLLib:
+		{
+			auto stream = std::static_pointer_cast<pragma::gamemount::hl::Archive>(handle)->OpenFile(GameMountManager::GetNormalizedSourceEnginePath(fileName));
+			if(stream == nullptr)
+				return {};
+			stat.size = stat.storedSize = stream->GetSize();
+			return stat;
+		}
+#ifdef ENABLE_BETHESDA_FORMATS
+	case ArchiveType::Bsa:
+		{
+			auto bsaHandle = std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle);
+			auto *entry = bsaHandle->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return {};
+			auto size = bsaHandle->GetSize(*entry);
+			auto storedSize = bsaHandle->GetStoredSize(*entry);
+			if(size.has_value() == false || storedSize.has_value() == false)
+				return {};
+			stat.size = *size;
+			stat.storedSize = *storedSize;
+			stat.compressed = entry->compressed;
+			return stat;
+		}
+	case ArchiveType::Ba2:
+		{
+			auto ba2Handle = std::static_pointer_cast<Ba2Archive>(handle);
+			auto entryIdx = ba2Handle->FindEntry(GetIndexPath(fileName));
+			if(entryIdx.has_value() == false)
+				return {};
+			auto *record = ba2Handle->GetRecord(*entryIdx);
+			if(record) {
+				stat.size = record->size;
+				stat.compressed = record->compressed;
+				stat.storedSize = record->storedSize;
+				return stat;
+			}
+			// The size of LZ4 texture entries is only known once they have been extracted
+			std::vector<uint8_t> data;
+			if(ba2Handle->archive.Extract(*entryIdx, data) != 1)
+				return {};
+			stat.size = stat.storedSize = data.size();
+			return stat;
+		}
+#endif
+	default:
+		break;
+	}
+	return {};
+}
+std::optional<size_t> pragma::gamemount::BaseMountedGame::ReadRangeFromArchive(uint32_t archiveIdx, const std::string &fileName, size_t offset, void *dst, size_t len) const
+{
+	if(archiveIdx >= m_archives.size())
+		return {};
+	auto &archive = m_archives[archiveIdx];
+	auto &handle = archive.GetHandle();
+	if(handle == nullptr)
+		return {};
+	switch(archive.type) {
+	case ArchiveType::Vpk:
+		{
+			auto pArchive = std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle);
+			auto *entry = pArchive->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return {};
+			return pArchive->Read(*entry, dst, offset, len);
+		}
+	case ArchiveType::HLLib:
+		{
+			auto stream = std::static_pointer_cast<pragma::gamemount::hl::Archive>(handle)->OpenFile(GameMountManager::GetNormalizedSourceEnginePath(fileName));
+			if(stream == nullptr)
+				return {};
+			return stream->Read(dst, offset, len);
+		}
+#ifdef ENABLE_BETHESDA_FORMATS
+	case ArchiveType::Bsa:
+		{
+			auto bsaHandle = std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle);
+			auto *entry = bsaHandle->FindEntry(GetIndexPath(fileName));
+			if(entry == nullptr)
+				return {};
+			return bsaHandle->Read(*entry, dst, offset, len);
+		}
+	case ArchiveType::Ba2:
+		{
+			auto ba2Handle = std::static_pointer_cast<Ba2Archive>(handle);
+			auto entryIdx = ba2Handle->FindEntry(GetIndexPath(fileName));
+			if(entryIdx.has_value() == false)
+				return {};
+			auto *record = ba2Handle->GetRecord(*entryIdx);
+			if(auto *stored = record ? ba2Handle->GetStoredData(*record) : nullptr) {
+				if(offset >= record->size)
+					return 0;
+				len = std::min<size_t>(len, record->size - offset);
+				memcpy(dst, stored + offset, len);
+				return len;
+			}
+			if(auto stream = ba2Handle->OpenStream(*entryIdx)) {
+				if(offset >= record->size)
+					return 0;
+				// Only the chunks that overlap the range are decompressed, up to the end of the range
+				if(stream->Skip(offset) != offset)
+					return {};
+				auto numRead = stream->Read({static_cast<uint8_t *>(dst), len});
+				if(stream->HasFailed())
+					return {};
+				return numRead;
+			}
+			// LZ4 entries have to be extracted in full
+			std::vector<uint8_t> data;
+			if(ba2Handle->archive.Extract(*entryIdx, data) != 1)
+				return {};
+			if(offset >= data.size())
+				return 0;
+			len = std::min(len, data.size() - offset);
+			memcpy(dst, data.data() + offset, len);
+			return len;
+		}
+#endif
+	default:
+		break;
+	}
+	return {};
+}
+std::optional<pragma::gamemount::FileStat> pragma::gamemount::BaseMountedGame::Stat(const std::string &fileName)
+{
+	auto indexPath = GetIndexPath(fileName);
+	if(MayContain(indexPath) == false)
+		return {};
+	auto npath = GetSearchPath(fileName);
+	for(auto &path : GetMountedPaths()) {
+		auto filePath = path;
+		filePath += npath;
+		auto f = FileManager::OpenSystemFile(filePath.GetString().c_str(), "rb");
+		if(f == nullptr)
+			continue;
+		FileStat stat {};
+		stat.size = stat.storedSize = f->GetSize();
+		return stat;
+	}
+	auto *entries = FindArchiveFile(indexPath);
+	if(entries == nullptr)
+		return {};
+	for(auto &entry : *entries) {
+		auto stat = StatArchiveFile(entry.archiveIndex, fileName);
+		if(stat.has_value())
+			return stat;
+	}
+	return {};
+}
+std::optional<size_t> pragma::gamemount::BaseMountedGame::ReadRange(const std::string &fileName, size_t offset, void *dst, size_t len)
+{
+	auto indexPath = GetIndexPath(fileName);
+	if(MayContain(indexPath) == false)
+		return {};
+	auto npath = GetSearchPath(fileName);
+	for(auto &path : GetMountedPaths()) {
+		auto filePath = path;
+		filePath += npath;
+		auto f = FileManager::OpenSystemFile(filePath.GetString().c_str(), "rb");
+		if(f == nullptr)
+			continue;
+		if(offset >= f->GetSize())
+			return 0;
+		f->Seek(offset);
+		return f->Read(dst, len);
+	}
+	auto *entries = FindArchiveFile(indexPath);
+	if(entries == nullptr)
+		return {};
+	for(auto &entry : *entries) {
+		auto numRead = ReadRangeFromArchive(entry.archiveIndex, fileName, offset, dst, len);
+		if(numRead.has_value())
+			return numRead;
+	}
+	return {};
+}
+bool pragma::gamemount::BaseMountedGame::Exists(const std::string &fileName) const
+{
+	auto indexPath = GetIndexPath(fileName);
+	if(MayContain(indexPath) == false)
+		return false;
+	return ExistsOnDisk(fileName) || ContainsArchiveFile(indexPath);
+}
+bool pragma::gamemount::BaseMountedGame::ExistsOnDisk(const std::string &fileName) const
+{
+	auto npath = GetSearchPath(fileName);
+	for(auto &path : GetMountedPaths()) {
+		auto filePath = path;
+		filePath += npath;
+		if(FileManager::IsSystemFile(filePath.GetString()))
+			return true;
+	}
+	return false;
+}
+
+pragma::gamemount::GameMountManager::~GameMountManager()
+{
+	m_cancel = true;
+	if(m_loadThread.joinable())
+		m_loadThread.join();
+	std::vector<MountThread> mountThreads;
+	{
+		std::scoped_lock lock {m_mountThreadMutex};
+		mountThreads = std::move(m_mountThreads);
+	}
+	for(auto &mountThread : mountThreads)
+		mountThread.thread.join();
+	if(m_initialized)
+		hlShutdown();
+}
+
+std::vector<util::Path> pragma::gamemount::GameMountManager::FindSteamGamePaths(const std::string &relPath)
+{
+	if(should_log(util::LogSeverity::Info))
+		log("Searching for steam game path '" + relPath + "'...", util::LogSeverity::Info);
+
 	auto rootRelPath = util::Path::CreatePath(relPath);
 	while(rootRelPath.GetComponentCount() > 2) // strip down to 'common/<game>'
 		rootRelPath.PopBack();
@@ -453,7 +1731,7 @@ std::vector<util::Path> pragma::gamemount::GameMountManager::FindSteamGamePaths(
 	return candidates;
 }
 
-void pragma::gamemount::GameMountManager::InitializeArchiveFileTable(pragma::gamemount::ArchiveFileTable::Item &archiveDir, const pragma::gamemount::hl::Archive::Directory &dir)
+void pragma::gamemount::GameMountManager::InitializeArchiveFileTable(pragma::gamemount::ArchiveFileTable &fileTable, ArchiveFileTable::NodeIndex archiveDir, const pragma::gamemount::hl::Archive::Directory &dir)
 {
 	std::vector<std::string> files;
 	std::vector<pragma::gamemount::hl::Archive::Directory> dirs;
@@ -467,17 +1745,27 @@ void pragma::gamemount::GameMountManager::InitializeArchiveFileTable(pragma::gam
 		}
 		return archFile.GetString();
 	};
-	archiveDir.children.reserve(archiveDir.children.size() + files.size() + dirs.size());
 	for(auto &f : files)
-		archiveDir.children.push_back({fConvertArchiveName(f), false});
+		fileTable.AddChild(archiveDir, fConvertArchiveName(f), false);
 	for(auto &d : dirs) {
-		archiveDir.children.push_back({fConvertArchiveName(d.GetPath()), true});
-		InitializeArchiveFileTable(archiveDir.children.back(), d);
+		auto name = fConvertArchiveName(d.GetPath());
+		if(name.empty()) {
+			// The contents of a top-level 'root' directory are indexed as part of the archive root, which is where
+			// hl::Archive::OpenFile looks for them as well. An empty component would make them unreachable.
+			if(archiveDir == fileTable.GetRoot()) {
+				InitializeArchiveFileTable(fileTable, archiveDir, d);
+				continue;
+			}
+			name = "root";
+		}
+		auto childIdx = fileTable.AddChild(archiveDir, name, true);
+		InitializeArchiveFileTable(fileTable, childIdx, d);
 	}
 }
 
-void pragma::gamemount::GameMountManager::MountWorkshopAddons(BaseMountedGame &game, SteamSettings::AppId appId)
+void pragma::gamemount::GameMountManager::AddWorkshopMountJobs(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx, std::vector<ArchiveMountJob> &outJobs)
 {
+	auto appId = mountInfo.steamSettings->appId;
 	for(auto &steamPath : g_steamRootPaths) {
 		auto path = steamPath + "/steamapps/workshop/content/" + std::to_string(appId) + "/";
 
@@ -485,33 +1773,24 @@ void pragma::gamemount::GameMountManager::MountWorkshopAddons(BaseMountedGame &g
 		FileManager::FindSystemFiles((path.GetString() + "*").c_str(), nullptr, &workshopAddonPaths, true);
 		if(should_log(util::LogSeverity::Info))
 			log("Mounting " + std::to_string(workshopAddonPaths.size()) + " workshop addons in '" + path.GetString() + "'...", util::LogSeverity::Info);
+		outJobs.reserve(outJobs.size() + workshopAddonPaths.size());
 		for(auto &workshopAddonPath : workshopAddonPaths) {
 			auto absWorkshopAddonPath = path + util::get_normalized_path(workshopAddonPath);
-			if(should_log(util::LogSeverity::Info))
-				log("Mounting workshop addon '" + absWorkshopAddonPath.GetString() + "'...", util::LogSeverity::Info);
-			// TODO
-
-			std::vector<std::string> vpkFilePaths {};
-			FileManager::FindSystemFiles((absWorkshopAddonPath.GetString() + "*.vpk").c_str(), &vpkFilePaths, nullptr, true);
-			if(should_log(util::LogSeverity::Info) && vpkFilePaths.empty() == false)
-				log("Found " + std::to_string(vpkFilePaths.size()) + " VPK archive files in workshop addon '" + path.GetString() + "'! Mounting...", util::LogSeverity::Info);
-			for(auto &vpkFilePath : vpkFilePaths) {
-				auto archive = pragma::gamemount::hl::Archive::Create(absWorkshopAddonPath.GetString() + vpkFilePath);
-				if(archive == nullptr)
-					continue;
-				if(should_log(util::LogSeverity::Info))
-					log("Mounting VPK archive '" + absWorkshopAddonPath.GetString() + vpkFilePath + "'...", util::LogSeverity::Info);
-				// TODO
-				//s_hlArchives.push_back(archive);
-				//traverse_vpk_archive(s_hlArchives.back().root,archive->GetRoot());
-			}
+			ArchiveMountJob job {};
+			job.gameMountInfoIndex = gameMountInfoIdx;
+			job.gameEngine = mountInfo.gameEngine;
+			job.name = "workshop/" + workshopAddonPath;
+			job.mountAllCandidates = true;
+			job.searchPattern = absWorkshopAddonPath.GetString() + "*.vpk";
+			job.workshop = true;
+			// Keeping thousands of addon archives open would exhaust the file handles
+			job.lazyHandle = true;
+			outJobs.push_back(std::move(job));
 		}
 	}
 }
 
-const std::vector<std::unique_ptr<pragma::gamemount::BaseMountedGame>> &pragma::gamemount::GameMountManager::GetMountedGames() const { return m_mountedGames; }
-
-void pragma::gamemount::GameMountManager::InitializeGame(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx)
+std::unique_ptr<pragma::gamemount::BaseMountedGame> pragma::gamemount::GameMountManager::CreateGame(const GameMountInfo &mountInfo, uint32_t gameMountInfoIdx, std::vector<ArchiveMountJob> &outJobs)
 {
 	// Determine absolute game path on disk
 	std::vector<std::string> absoluteGamePaths {};
@@ -546,34 +1825,31 @@ void pragma::gamemount::GameMountManager::InitializeGame(const GameMountInfo &mo
 	if(absoluteGamePaths.empty()) {
 		if(should_log(util::LogSeverity::Warning))
 			log("Unable to locate absolute game path for game '" + mountInfo.identifier + "'! Skipping...", util::LogSeverity::Warning);
-		return;
-	}
-	std::unique_ptr<BaseMountedGame> game = nullptr;
-	switch(mountInfo.gameEngine) {
-	case GameEngine::SourceEngine:
-		game = std::make_unique<SourceEngineMountedGame>(mountInfo.identifier, mountInfo.gameEngine);
-		break;
-	case GameEngine::Source2:
-		game = std::make_unique<Source2MountedGame>(mountInfo.identifier, mountInfo.gameEngine);
-		break;
-#ifdef ENABLE_BETHESDA_FORMATS
-	case GameEngine::Gamebryo:
-		game = std::make_unique<GamebryoMountedGame>(mountInfo.identifier, mountInfo.gameEngine);
-		break;
-	case GameEngine::CreationEngine:
-		game = std::make_unique<CreationEngineMountedGame>(mountInfo.identifier, mountInfo.gameEngine);
-		break;
-#endif
+		return nullptr;
 	}
+	auto game = BaseMountedGame::Create(mountInfo.identifier, mountInfo.gameEngine);
 	if(game == nullptr) {
 		if(should_log(util::LogSeverity::Warning))
 			log("Unsupported engine " + to_string(mountInfo.gameEngine) + " for game '" + mountInfo.identifier + "'! Skipping...", util::LogSeverity::Warning);
-		return;
+		return nullptr;
 	}
+	game->SetGameMountInfoIndex(gameMountInfoIdx);
 	for(auto &absPath : absoluteGamePaths)
 		game->MountPath(absPath);
 
-	// Load archive files
+	// Collect the archive files, which are opened by the mount workers
+	auto addJob = [&outJobs, &absoluteGamePaths, gameMountInfoIdx, &mountInfo](const std::string &name, const std::string &rootDir, bool mountAllCandidates) {
+		ArchiveMountJob job {};
+		job.gameMountInfoIndex = gameMountInfoIdx;
+		job.gameEngine = mountInfo.gameEngine;
+		job.name = name;
+		job.rootDir = rootDir;
+		job.mountAllCandidates = mountAllCandidates;
+		job.candidatePaths.reserve(absoluteGamePaths.size());
+		for(auto &absGamePath : absoluteGamePaths)
+			job.candidatePaths.push_back(util::Path {absGamePath + name});
+		outJobs.push_back(std::move(job));
+	};
 	switch(mountInfo.gameEngine) {
 	case pragma::gamemount::GameEngine::SourceEngine:
 	case pragma::gamemount::GameEngine::Source2:
@@ -582,34 +1858,8 @@ void pragma::gamemount::GameMountManager::InitializeGame(const GameMountInfo &mo
 			if(engineData) {
 				if(should_log(util::LogSeverity::Info))
 					log("Mounting " + std::to_string(engineData->vpkList.size()) + " VPK archive files for game '" + mountInfo.identifier + "'...", util::LogSeverity::Info);
-				for(auto &pair : engineData->vpkList) {
-					auto found = false;
-					for(auto &absGamePath : absoluteGamePaths) {
-						util::Path vpkPath {absGamePath + pair.first};
-						auto fileName = std::string {vpkPath.GetFileName()};
-						ustring::to_lower(fileName);
-						// pak01_dir is a common name across multiple Source Engine games, so it can appear multiple times
-						if(m_mountedVPKArchives.find(fileName) != m_mountedVPKArchives.end() && ustring::compare<std::string>(fileName, "pak01_dir.vpk", false) == false) {
-							if(should_log(util::LogSeverity::Info))
-								log("VPK '" + fileName + "' has already been loaded before! Ignoring...", util::LogSeverity::Info);
-							continue;
-						}
-
-						if(should_log(util::LogSeverity::Info))
-							log("Mounting VPK '" + vpkPath.GetString() + "'...", util::LogSeverity::Info);
-						auto archive = pragma::gamemount::hl::Archive::Create(vpkPath.GetString());
-						if(archive == nullptr)
-							continue;
-						found = true;
-						m_mountedVPKArchives.insert(std::make_pair(fileName, vpkPath));
-						archive->SetRootDirectory(pair.second.rootDir);
-						auto &fileTable = game->AddArchiveFileTable(fileName, archive);
-						InitializeArchiveFileTable(fileTable.root, archive->GetRoot());
-						break;
-					}
-					if(found == false && should_log(util::LogSeverity::Warning))
-						log("Unable to find VPK archive '" + pair.first + "' for game '" + mountInfo.identifier + "'!", util::LogSeverity::Warning);
-				}
+				for(auto &pair : engineData->vpkList)
+					addJob(pair.first, pair.second.rootDir, false);
 			}
 			break;
 		}
@@ -619,27 +1869,9 @@ void pragma::gamemount::GameMountManager::InitializeGame(const GameMountInfo &mo
 			auto *engineData = static_cast<pragma::gamemount::GamebryoSettings *>(mountInfo.engineSettings.get());
 			if(engineData) {
 				if(should_log(util::LogSeverity::Info))
-					log("Mounting " << engineData->bsaList.size() << " BSA archive files for game '" << mountInfo.identifier << "'...", util::LogSeverity::Info);
-				for(auto &pair : engineData->bsaList) {
-					auto found = false;
-					for(auto &absGamePath : absoluteGamePaths) {
-						util::Path bsaPath {absGamePath + pair.first};
-						if(should_log(util::LogSeverity::Info))
-							log("Mounting BSA '" << bsaPath.GetString() << "'...", util::LogSeverity::Info);
-
-						bsa_handle hBsa = nullptr;
-						auto r = bsa_open(&hBsa, bsaPath.GetString().c_str());
-						if(r != LIBBSA_OK)
-							continue;
-						found = true;
-						auto &fileTable = game->AddArchiveFileTable(std::make_shared<bsa_handle>(hBsa));
-						auto &assets = bsa_get_raw_assets(hBsa);
-						for(auto &asset : assets)
-							fileTable.root.Add(GetNormalizedGamebryoPath(asset.path), false);
-					}
-					if(found == false && IsVerbose())
-						log("Unable to find BSA archive '" << pair.first << "' for game '" << mountInfo.identifier << "'!", util::LogSeverity::Warning);
-				}
+					log("Mounting " + std::to_string(engineData->bsaList.size()) + " BSA archive files for game '" + mountInfo.identifier + "'...", util::LogSeverity::Info);
+				for(auto &pair : engineData->bsaList)
+					addJob(pair.first, "", true);
 			}
 			break;
 		}
@@ -648,70 +1880,851 @@ void pragma::gamemount::GameMountManager::InitializeGame(const GameMountInfo &mo
 			auto *engineData = static_cast<pragma::gamemount::CreationEngineSettings *>(mountInfo.engineSettings.get());
 			if(engineData) {
 				if(should_log(util::LogSeverity::Info))
-					log("Mounting " << engineData->ba2List.size() << " BA2 archive files for game '" << mountInfo.identifier << "'...", util::LogSeverity::Info);
-				for(auto &pair : engineData->ba2List) {
-					auto found = false;
-					for(auto &absGamePath : absoluteGamePaths) {
-						util::Path bsaPath {absGamePath + pair.first};
-						if(should_log(util::LogSeverity::Info))
-							log("Mounting BA2 '" << bsaPath.GetString() << "'...", util::LogSeverity::Info);
-
-						auto ba2 = std::make_shared<BA2>();
-						try {
-							if(ba2->Open(bsaPath.GetString().c_str()) == false)
-								continue;
-						}
-						catch(const std::exception &e) {
-							continue;
-						}
-						found = true;
-						auto &fileTable = game->AddArchiveFileTable(ba2);
-						for(auto &asset : ba2->nameTable)
-							fileTable.root.Add(GetNormalizedGamebryoPath(asset), false);
-					}
-					if(found == false && IsVerbose())
-						log("Unable to find BA2 archive '" << pair.first << "' for game '" << mountInfo.identifier << "'!", util::LogSeverity::Warning);
-				}
+					log("Mounting " + std::to_string(engineData->ba2List.size()) + " BA2 archive files for game '" + mountInfo.identifier + "'...", util::LogSeverity::Info);
+				for(auto &pair : engineData->ba2List)
+					addJob(pair.first, "", true);
 			}
 			break;
 		}
-#endif
+#endif
+	}
+
+	// Mount workshop
+	if(mountInfo.steamSettings.has_value() && mountInfo.steamSettings->mountWorkshop) {
+		if(mountInfo.steamSettings->appId != std::numeric_limits<pragma::gamemount::SteamSettings::AppId>::max())
+			AddWorkshopMountJobs(mountInfo, gameMountInfoIdx, outJobs);
+	}
+	if(m_lazyIndexing) {
+		for(auto &job : outJobs)
+			job.deferIndexing = true;
+		game->SetIndexWorkerCount(GetWorkerCount());
+	}
+	return game;
+}
+
+std::shared_ptr<void> pragma::gamemount::GameMountManager::OpenArchive(ArchiveType type, const std::string &path, const std::string &rootDir)
+{
+	switch(type) {
+	case ArchiveType::Vpk:
+		{
+			auto archive = pragma::gamemount::vpk::Archive::Create(path);
+			if(archive == nullptr)
+				return nullptr;
+			archive->SetRootDirectory(rootDir);
+			return archive;
+		}
+	case ArchiveType::HLLib:
+		{
+			auto archive = pragma::gamemount::hl::Archive::Create(path);
+			if(archive == nullptr)
+				return nullptr;
+			archive->SetRootDirectory(rootDir);
+			return archive;
+		}
+#ifdef ENABLE_BETHESDA_FORMATS
+	case ArchiveType::Bsa:
+		{
+			std::string err;
+			auto archive = pragma::gamemount::bsa::Archive::Create(path, &err);
+			if(archive == nullptr && should_log(util::LogSeverity::Warning))
+				log("Unable to open BSA archive '" + path + "': " + err + "!", util::LogSeverity::Warning);
+			return archive;
+		}
+	case ArchiveType::Ba2:
+		{
+			auto ba2 = std::make_shared<Ba2Archive>();
+			try {
+				if(ba2->archive.Open(path.c_str()) == false)
+					return nullptr;
+			}
+			catch(const std::exception &e) {
+				return nullptr;
+			}
+			ba2->BuildNameIndex();
+			ba2->LoadRecords(path);
+			return ba2;
+		}
+#endif
+	}
+	return nullptr;
+}
+
+void pragma::gamemount::GameMountManager::InitializeArchiveFileTable(ArchiveFileTable &fileTable)
+{
+	auto &handle = fileTable.GetHandle();
+	switch(fileTable.type) {
+	case ArchiveType::Vpk:
+		std::static_pointer_cast<pragma::gamemount::vpk::Archive>(handle)->GetFiles([&fileTable](std::string_view path, const vpk::Archive::Entry &entry) { fileTable.Add(path, false); });
+		break;
+	case ArchiveType::HLLib:
+		InitializeArchiveFileTable(fileTable, fileTable.GetRoot(), std::static_pointer_cast<pragma::gamemount::hl::Archive>(handle)->GetRoot());
+		break;
+#ifdef ENABLE_BETHESDA_FORMATS
+	case ArchiveType::Bsa:
+		{
+			// Paths are already normalized
+			std::static_pointer_cast<pragma::gamemount::bsa::Archive>(handle)->GetFiles([&fileTable](std::string_view path, const bsa::Archive::Entry &entry) { fileTable.Add(path, false); });
+			break;
+		}
+	case ArchiveType::Ba2:
+		for(auto &asset : std::static_pointer_cast<Ba2Archive>(handle)->archive.nameTable)
+			fileTable.Add(GetNormalizedGamebryoPath(asset), false);
+		break;
+#endif
+	}
+	fileTable.Finalize();
+}
+
+std::vector<pragma::gamemount::ArchiveType> pragma::gamemount::GameMountManager::GetArchiveTypes(GameEngine gameEngine)
+{
+	switch(gameEngine) {
+	case pragma::gamemount::GameEngine::SourceEngine:
+	case pragma::gamemount::GameEngine::Source2:
+		// Use the native reader if possible and fall back to HLLib for unsupported VPK versions
+		return {ArchiveType::Vpk, ArchiveType::HLLib};
+#ifdef ENABLE_BETHESDA_FORMATS
+	case pragma::gamemount::GameEngine::Gamebryo:
+		return {ArchiveType::Bsa};
+	case pragma::gamemount::GameEngine::CreationEngine:
+		return {ArchiveType::Ba2};
+#endif
+	}
+	return {};
+}
+
+std::optional<pragma::gamemount::ArchiveFileTable> pragma::gamemount::GameMountManager::IndexArchive(GameEngine gameEngine, const std::string &archivePath, const std::string &rootDir, bool lazyHandle)
+{
+	// The archive itself is only opened once a file is loaded from it
+	auto fileTable = g_indexCache.IsEnabled() ? g_indexCache.Load(archivePath, rootDir) : std::optional<ArchiveFileTable> {};
+	if(fileTable.has_value()) {
+		fileTable->SetHandleLoader([type = fileTable->type, archivePath, rootDir]() { return OpenArchive(type, archivePath, rootDir); });
+		if(should_log(util::LogSeverity::Debug))
+			log("Loaded file table of '" + archivePath + "' from index cache.", util::LogSeverity::Debug);
+		// Caches written before summaries existed only contain the file table
+		if(g_indexCache.HasSummary(archivePath, rootDir) == false)
+			g_indexCache.SaveSummary(archivePath, rootDir, ArchiveSummary::Create(*fileTable));
+		return fileTable;
+	}
+	for(auto type : GetArchiveTypes(gameEngine)) {
+		auto handle = OpenArchive(type, archivePath, rootDir);
+		if(handle == nullptr)
+			continue;
+		fileTable = ArchiveFileTable {handle};
+		fileTable->type = type;
+		InitializeArchiveFileTable(*fileTable);
+		if(g_indexCache.IsEnabled() && (g_indexCache.Save(archivePath, rootDir, *fileTable) == false || g_indexCache.SaveSummary(archivePath, rootDir, ArchiveSummary::Create(*fileTable)) == false) && should_log(util::LogSeverity::Warning))
+			log("Unable to write index cache for '" + archivePath + "'!", util::LogSeverity::Warning);
+		if(lazyHandle)
+			fileTable->SetHandleLoader([type, archivePath, rootDir]() { return OpenArchive(type, archivePath, rootDir); });
+		break;
+	}
+	return fileTable;
+}
+
+static std::string get_archive_type_name(pragma::gamemount::GameEngine gameEngine)
+{
+	switch(gameEngine) {
+	case pragma::gamemount::GameEngine::SourceEngine:
+	case pragma::gamemount::GameEngine::Source2:
+		return "VPK";
+#ifdef ENABLE_BETHESDA_FORMATS
+	case pragma::gamemount::GameEngine::Gamebryo:
+		return "BSA";
+	case pragma::gamemount::GameEngine::CreationEngine:
+		return "BA2";
+#endif
+	}
+	return {};
+}
+
+void pragma::gamemount::GameMountManager::ExecuteArchiveMountJob(ArchiveMountJob &job)
+{
+	auto archiveTypeName = get_archive_type_name(job.gameEngine);
+	if(archiveTypeName.empty() || job.duplicate)
+		return;
+	if(job.searchPattern.empty() == false) {
+		std::vector<std::string> files;
+		FileManager::FindSystemFiles(job.searchPattern.c_str(), &files, nullptr, true);
+		auto dir = ufile::get_path_from_filename(job.searchPattern);
+		for(auto &f : files) {
+			// The data files of multi-part archives (e.g. pak01_000.vpk) are opened through the directory file
+			if(is_vpk_data_file(f, files))
+				continue;
+			job.candidatePaths.push_back(util::Path {dir + f});
+		}
+	}
+	for(auto &candidatePath : job.candidatePaths) {
+		auto archivePath = candidatePath.GetString();
+		std::string identifier {candidatePath.GetFileName()};
+		if(job.gameEngine == GameEngine::SourceEngine || job.gameEngine == GameEngine::Source2)
+			ustring::to_lower(identifier);
+		// Different addons frequently use the same archive names
+		if(job.workshop)
+			identifier = job.name + '/' + identifier;
+
+		if(job.deferIndexing) {
+			// Only the existence of the archive is recorded, it is indexed when the game is first accessed
+			if(FileManager::IsSystemFile(archivePath) == false)
+				continue;
+			BaseMountedGame::DeferredArchive archive {};
+			archive.path = std::move(archivePath);
+			archive.identifier = std::move(identifier);
+			archive.rootDir = job.rootDir;
+			archive.lazyHandle = job.lazyHandle;
+			if(g_indexCache.IsEnabled())
+				archive.summary = g_indexCache.LoadSummary(archive.path, archive.rootDir);
+			job.deferredResults.push_back({candidatePath, std::move(archive)});
+		}
+		else {
+			if(should_log(util::LogSeverity::Info))
+				log("Mounting " + archiveTypeName + " '" + archivePath + "'...", util::LogSeverity::Info);
+			auto fileTable = IndexArchive(job.gameEngine, archivePath, job.rootDir, job.lazyHandle);
+			if(fileTable.has_value() == false)
+				continue;
+			fileTable->identifier = std::move(identifier);
+			job.results.push_back({candidatePath, std::move(*fileTable)});
+		}
+		if(job.mountAllCandidates == false)
+			break;
+	}
+}
+
+static std::string get_vpk_archive_name(const util::Path &path)
+{
+	std::string fileName {path.GetFileName()};
+	ustring::to_lower(fileName);
+	return fileName;
+}
+
+bool pragma::gamemount::GameMountManager::RegisterVpkArchive(const ArchiveMountJob &job, const std::string &fileName, const util::Path &path, std::vector<std::pair<std::string, util::Path>> &outRegistered)
+{
+	if(job.IsDeduplicated() == false)
+		return true;
+	// The name may have been reserved for this game when the game that provided it was unmounted
+	auto itReserved = m_reservedVpkArchives.find(fileName);
+	if(itReserved != m_reservedVpkArchives.end() && itReserved->second == job.gameMountInfoIndex)
+		m_reservedVpkArchives.erase(itReserved);
+	// pak01_dir is a common name across multiple Source Engine games, so it can appear multiple times
+	else if((m_mountedVPKArchives.find(fileName) != m_mountedVPKArchives.end() || itReserved != m_reservedVpkArchives.end()) && ustring::compare<std::string>(fileName, "pak01_dir.vpk", false) == false) {
+		if(should_log(util::LogSeverity::Info))
+			log("VPK '" + fileName + "' has already been loaded before! Ignoring...", util::LogSeverity::Info);
+		AddSkippedVpkArchive(job, {path});
+		return false;
+	}
+	if(m_mountedVPKArchives.insert(std::make_pair(fileName, path)).second)
+		outRegistered.push_back({fileName, path});
+	return true;
+}
+
+void pragma::gamemount::GameMountManager::AddSkippedVpkArchive(const ArchiveMountJob &job, std::vector<util::Path> candidatePaths)
+{
+	ArchiveMountJob skippedJob {};
+	skippedJob.gameMountInfoIndex = job.gameMountInfoIndex;
+	skippedJob.gameEngine = job.gameEngine;
+	skippedJob.name = job.name;
+	skippedJob.rootDir = job.rootDir;
+	skippedJob.lazyHandle = job.lazyHandle;
+	skippedJob.candidatePaths = std::move(candidatePaths);
+	m_skippedVpkArchives.push_back(std::move(skippedJob));
+}
+
+void pragma::gamemount::GameMountManager::FinalizeGame(std::unique_ptr<BaseMountedGame> game, std::vector<ArchiveMountJob> &jobs)
+{
+	auto gameMountInfoIdx = game->GetGameMountInfoIndex();
+	auto mountInfo = GetGameMountInfo(gameMountInfoIdx);
+	std::unique_lock vpkArchiveLock {m_vpkArchiveMutex};
+	std::vector<std::pair<std::string, util::Path>> registeredVpkArchives;
+	for(auto &job : jobs) {
+		if(job.results.empty() && job.deferredResults.empty()) {
+			// Workshop addons don't necessarily contain any archives
+			if(job.workshop || job.duplicate)
+				continue;
+			if(should_log(util::LogSeverity::Warning))
+				log("Unable to find " + get_archive_type_name(job.gameEngine) + " archive '" + job.name + "' for game '" + mountInfo.identifier + "'!", util::LogSeverity::Warning);
+			continue;
+		}
+		for(auto &[path, fileTable] : job.results) {
+			if(RegisterVpkArchive(job, fileTable.identifier, path, registeredVpkArchives))
+				game->AddArchiveFileTable(std::move(fileTable));
+		}
+		for(auto &[path, archive] : job.deferredResults) {
+			if(RegisterVpkArchive(job, archive.identifier, path, registeredVpkArchives))
+				game->AddDeferredArchive(std::move(archive));
+		}
+	}
+	vpkArchiveLock.unlock();
+	for(auto &[fileName, path] : registeredVpkArchives)
+		game->AddRegisteredVpkArchive(fileName, path);
+
+	// Games with deferred archives build their index and lookup filter once they are first accessed
+	if(game->HasDeferredArchives() == false) {
+		game->BuildPathIndex();
+		game->RebuildLookupFilter();
+	}
+	PublishGame(std::move(game));
+	SetGameState(gameMountInfoIdx, GameMountState::Ready, 1.f);
+}
+
+void pragma::gamemount::GameMountManager::MountGames(const std::vector<uint32_t> &gameMountInfoIndices)
+{
+	struct PendingGame {
+		std::unique_ptr<BaseMountedGame> game;
+		std::vector<ArchiveMountJob> jobs;
+		std::atomic<uint32_t> remainingJobs = 0;
+		// Copied from the game, which is moved out once it has been finalized
+		std::string identifier;
+		// Whether the game takes part in the VPK deduplication
+		bool registersVpkArchives = false;
+	};
+	// The game locations are resolved sequentially, since that only involves a few file system queries
+	std::vector<std::unique_ptr<PendingGame>> games;
+	games.reserve(gameMountInfoIndices.size());
+	for(auto idx : gameMountInfoIndices) {
+		if(m_cancel)
+			return;
+		SetGameState(idx, GameMountState::Mounting, 0.f);
+		auto pendingGame = std::make_unique<PendingGame>();
+		pendingGame->game = CreateGame(GetGameMountInfo(idx), idx, pendingGame->jobs);
+		if(pendingGame->game == nullptr) {
+			SetGameState(idx, GameMountState::Failed, 0.f);
+			continue;
+		}
+		pendingGame->remainingJobs = pendingGame->jobs.size();
+		pendingGame->identifier = pendingGame->game->GetIdentifier();
+		pendingGame->registersVpkArchives = std::any_of(pendingGame->jobs.begin(), pendingGame->jobs.end(), [](const ArchiveMountJob &job) { return job.IsDeduplicated(); });
+		games.push_back(std::move(pendingGame));
+	}
+
+	// Duplicate VPK archives are skipped before they are handed to a worker, so they are never opened or indexed.
+	// Names are claimed in mount order, the same order in which the games are finalized. Archives that don't exist
+	// don't claim their name, so a later game can still provide it. FinalizeGame checks the names once more, in
+	// case another batch of games has been mounted in the meantime.
+	{
+		std::unordered_set<std::string> claimedVpkArchives;
+		std::scoped_lock vpkArchiveLock {m_vpkArchiveMutex};
+		// Archives skipped by a previous mount of the same games are determined again
+		std::erase_if(m_skippedVpkArchives, [&gameMountInfoIndices](const ArchiveMountJob &job) { return std::find(gameMountInfoIndices.begin(), gameMountInfoIndices.end(), job.gameMountInfoIndex) != gameMountInfoIndices.end(); });
+		for(auto &game : games) {
+			for(auto &job : game->jobs) {
+				if(job.IsDeduplicated() == false || job.searchPattern.empty() == false || job.candidatePaths.empty())
+					continue;
+				auto fileName = get_vpk_archive_name(job.candidatePaths.front());
+				// pak01_dir is a common name across multiple Source Engine games, so it can appear multiple times
+				if(ustring::compare<std::string>(fileName, "pak01_dir.vpk", false))
+					continue;
+				auto itReserved = m_reservedVpkArchives.find(fileName);
+				auto reservedByOtherGame = (itReserved != m_reservedVpkArchives.end() && itReserved->second != job.gameMountInfoIndex);
+				if(m_mountedVPKArchives.find(fileName) != m_mountedVPKArchives.end() || reservedByOtherGame || claimedVpkArchives.find(fileName) != claimedVpkArchives.end()) {
+					if(should_log(util::LogSeverity::Info))
+						log("VPK '" + fileName + "' has already been loaded before! Ignoring...", util::LogSeverity::Info);
+					job.duplicate = true;
+					AddSkippedVpkArchive(job, job.candidatePaths);
+					continue;
+				}
+				if(std::any_of(job.candidatePaths.begin(), job.candidatePaths.end(), [](const util::Path &path) { return FileManager::IsSystemFile(path.GetString()); }))
+					claimedVpkArchives.insert(std::move(fileName));
+			}
+		}
+	}
+
+	// Games are published as soon as all of their archives have been indexed. Only games that register VPK archives
+	// are finalized in mount order, which keeps the VPK deduplication independent of the worker count.
+	std::vector<PendingGame *> orderedGames;
+	for(auto &game : games) {
+		if(game->registersVpkArchives)
+			orderedGames.push_back(game.get());
+	}
+	std::mutex finalizeMutex;
+	size_t nextOrderedGame = 0;
+	auto finalizeGames = [this, &orderedGames, &finalizeMutex, &nextOrderedGame](PendingGame &finishedGame) {
+		std::scoped_lock lock {finalizeMutex};
+		if(m_cancel)
+			return;
+		if(finishedGame.registersVpkArchives == false) {
+			FinalizeGame(std::move(finishedGame.game), finishedGame.jobs);
+			return;
+		}
+		while(nextOrderedGame < orderedGames.size() && orderedGames[nextOrderedGame]->remainingJobs == 0 && m_cancel == false) {
+			auto &pendingGame = *orderedGames[nextOrderedGame++];
+			FinalizeGame(std::move(pendingGame.game), pendingGame.jobs);
+		}
+	};
+	for(auto &game : games) {
+		if(game->remainingJobs == 0)
+			finalizeGames(*game);
+	}
+
+	// Opening and indexing the archives is the expensive part, which is distributed across the mount workers.
+	// The jobs are in mount order, so games with a higher priority become ready first.
+	std::vector<std::pair<PendingGame *, ArchiveMountJob *>> jobs;
+	for(auto &game : games) {
+		for(auto &job : game->jobs)
+			jobs.push_back({game.get(), &job});
+	}
+	auto numWorkers = std::min<size_t>(GetWorkerCount(), jobs.size());
+	std::atomic<size_t> nextJob = 0;
+	auto worker = [this, &jobs, &nextJob, &finalizeGames]() {
+		for(;;) {
+			if(m_cancel)
+				return;
+			auto jobIdx = nextJob++;
+			if(jobIdx >= jobs.size())
+				return;
+			auto &[pendingGame, job] = jobs[jobIdx];
+			ExecuteArchiveMountJob(*job);
+			// The game may be finalized by another worker as soon as the counter has been decremented, so only the
+			// copied identifier may be accessed afterwards
+			auto numJobs = pendingGame->jobs.size();
+			auto remainingJobs = --pendingGame->remainingJobs;
+			if(remainingJobs > 0) {
+				report_mount_progress(pendingGame->identifier, GameMountState::Mounting, static_cast<float>(numJobs - remainingJobs) / static_cast<float>(numJobs));
+				continue;
+			}
+			finalizeGames(*pendingGame);
+		}
+	};
+	std::vector<std::thread> workers;
+	workers.reserve(numWorkers);
+	for(auto i = decltype(numWorkers) {1u}; i < numWorkers; ++i) {
+		workers.push_back(std::thread {worker});
+		util::set_thread_name(workers.back(), "uarch_mount_worker");
+	}
+	worker();
+	for(auto &t : workers)
+		t.join();
+}
+
+void pragma::gamemount::GameMountManager::SetWorkerCount(uint32_t count) { m_workerCount = count; }
+uint32_t pragma::gamemount::GameMountManager::GetWorkerCount() const
+{
+	if(m_workerCount > 0)
+		return m_workerCount;
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+bool pragma::gamemount::GameMountManager::HasPrecedence(const BaseMountedGame &game0, const BaseMountedGame &game1) const
+{
+	if(game0.GetPriority() != game1.GetPriority())
+		return game0.GetPriority() > game1.GetPriority();
+	return game0.GetGameMountInfoIndex() < game1.GetGameMountInfoIndex();
+}
+
+std::shared_ptr<const pragma::gamemount::GameMountManager::GameList> pragma::gamemount::GameMountManager::GetMountedGames() const
+{
+	std::scoped_lock lock {m_gameListMutex};
+	return m_mountedGames;
+}
+
+std::vector<pragma::gamemount::GameMountInfo> pragma::gamemount::GameMountManager::GetGameMountInfos() const
+{
+	std::shared_lock lock {m_gameInfoMutex};
+	return m_mountedGameInfos;
+}
+
+pragma::gamemount::GameMountInfo pragma::gamemount::GameMountManager::GetGameMountInfo(uint32_t gameMountInfoIdx) const
+{
+	std::shared_lock lock {m_gameInfoMutex};
+	return m_mountedGameInfos[gameMountInfoIdx];
+}
+
+std::unordered_map<std::string, util::Path> pragma::gamemount::GameMountManager::GetMountedVpkArchives() const
+{
+	std::scoped_lock lock {m_vpkArchiveMutex};
+	return m_mountedVPKArchives;
+}
+
+void pragma::gamemount::GameMountManager::PublishGame(std::shared_ptr<BaseMountedGame> game)
+{
+	{
+		std::scoped_lock lock {m_gameListMutex};
+		// The priority may have changed while the game was being mounted
+		{
+			std::shared_lock infoLock {m_gameInfoMutex};
+			game->SetPriority(m_mountedGameInfos[game->GetGameMountInfoIndex()].priority);
+		}
+		auto games = std::make_shared<GameList>(*m_mountedGames);
+		auto it = std::upper_bound(games->begin(), games->end(), game, [this](const std::shared_ptr<BaseMountedGame> &game0, const std::shared_ptr<BaseMountedGame> &game1) { return HasPrecedence(*game0, *game1); });
+		games->insert(it, std::move(game));
+		m_mountedGames = std::move(games);
+	}
+	InvalidateUnionDirectoryIndices();
+}
+
+std::shared_ptr<const pragma::gamemount::DirectoryIndex> pragma::gamemount::GameMountManager::GetUnionDirectoryIndex(GameEngine gameEngine)
+{
+	// The lock is held while building, so an invalidation can't be overwritten by an index built from an older snapshot
+	std::scoped_lock lock {m_unionDirectoryIndexMutex};
+	auto games = GetMountedGames();
+	auto gameCount = static_cast<size_t>(std::count_if(games->begin(), games->end(), [gameEngine](const std::shared_ptr<BaseMountedGame> &game) { return game->GetGameEngine() == gameEngine && game->IsIndexed(); }));
+	auto it = m_unionDirectoryIndices.find(gameEngine);
+	if(it != m_unionDirectoryIndices.end() && it->second.gameCount == gameCount)
+		return it->second.index;
+	auto index = std::make_shared<DirectoryIndex>();
+	for(auto &game : *games) {
+		if(game->GetGameEngine() == gameEngine && game->IsIndexed())
+			index->AddDirectoryIndex(game->GetDirectoryIndex(), game->GetGameMountInfoIndex());
+	}
+	m_unionDirectoryIndices[gameEngine] = {index, gameCount};
+	return index;
+}
+
+void pragma::gamemount::GameMountManager::InvalidateUnionDirectoryIndices()
+{
+	std::scoped_lock lock {m_unionDirectoryIndexMutex};
+	m_unionDirectoryIndices.clear();
+}
+
+void pragma::gamemount::GameMountManager::FindFiles(const std::string &path, const std::shared_ptr<BaseMountedGame> &game, bool keepAbsPaths, const FindFilesCallback &callback)
+{
+	auto games = game ? std::make_shared<const GameList>(GameList {game}) : GetMountedGames();
+	// Files on disk are not part of the directory indices, so they have to be deduplicated separately
+	std::unordered_set<std::string> reportedFiles;
+	std::unordered_set<std::string> reportedDirs;
+	auto report = [&callback, &reportedFiles, &reportedDirs](std::string path, bool isDirectory) {
+		auto key = path;
+		ustring::to_lower(key);
+		if((isDirectory ? reportedDirs : reportedFiles).insert(std::move(key)).second)
+			callback(path, isDirectory);
+	};
+	for(auto &mountedGame : *games) {
+		mountedGame->FindSystemFiles(mountedGame->GetSearchPath(path), GlobPattern {mountedGame->GetIndexPath(path)}, keepAbsPaths, report);
+	}
+	if(keepAbsPaths)
+		return;
+
+	// Games that haven't been indexed yet are skipped if the summaries of their archives rule out the first directory of
+	// the pattern, everything else is indexed now. The union views only contain the games that have been indexed.
+	auto mayMatch = [&path](const BaseMountedGame &mountedGame) {
+		if(mountedGame.IsIndexed())
+			return true;
+		GlobPattern pattern {mountedGame.GetIndexPath(path)};
+		if(pattern.GetLiteralDirectoryCount() > 0 && mountedGame.MayContainDeferredRootDirectory(pattern.GetComponents().front().matcher.GetLiteralPrefix()) == false)
+			return false;
+		mountedGame.EnsureIndexed();
+		return true;
+	};
+	// Games using the same engine share a union view, which already contains every path only once
+	std::vector<std::pair<const BaseMountedGame *, std::shared_ptr<const DirectoryIndex>>> indices;
+	if(game) {
+		if(mayMatch(*game))
+			indices.push_back({game.get(), nullptr});
+	}
+	else {
+		for(auto &mountedGame : *games)
+			mayMatch(*mountedGame);
+		for(auto &mountedGame : *games) {
+			auto gameEngine = mountedGame->GetGameEngine();
+			auto it = std::find_if(indices.begin(), indices.end(), [gameEngine](const auto &pair) { return pair.first->GetGameEngine() == gameEngine; });
+			if(it == indices.end())
+				indices.push_back({mountedGame.get(), GetUnionDirectoryIndex(gameEngine)});
+		}
+	}
+	for(auto i = decltype(indices.size()) {0u}; i < indices.size(); ++i) {
+		auto &[indexGame, unionIndex] = indices[i];
+		auto &index = unionIndex ? *unionIndex : indexGame->GetDirectoryIndex();
+		GlobPattern pattern {indexGame->GetIndexPath(path)};
+		// Only the results of the last index don't have to be remembered
+		auto isLast = (i + 1 == indices.size());
+		index.Find(pattern, [&callback, &report, &reportedFiles, &reportedDirs, isLast](std::string_view path, const DirectoryIndex::Entry &entry) {
+			auto isDirectory = entry.IsDirectory();
+			if(isLast == false) {
+				report(std::string {path}, isDirectory);
+				return;
+			}
+			auto &reported = isDirectory ? reportedDirs : reportedFiles;
+			if(reported.empty() == false && reported.contains(std::string {path}))
+				return;
+			callback(path, isDirectory);
+		});
+	}
+}
+
+std::optional<int32_t> pragma::gamemount::GameMountManager::GetGamePriority(const std::string &identifier) const
+{
+	auto idx = FindGameMountInfoIndex(identifier);
+	if(idx.has_value() == false)
+		return {};
+	return GetGameMountInfo(*idx).priority;
+}
+
+void pragma::gamemount::GameMountManager::SetGamePriority(const std::string &identifier, int32_t priority)
+{
+	auto idx = FindGameMountInfoIndex(identifier);
+	if(idx.has_value() == false)
+		return;
+	{
+		std::scoped_lock lock {m_gameListMutex};
+		{
+			std::unique_lock infoLock {m_gameInfoMutex};
+			m_mountedGameInfos[*idx].priority = priority;
+		}
+		auto games = std::make_shared<GameList>(*m_mountedGames);
+		for(auto &game : *games) {
+			if(game->GetGameMountInfoIndex() == *idx)
+				game->SetPriority(priority);
+		}
+		std::stable_sort(games->begin(), games->end(), [this](const std::shared_ptr<BaseMountedGame> &game0, const std::shared_ptr<BaseMountedGame> &game1) { return HasPrecedence(*game0, *game1); });
+		m_mountedGames = std::move(games);
+	}
+	InvalidateUnionDirectoryIndices();
+	UpdateMountOrder();
+}
+
+void pragma::gamemount::GameMountManager::UpdateMountOrder()
+{
+	std::shared_lock infoLock {m_gameInfoMutex};
+	std::vector<uint32_t> mountOrder;
+	mountOrder.reserve(m_mountedGameInfos.size());
+	for(auto i = decltype(m_mountedGameInfos.size()) {0u}; i < m_mountedGameInfos.size(); ++i)
+		mountOrder.push_back(i);
+	std::stable_sort(mountOrder.begin(), mountOrder.end(), [this](uint32_t idx0, uint32_t idx1) { return m_mountedGameInfos[idx0].priority > m_mountedGameInfos[idx1].priority; });
+	std::vector<uint32_t> mountRanks(mountOrder.size());
+	for(auto i = decltype(mountOrder.size()) {0u}; i < mountOrder.size(); ++i)
+		mountRanks[mountOrder[i]] = i;
+
+	{
+		std::scoped_lock lock {m_stateMutex};
+		m_mountOrder = std::move(mountOrder);
+		m_mountRanks = std::move(mountRanks);
+		m_gameStates.resize(m_mountedGameInfos.size(), GameMountState::Pending);
+		++m_stateVersion;
+	}
+	m_stateCondition.notify_all();
+}
+
+void pragma::gamemount::GameMountManager::SetGameState(uint32_t gameMountInfoIdx, GameMountState state, float progress)
+{
+	{
+		std::scoped_lock lock {m_stateMutex};
+		m_gameStates[gameMountInfoIdx] = state;
+		++m_stateVersion;
+	}
+	m_stateCondition.notify_all();
+	report_mount_progress(GetGameMountInfo(gameMountInfoIdx).identifier, state, progress);
+}
+
+void pragma::gamemount::GameMountManager::FailUnfinishedGames(const std::vector<uint32_t> &gameMountInfoIndices)
+{
+	for(auto idx : gameMountInfoIndices) {
+		auto state = GameMountState::Failed;
+		{
+			std::scoped_lock lock {m_stateMutex};
+			state = m_gameStates[idx];
+		}
+		if(state == GameMountState::Pending || state == GameMountState::Mounting)
+			SetGameState(idx, GameMountState::Failed, 0.f);
 	}
+}
 
-	// Mount workshop
-	if(mountInfo.steamSettings.has_value()) {
-		if(mountInfo.steamSettings->appId != std::numeric_limits<pragma::gamemount::SteamSettings::AppId>::max())
-			MountWorkshopAddons(*game, mountInfo.steamSettings->appId);
+std::optional<pragma::gamemount::GameMountState> pragma::gamemount::GameMountManager::GetGameState(const std::string &identifier) const
+{
+	auto idx = FindGameMountInfoIndex(identifier);
+	if(idx.has_value() == false)
+		return {};
+	std::scoped_lock lock {m_stateMutex};
+	if(*idx >= m_gameStates.size())
+		return GameMountState::Pending;
+	return m_gameStates[*idx];
+}
+
+bool pragma::gamemount::GameMountManager::IsMountPending(uint32_t rank) const
+{
+	rank = std::min<uint32_t>(rank, m_mountOrder.size());
+	for(auto i = decltype(rank) {0u}; i < rank; ++i) {
+		auto state = m_gameStates[m_mountOrder[i]];
+		if(state == GameMountState::Pending || state == GameMountState::Mounting)
+			return true;
+	}
+	return false;
+}
+
+std::shared_ptr<const pragma::gamemount::GameMountManager::GameList> pragma::gamemount::GameMountManager::WaitForGames(const std::function<bool(const BaseMountedGame &)> &contains, const std::function<bool(const BaseMountedGame &)> &fallback)
+{
+	if(m_initialized == false)
+		return GetMountedGames();
+	std::unique_lock lock {m_stateMutex};
+	// Once nothing is mounting anymore the predicate can't change the result, which spares the caller a second lookup
+	if(IsMountPending(std::numeric_limits<uint32_t>::max()) == false) {
+		lock.unlock();
+		return GetMountedGames();
 	}
+	std::shared_ptr<BaseMountedGame> fallbackGame = nullptr;
+	auto fallbackEvaluated = false;
+	for(;;) {
+		// The predicates may query the file system, so they are evaluated without holding the lock
+		auto version = m_stateVersion;
+		lock.unlock();
+		auto games = GetMountedGames();
+		// The games are sorted by priority, so only the first game containing the file is relevant
+		auto itGame = std::find_if(games->begin(), games->end(), [&contains](const std::shared_ptr<BaseMountedGame> &game) { return contains(*game); });
+		if(itGame == games->end() && fallback && fallbackEvaluated == false) {
+			fallbackEvaluated = true;
+			auto it = std::find_if(games->begin(), games->end(), [&fallback](const std::shared_ptr<BaseMountedGame> &game) { return fallback(*game); });
+			if(it != games->end())
+				fallbackGame = *it;
+		}
+		// The game found by the fallback only counts as long as it is still mounted
+		auto itFallbackGame = (fallbackGame != nullptr) ? std::find(games->begin(), games->end(), fallbackGame) : games->end();
+		if(itFallbackGame < itGame)
+			itGame = itFallbackGame;
+		lock.lock();
+		if(m_stateVersion != version)
+			continue;
+		// If no game contains the file, it may still be provided by any of the games that are not ready yet
+		auto rank = (itGame != games->end()) ? m_mountRanks[(*itGame)->GetGameMountInfoIndex()] : std::numeric_limits<uint32_t>::max();
+		if(IsMountPending(rank) == false)
+			return games;
+		m_stateCondition.wait(lock, [this, version]() { return m_stateVersion != version; });
+	}
+}
 
-	game->SetGameMountInfoIndex(gameMountInfoIdx);
-	m_mountedGames.push_back(std::move(game));
+std::shared_ptr<const pragma::gamemount::GameMountManager::GameList> pragma::gamemount::GameMountManager::WaitForGames(const std::string &path)
+{
+	// The index path depends on the path convention of the game, as in FindArchives
+	std::array<std::optional<NormalizedPath>, 2> indexPaths;
+	auto getIndexPath = [&indexPaths, &path](const BaseMountedGame &game) -> const NormalizedPath & {
+		auto &indexPath = indexPaths[static_cast<size_t>(get_path_convention(game.GetGameEngine()))];
+		if(indexPath.has_value() == false)
+			indexPath.emplace(path, get_path_convention(game.GetGameEngine()));
+		return *indexPath;
+	};
+	return WaitForGames([&getIndexPath](const BaseMountedGame &game) { return game.ContainsArchiveFile(getIndexPath(game)); },
+	  [&getIndexPath, &path](const BaseMountedGame &game) { return game.MayContain(getIndexPath(game)) && game.ExistsOnDisk(path); });
+}
+
+std::shared_ptr<pragma::gamemount::BaseMountedGame> pragma::gamemount::GameMountManager::WaitForGame(const std::string &identifier)
+{
+	auto idx = FindGameMountInfoIndex(identifier);
+	if(idx.has_value() == false)
+		return nullptr;
+	if(m_initialized) {
+		std::unique_lock lock {m_stateMutex};
+		m_stateCondition.wait(lock, [this, idx]() { return *idx >= m_gameStates.size() || (m_gameStates[*idx] != GameMountState::Pending && m_gameStates[*idx] != GameMountState::Mounting); });
+	}
+	return FindMountedGameByIdentifier(identifier);
 }
 
-void pragma::gamemount::GameMountManager::UpdateGamePriorities()
+std::vector<pragma::gamemount::GameMountManager::ArchiveLocation> pragma::gamemount::GameMountManager::FindArchives(const std::string &path)
 {
-	auto &mountedGameInfos = GetGameMountInfos();
-	auto &mountedGames = m_mountedGames;
-	std::sort(mountedGames.begin(), mountedGames.end(), [&mountedGameInfos](const std::unique_ptr<pragma::gamemount::BaseMountedGame> &game0, const std::unique_ptr<pragma::gamemount::BaseMountedGame> &game1) {
-		auto &info0 = mountedGameInfos[game0->GetGameMountInfoIndex()];
-		auto &info1 = mountedGameInfos[game1->GetGameMountInfoIndex()];
-		return info0.priority > info1.priority;
+	// Source and Gamebryo paths are normalized differently, so the index path is determined once for each
+	std::array<std::optional<NormalizedPath>, 2> indexPaths;
+	auto getIndexPath = [&indexPaths, &path](const BaseMountedGame &game) -> const NormalizedPath & {
+		auto &indexPath = indexPaths[static_cast<size_t>(get_path_convention(game.GetGameEngine()))];
+		if(indexPath.has_value() == false)
+			indexPath.emplace(path, get_path_convention(game.GetGameEngine()));
+		return *indexPath;
+	};
+	auto games = WaitForGames([&getIndexPath](const BaseMountedGame &game) { return game.ContainsArchiveFile(getIndexPath(game)); });
+	std::vector<ArchiveLocation> archives;
+	for(auto &game : *games) {
+		auto *entries = game->FindArchiveFile(getIndexPath(*game));
+		if(entries == nullptr)
+			continue;
+		for(auto &entry : *entries)
+			archives.push_back({game, entry.archiveIndex});
+	}
+	return archives;
+}
+bool pragma::gamemount::GameMountManager::Load(const std::string &path, std::vector<uint8_t> &data)
+{
+	for(auto &location : FindArchives(path)) {
+		if(location.game->LoadFromArchive(location.archiveIndex, path, data))
+			return true;
+	}
+	return false;
+}
+std::vector<pragma::gamemount::EntryCache::Buffer> pragma::gamemount::GameMountManager::Load(const std::vector<std::string> &paths)
+{
+	std::vector<EntryCache::Buffer> results(paths.size());
+	struct Read {
+		uint32_t pathIndex;
+		ArchiveLocation archive;
+		std::pair<uint32_t, uint64_t> location;
+		bool hasAlternatives;
+	};
+	std::vector<Read> reads;
+	reads.reserve(paths.size());
+	for(auto i = decltype(paths.size()) {0u}; i < paths.size(); ++i) {
+		auto archives = FindArchives(paths[i]);
+		if(archives.empty())
+			continue;
+		auto &archive = archives.front();
+		auto location = archive.game->GetDataLocation(archive.archiveIndex, paths[i]);
+		reads.push_back({static_cast<uint32_t>(i), std::move(archive), location, archives.size() > 1});
+	}
+
+	// Read archive by archive, and within each archive in the order of the data files and offsets
+	std::sort(reads.begin(), reads.end(), [](const Read &a, const Read &b) {
+		auto gameIdx0 = a.archive.game->GetGameMountInfoIndex();
+		auto gameIdx1 = b.archive.game->GetGameMountInfoIndex();
+		if(gameIdx0 != gameIdx1)
+			return gameIdx0 < gameIdx1;
+		if(a.archive.archiveIndex != b.archive.archiveIndex)
+			return a.archive.archiveIndex < b.archive.archiveIndex;
+		if(a.location != b.location)
+			return a.location < b.location;
+		return a.pathIndex < b.pathIndex;
 	});
+	for(auto &read : reads) {
+		auto &path = paths[read.pathIndex];
+		results[read.pathIndex] = read.archive.game->LoadFromArchive(read.archive.archiveIndex, path);
+		// Fall back to the remaining archives if the preferred one could not be read
+		if(results[read.pathIndex] == nullptr && read.hasAlternatives)
+			results[read.pathIndex] = Load(path);
+	}
+	return results;
+}
+pragma::gamemount::EntryCache::Buffer pragma::gamemount::GameMountManager::Load(const std::string &path)
+{
+	for(auto &location : FindArchives(path)) {
+		auto buffer = location.game->LoadFromArchive(location.archiveIndex, path);
+		if(buffer)
+			return buffer;
+	}
+	return nullptr;
+}
+std::shared_ptr<pragma::gamemount::PooledBuffer> pragma::gamemount::GameMountManager::LoadPooled(const std::string &path)
+{
+	for(auto &location : FindArchives(path)) {
+		auto buffer = location.game->LoadPooledFromArchive(location.archiveIndex, path);
+		if(buffer)
+			return buffer;
+	}
+	return nullptr;
 }
 
 void pragma::gamemount::GameMountManager::WaitUntilInitializationComplete()
 {
-	if(m_loadThread.joinable())
-		m_loadThread.join();
+	if(m_initialized == false)
+		return;
+	std::unique_lock lock {m_stateMutex};
+	m_stateCondition.wait(lock, [this]() { return m_initComplete; });
+}
+bool pragma::gamemount::GameMountManager::IsInitializationComplete()
+{
+	std::scoped_lock lock {m_stateMutex};
+	return m_initComplete;
 }
 void pragma::gamemount::GameMountManager::Start()
 {
-	if(m_initialized)
-		return;
-	m_initialized = true;
-	m_loadThread = std::thread {[this]() {
-		hlInitialize();
-		
+	{
+		std::unique_lock lock {m_gameInfoMutex};
+		if(m_initialized)
+			return;
+		m_initialized = true;
+	}
+	hlInitialize();
+
+	// Games are mounted in the order of their priority, so lookups can be served as early as possible
+	UpdateMountOrder();
+	std::vector<uint32_t> mountOrder;
+	{
+		std::scoped_lock lock {m_stateMutex};
+		mountOrder = m_mountOrder;
+	}
+
+	m_loadThread = std::thread {[this, mountOrder = std::move(mountOrder)]() {
+		auto mounted = false;
 		if(!g_steamRootPaths.empty())
 		{
 			if(should_log(util::LogSeverity::Info)) {
@@ -720,11 +2733,8 @@ void pragma::gamemount::GameMountManager::Start()
 					log(path.GetString(), util::LogSeverity::Info);
 			}
 
-			for(auto i = decltype(m_mountedGameInfos.size()) {0u}; i < m_mountedGameInfos.size(); ++i) {
-				if(m_cancel)
-					break;
-				InitializeGame(m_mountedGameInfos[i], i);
-			}
+			MountGames(mountOrder);
+			mounted = true;
 
 			if(m_cancel == false) {
 				// Determine gmod addon paths
@@ -741,17 +2751,251 @@ void pragma::gamemount::GameMountManager::Start()
 #endif
 			}
 		}
+
+		// Games that have not been mounted at this point never will be
+		if(mounted == false || m_cancel)
+			FailUnfinishedGames(mountOrder);
+		{
+			std::scoped_lock lock {m_stateMutex};
+			m_initComplete = true;
+		}
+		m_stateCondition.notify_all();
 	}};
 	util::set_thread_name(m_loadThread, "uarch_game_mount");
 }
 
 bool pragma::gamemount::GameMountManager::MountGame(const GameMountInfo &mountInfo)
 {
-	if(m_initialized)
-		throw std::logic_error {"New games cannot be mounted after mount manager has been initialized!"};
-	if(m_mountedGameInfos.size() == m_mountedGameInfos.capacity())
-		m_mountedGameInfos.reserve(m_mountedGameInfos.size() * 1.5f + 50);
-	m_mountedGameInfos.push_back(mountInfo);
+	uint32_t gameMountInfoIdx = 0;
+	{
+		std::unique_lock lock {m_gameInfoMutex};
+		if(m_initialized == false) {
+			if(m_mountedGameInfos.size() == m_mountedGameInfos.capacity())
+				m_mountedGameInfos.reserve(m_mountedGameInfos.size() * 1.5f + 50);
+			m_mountedGameInfos.push_back(mountInfo);
+			return true;
+		}
+		auto it = std::find_if(m_mountedGameInfos.begin(), m_mountedGameInfos.end(), [&mountInfo](const GameMountInfo &other) { return ustring::compare(other.identifier, mountInfo.identifier, false); });
+		std::scoped_lock stateLock {m_stateMutex};
+		if(it != m_mountedGameInfos.end()) {
+			gameMountInfoIdx = it - m_mountedGameInfos.begin();
+			auto state = (gameMountInfoIdx < m_gameStates.size()) ? m_gameStates[gameMountInfoIdx] : GameMountState::Pending;
+			if(state != GameMountState::Unmounted && state != GameMountState::Failed) {
+				if(should_log(util::LogSeverity::Warning))
+					log("Game '" + mountInfo.identifier + "' is already mounted!", util::LogSeverity::Warning);
+				return false;
+			}
+			*it = mountInfo;
+		}
+		else {
+			gameMountInfoIdx = m_mountedGameInfos.size();
+			m_mountedGameInfos.push_back(mountInfo);
+		}
+		// The state has to be updated while the mount info is locked, otherwise the game could be mounted twice
+		if(gameMountInfoIdx >= m_gameStates.size())
+			m_gameStates.resize(gameMountInfoIdx + 1, GameMountState::Pending);
+		m_gameStates[gameMountInfoIdx] = GameMountState::Pending;
+		++m_stateVersion;
+	}
+	UpdateMountOrder();
+
+	// Only the new game is indexed, the games that are already mounted are not affected
+	auto started = StartMountThread([this, gameMountInfoIdx]() {
+		MountGames({gameMountInfoIdx});
+		if(m_cancel)
+			FailUnfinishedGames({gameMountInfoIdx});
+	});
+	if(started == false) {
+		FailUnfinishedGames({gameMountInfoIdx});
+		return false;
+	}
+	return true;
+}
+
+bool pragma::gamemount::GameMountManager::StartMountThread(const std::function<void()> &task)
+{
+	std::scoped_lock lock {m_mountThreadMutex};
+	if(m_cancel)
+		return false;
+	// Threads of previous mounts that have completed can be cleaned up
+	for(auto it = m_mountThreads.begin(); it != m_mountThreads.end();) {
+		if(*it->complete == false) {
+			++it;
+			continue;
+		}
+		it->thread.join();
+		it = m_mountThreads.erase(it);
+	}
+	MountThread mountThread {};
+	mountThread.complete = std::make_shared<std::atomic<bool>>(false);
+	mountThread.thread = std::thread {[task, complete = mountThread.complete]() {
+		task();
+		*complete = true;
+	}};
+	util::set_thread_name(mountThread.thread, "uarch_game_mount");
+	m_mountThreads.push_back(std::move(mountThread));
+	return true;
+}
+
+bool pragma::gamemount::GameMountManager::ExtendGame(const std::string &identifier, std::vector<ArchiveMountJob> &jobs)
+{
+	// The archives are indexed before the game is locked, so concurrent lookups and mounts are not held up
+	for(auto &job : jobs) {
+		if(m_cancel)
+			return false;
+		ExecuteArchiveMountJob(job);
+	}
+	auto gameMountInfoIdx = jobs.front().gameMountInfoIndex;
+	std::scoped_lock versionLock {m_gameVersionMutex};
+	auto game = WaitForGame(identifier);
+	std::vector<ArchiveFileTable> archives;
+	std::vector<std::pair<std::string, util::Path>> registeredVpkArchives;
+	{
+		std::scoped_lock vpkArchiveLock {m_vpkArchiveMutex};
+		for(auto &job : jobs) {
+			if(game == nullptr)
+				break;
+			if(job.results.empty() && job.duplicate == false && should_log(util::LogSeverity::Warning))
+				log("Unable to find " + get_archive_type_name(job.gameEngine) + " archive '" + job.name + "' for game '" + identifier + "'!", util::LogSeverity::Warning);
+			for(auto &[path, fileTable] : job.results) {
+				if(RegisterVpkArchive(job, fileTable.identifier, path, registeredVpkArchives))
+					archives.push_back(std::move(fileTable));
+			}
+		}
+		// Names that were reserved for the game, but could not be mounted, are available to any game again
+		for(auto &job : jobs) {
+			if(job.candidatePaths.empty())
+				continue;
+			auto it = m_reservedVpkArchives.find(get_vpk_archive_name(job.candidatePaths.front()));
+			if(it != m_reservedVpkArchives.end() && it->second == gameMountInfoIdx)
+				m_reservedVpkArchives.erase(it);
+		}
+	}
+	if(game == nullptr) {
+		if(should_log(util::LogSeverity::Warning))
+			log("Unable to mount archives for game '" + identifier + "': The game is not mounted!", util::LogSeverity::Warning);
+		return false;
+	}
+	if(archives.empty())
+		return false;
+
+	auto numArchives = archives.size();
+	auto newGame = game->Extend(std::move(archives), registeredVpkArchives);
+	{
+		std::scoped_lock lock {m_gameListMutex};
+		auto it = std::find(m_mountedGames->begin(), m_mountedGames->end(), game);
+		if(newGame == nullptr || it == m_mountedGames->end())
+			return false;
+		// The priority may have changed in the meantime
+		{
+			std::shared_lock infoLock {m_gameInfoMutex};
+			newGame->SetPriority(m_mountedGameInfos[newGame->GetGameMountInfoIndex()].priority);
+		}
+		auto games = std::make_shared<GameList>(*m_mountedGames);
+		(*games)[it - m_mountedGames->begin()] = newGame;
+		m_mountedGames = std::move(games);
+	}
+	InvalidateUnionDirectoryIndices();
+	if(should_log(util::LogSeverity::Info))
+		log("Mounted " + std::to_string(numArchives) + " additional archives for game '" + identifier + "'.", util::LogSeverity::Info);
+	return true;
+}
+
+bool pragma::gamemount::GameMountManager::MountGameArchives(const std::string &identifier, const std::string &path)
+{
+	auto gameMountInfoIdx = FindGameMountInfoIndex(identifier);
+	if(gameMountInfoIdx.has_value() == false)
+		return false;
+	auto gameEngine = GetGameMountInfo(*gameMountInfoIdx).gameEngine;
+	auto archiveTypeName = get_archive_type_name(gameEngine);
+	if(archiveTypeName.empty())
+		return false;
+	ArchiveMountJob job {};
+	job.gameMountInfoIndex = *gameMountInfoIdx;
+	job.gameEngine = gameEngine;
+	if(FileManager::IsSystemDir(path)) {
+		// Directories are mounted like the workshop addons that are found when the game is mounted
+		auto dirPath = util::Path::CreatePath(path);
+		auto dirName = dirPath.GetString();
+		while(dirName.empty() == false && dirName.back() == '/')
+			dirName.pop_back();
+		ustring::to_lower(archiveTypeName);
+		job.name = "workshop/" + ufile::get_file_from_filename(dirName);
+		job.mountAllCandidates = true;
+		job.searchPattern = dirPath.GetString() + "*." + archiveTypeName;
+		job.workshop = true;
+		job.lazyHandle = true;
+	}
+	else {
+		job.name = ufile::get_file_from_filename(path);
+		job.candidatePaths.push_back(util::Path::CreateFile(path));
+	}
+	std::vector<ArchiveMountJob> jobs;
+	jobs.push_back(std::move(job));
+	return ExtendGame(identifier, jobs);
+}
+
+bool pragma::gamemount::GameMountManager::UnmountGame(const std::string &identifier)
+{
+	std::unique_lock versionLock {m_gameVersionMutex};
+	auto game = WaitForGame(identifier);
+	if(game == nullptr)
+		return false;
+	{
+		// Readers that are still using the previous snapshot are not affected
+		std::scoped_lock lock {m_gameListMutex};
+		auto it = std::find(m_mountedGames->begin(), m_mountedGames->end(), game);
+		if(it == m_mountedGames->end())
+			return false;
+		auto games = std::make_shared<GameList>(*m_mountedGames);
+		games->erase(games->begin() + (it - m_mountedGames->begin()));
+		m_mountedGames = std::move(games);
+	}
+	versionLock.unlock();
+	InvalidateUnionDirectoryIndices();
+
+	// Archives that other games have skipped as duplicates of the released ones are mounted in their place. Each name is
+	// reserved for the game with the highest priority that has skipped it, so it can't be claimed by another game first.
+	auto gameMountInfoIdx = game->GetGameMountInfoIndex();
+	std::unordered_map<uint32_t, std::vector<ArchiveMountJob>> remountJobs;
+	{
+		std::vector<uint32_t> mountRanks;
+		{
+			std::scoped_lock stateLock {m_stateMutex};
+			mountRanks = m_mountRanks;
+		}
+		std::scoped_lock lock {m_vpkArchiveMutex};
+		std::erase_if(m_skippedVpkArchives, [gameMountInfoIdx](const ArchiveMountJob &job) { return job.gameMountInfoIndex == gameMountInfoIdx; });
+		for(auto &[fileName, path] : game->GetRegisteredVpkArchives()) {
+			auto it = m_mountedVPKArchives.find(fileName);
+			if(it == m_mountedVPKArchives.end() || it->second.GetString() != path.GetString())
+				continue;
+			m_mountedVPKArchives.erase(it);
+			auto itSkipped = m_skippedVpkArchives.end();
+			for(auto itJob = m_skippedVpkArchives.begin(); itJob != m_skippedVpkArchives.end(); ++itJob) {
+				if(itJob->candidatePaths.empty() || get_vpk_archive_name(itJob->candidatePaths.front()) != fileName)
+					continue;
+				if(itSkipped == m_skippedVpkArchives.end() || mountRanks[itJob->gameMountInfoIndex] < mountRanks[itSkipped->gameMountInfoIndex])
+					itSkipped = itJob;
+			}
+			if(itSkipped == m_skippedVpkArchives.end())
+				continue;
+			m_reservedVpkArchives[fileName] = itSkipped->gameMountInfoIndex;
+			remountJobs[itSkipped->gameMountInfoIndex].push_back(std::move(*itSkipped));
+			m_skippedVpkArchives.erase(itSkipped);
+		}
+	}
+	for(auto &[remountGameMountInfoIdx, jobs] : remountJobs) {
+		auto remountIdentifier = GetGameMountInfo(remountGameMountInfoIdx).identifier;
+		if(should_log(util::LogSeverity::Info))
+			log("Mounting " + std::to_string(jobs.size()) + " VPK archives for game '" + remountIdentifier + "' that have been released by game '" + identifier + "'...", util::LogSeverity::Info);
+		auto sharedJobs = std::make_shared<std::vector<ArchiveMountJob>>(std::move(jobs));
+		StartMountThread([this, remountIdentifier, sharedJobs]() { ExtendGame(remountIdentifier, *sharedJobs); });
+	}
+
+	SetGameState(gameMountInfoIdx, GameMountState::Unmounted, 0.f);
+	if(should_log(util::LogSeverity::Info))
+		log("Unmounted game '" + game->GetIdentifier() + "'.", util::LogSeverity::Info);
 	return true;
 }
 
@@ -763,6 +3007,7 @@ std::string pragma::gamemount::GameMountManager::GetNormalizedPath(const std::st
 	return cpy;
 }
 
+
 std::string pragma::gamemount::GameMountManager::GetNormalizedSourceEnginePath(const std::string &strPath)
 {
 	util::Path path {strPath};
@@ -800,6 +3045,8 @@ std::string pragma::gamemount::GameMountManager::GetNormalizedGamebryoPath(const
 #endif
 
 static std::unique_ptr<pragma::gamemount::GameMountManager> g_gameMountManager = nullptr;
+// Declared after the mount manager, so its workers are stopped before the manager is destroyed at exit
+static pragma::gamemount::IoPool g_ioPool;
 
 void pragma::gamemount::setup()
 {
@@ -816,28 +3063,35 @@ void pragma::gamemount::initialize(bool bWait)
 		g_gameMountManager->WaitUntilInitializationComplete();
 }
 
-void pragma::gamemount::initialize() { initialize(false); }
+void pragma::gamemount::initialize()
+{
+	setup();
+	initialize(false);
+}
 
 std::optional<int32_t> pragma::gamemount::get_mounted_game_priority(const std::string &gameIdentifier)
 {
 	setup();
-	initialize(true);
+	initialize(false);
 
-	auto *game = g_gameMountManager->FindMountedGameByIdentifier(gameIdentifier);
-	if(game == nullptr)
+	if(g_gameMountManager->WaitForGame(gameIdentifier) == nullptr)
 		return {};
-	return g_gameMountManager->GetGameMountInfos()[game->GetGameMountInfoIndex()].priority;
+	return g_gameMountManager->GetGamePriority(gameIdentifier);
 }
 void pragma::gamemount::set_mounted_game_priority(const std::string &gameIdentifier, int32_t priority)
 {
 	setup();
-	initialize(true);
+	initialize(false);
 
-	auto *game = g_gameMountManager->FindMountedGameByIdentifier(gameIdentifier);
-	if(game == nullptr)
+	if(g_gameMountManager->WaitForGame(gameIdentifier) == nullptr)
 		return;
-	const_cast<pragma::gamemount::GameMountInfo &>(g_gameMountManager->GetGameMountInfos()[game->GetGameMountInfoIndex()]).priority = priority;
-	g_gameMountManager->UpdateGamePriorities();
+	g_gameMountManager->SetGamePriority(gameIdentifier, priority);
+}
+
+std::optional<pragma::gamemount::GameMountState> pragma::gamemount::get_game_mount_state(const std::string &gameIdentifier)
+{
+	setup();
+	return g_gameMountManager->GetGameState(gameIdentifier);
 }
 
 bool pragma::gamemount::mount_game(const GameMountInfo &mountInfo)
@@ -845,32 +3099,51 @@ bool pragma::gamemount::mount_game(const GameMountInfo &mountInfo)
 	setup();
 	if(g_gameMountManager == nullptr)
 		return false;
-	g_gameMountManager->MountGame(mountInfo);
-	return true;
+	return g_gameMountManager->MountGame(mountInfo);
+}
+bool pragma::gamemount::unmount_game(const std::string &gameIdentifier)
+{
+	setup();
+	initialize(false);
+	return g_gameMountManager->UnmountGame(gameIdentifier);
+}
+
+bool pragma::gamemount::mount_game_archive(const std::string &gameIdentifier, const std::string &path)
+{
+	setup();
+	initialize(false);
+	return g_gameMountManager->MountGameArchives(gameIdentifier, path);
 }
 
-const std::unordered_map<std::string, util::Path> &pragma::gamemount::get_mounted_vpk_archives()
+std::unordered_map<std::string, util::Path> pragma::gamemount::get_mounted_vpk_archives()
 {
 	setup();
 	initialize(false);
 	return g_gameMountManager->GetMountedVpkArchives();
 }
 
-const std::vector<pragma::gamemount::GameMountInfo> &pragma::gamemount::get_game_mount_infos()
+std::vector<pragma::gamemount::GameMountInfo> pragma::gamemount::get_game_mount_infos()
 {
 	setup();
 	initialize(false);
 	return g_gameMountManager->GetGameMountInfos();
 }
 
-void pragma::gamemount::close() { g_gameMountManager = nullptr; }
+void pragma::gamemount::close()
+{
+	// Pending asynchronous loads are cancelled, running ones still need the mount manager
+	g_ioPool.Stop();
+	g_gameMountManager = nullptr;
+	// Cached entries are keyed by archive handles, which are no longer valid
+	g_entryCache.Flush();
+}
 
 bool pragma::gamemount::get_mounted_game_paths(const std::string &gameIdentifier, std::vector<std::string> &outPaths)
 {
 	setup();
-	initialize(true);
+	initialize(false);
 
-	auto *game = g_gameMountManager->FindMountedGameByIdentifier(gameIdentifier);
+	auto game = g_gameMountManager->WaitForGame(gameIdentifier);
 	if(game == nullptr)
 		return false;
 	auto &mountedPaths = game->GetMountedPaths();
@@ -880,56 +3153,239 @@ bool pragma::gamemount::get_mounted_game_paths(const std::string &gameIdentifier
 	return true;
 }
 
-bool pragma::gamemount::find_files(const std::string &fpath, std::vector<std::string> *files, std::vector<std::string> *dirs, bool keepAbsPaths, const std::optional<std::string> &gameIdentifier)
+bool pragma::gamemount::find_files(const std::string &fpath, const FindFilesCallback &callback, bool keepAbsPaths, const std::optional<std::string> &gameIdentifier)
 {
 	setup();
-	initialize(true);
-
 	if(g_gameMountManager == nullptr)
 		return false;
-	auto &mountedGames = g_gameMountManager->GetMountedGames();
 	if(gameIdentifier.has_value()) {
-		auto *game = g_gameMountManager->FindMountedGameByIdentifier(*gameIdentifier);
+		initialize(false);
+		auto game = g_gameMountManager->WaitForGame(*gameIdentifier);
 		if(game == nullptr)
 			return false;
-		game->FindFiles(fpath, files, dirs, keepAbsPaths);
+		g_gameMountManager->FindFiles(fpath, game, keepAbsPaths, callback);
 	}
 	else {
-		for(auto &game : mountedGames)
-			game->FindFiles(fpath, files, dirs, keepAbsPaths);
+		// The results of all games are merged, so all of them have to be mounted
+		initialize(true);
+		g_gameMountManager->FindFiles(fpath, nullptr, keepAbsPaths, callback);
 	}
 	return true;
 }
+bool pragma::gamemount::find_files(const std::string &fpath, std::vector<std::string> *files, std::vector<std::string> *dirs, bool keepAbsPaths, const std::optional<std::string> &gameIdentifier)
+{
+	return find_files(
+	  fpath,
+	  [files, dirs](std::string_view path, bool isDirectory) {
+		  auto *outList = isDirectory ? dirs : files;
+		  if(outList)
+			  outList->push_back(std::string {path});
+	  },
+	  keepAbsPaths, gameIdentifier);
+}
 
-VFilePtr pragma::gamemount::load(const std::string &path, std::optional<std::string> *optOutSourcePath, const std::optional<std::string> &gameIdentifier)
+static VFilePtr load_file(const std::string &path, std::optional<std::string> *optOutSourcePath, const std::optional<std::string> &gameIdentifier, bool streamed)
 {
-	setup();
-	initialize(true);
+	pragma::gamemount::setup();
+	pragma::gamemount::initialize(false);
 
 	if(gameIdentifier.has_value()) {
-		auto *game = g_gameMountManager->FindMountedGameByIdentifier(*gameIdentifier);
+		auto game = g_gameMountManager->WaitForGame(*gameIdentifier);
 		if(game == nullptr)
 			return nullptr;
-		return game->Load(path, optOutSourcePath);
+		return game->Load(path, optOutSourcePath, streamed);
 	}
-	for(auto &game : g_gameMountManager->GetMountedGames()) {
-		auto f = game->Load(path, optOutSourcePath);
+	auto games = g_gameMountManager->WaitForGames(path);
+	for(auto &game : *games) {
+		auto f = game->Load(path, optOutSourcePath, streamed);
 		if(f)
 			return f;
 	}
 	return nullptr;
 }
+VFilePtr pragma::gamemount::load(const std::string &path, std::optional<std::string> *optOutSourcePath, const std::optional<std::string> &gameIdentifier) { return load_file(path, optOutSourcePath, gameIdentifier, false); }
+VFilePtr pragma::gamemount::load_streamed(const std::string &path, std::optional<std::string> *optOutSourcePath, const std::optional<std::string> &gameIdentifier) { return load_file(path, optOutSourcePath, gameIdentifier, true); }
 
 bool pragma::gamemount::load(const std::string &path, std::vector<uint8_t> &data)
 {
 	setup();
-	initialize(true);
+	initialize(false);
+
+	return g_gameMountManager->Load(path, data);
+}
+
+std::shared_ptr<const std::vector<uint8_t>> pragma::gamemount::load_shared(const std::string &path)
+{
+	setup();
+	initialize(false);
+
+	return g_gameMountManager->Load(path);
+}
+
+std::vector<std::shared_ptr<const std::vector<uint8_t>>> pragma::gamemount::load_batch(const std::vector<std::string> &paths)
+{
+	setup();
+	initialize(false);
+
+	return g_gameMountManager->Load(paths);
+}
+
+std::shared_ptr<pragma::gamemount::PooledBuffer> pragma::gamemount::load_pooled(const std::string &path)
+{
+	setup();
+	initialize(false);
+
+	return g_gameMountManager->LoadPooled(path);
+}
+void pragma::gamemount::set_buffer_pool_capacity(size_t capacity) { g_bufferPool->SetCapacity(capacity); }
+size_t pragma::gamemount::get_buffer_pool_capacity() { return g_bufferPool->GetCapacity(); }
+void pragma::gamemount::flush_buffer_pool() { g_bufferPool->Flush(); }
+pragma::gamemount::BufferPoolStats pragma::gamemount::get_buffer_pool_stats() { return g_bufferPool->GetStats(); }
+
+pragma::gamemount::AsyncLoadRequest pragma::gamemount::load_async(const std::string &path, int32_t priority, const AsyncLoadCallback &callback)
+{
+	// Only starts mounting, waiting for it to complete is up to the I/O workers
+	setup();
+	initialize(false);
+
+	auto promise = std::make_shared<std::promise<AsyncLoadResult>>();
+	AsyncLoadRequest request {};
+	request.result = promise->get_future().share();
+	request.id = g_ioPool.Submit(priority, [path, callback, promise](bool cancelled) {
+		AsyncLoadResult result {};
+		if(cancelled)
+			result.status = AsyncLoadStatus::Cancelled;
+		else {
+			try {
+				result.data = g_gameMountManager->Load(path);
+				result.status = result.data ? AsyncLoadStatus::Complete : AsyncLoadStatus::NotFound;
+			}
+			catch(const std::exception &e) {
+				result.status = AsyncLoadStatus::Failed;
+				if(should_log(util::LogSeverity::Warning))
+					log("Asynchronous load of '" + path + "' failed: " + e.what(), util::LogSeverity::Warning);
+			}
+		}
+		promise->set_value(result);
+		if(callback)
+			g_ioPool.PostCompletion([path, callback, result = std::move(result)]() { callback(path, result); });
+	});
+	return request;
+}
+bool pragma::gamemount::cancel_async_load(AsyncLoadId id) { return g_ioPool.Cancel(id); }
+uint32_t pragma::gamemount::poll_async_loads(uint32_t maxCount) { return g_ioPool.PollCompletions(maxCount); }
+void pragma::gamemount::set_io_worker_count(uint32_t count) { g_ioPool.SetWorkerCount(count); }
+
+std::optional<pragma::gamemount::FileStat> pragma::gamemount::stat_file(const std::string &path, const std::optional<std::string> &gameIdentifier)
+{
+	setup();
+	initialize(false);
+
+	if(gameIdentifier.has_value()) {
+		auto game = g_gameMountManager->WaitForGame(*gameIdentifier);
+		if(game == nullptr)
+			return {};
+		return game->Stat(path);
+	}
+	auto games = g_gameMountManager->WaitForGames(path);
+	for(auto &game : *games) {
+		auto stat = game->Stat(path);
+		if(stat.has_value())
+			return stat;
+	}
+	return {};
+}
+
+std::optional<size_t> pragma::gamemount::read_range(const std::string &path, size_t offset, void *dst, size_t len, const std::optional<std::string> &gameIdentifier)
+{
+	setup();
+	initialize(false);
+
+	if(gameIdentifier.has_value()) {
+		auto game = g_gameMountManager->WaitForGame(*gameIdentifier);
+		if(game == nullptr)
+			return {};
+		return game->ReadRange(path, offset, dst, len);
+	}
+	auto games = g_gameMountManager->WaitForGames(path);
+	for(auto &game : *games) {
+		auto numRead = game->ReadRange(path, offset, dst, len);
+		if(numRead.has_value())
+			return numRead;
+	}
+	return {};
+}
+
+bool pragma::gamemount::exists(const std::string &path, const std::optional<std::string> &gameIdentifier)
+{
+	setup();
+	initialize(false);
 
-	for(auto &game : g_gameMountManager->GetMountedGames()) {
-		if(game->Load(path, data))
+	if(gameIdentifier.has_value()) {
+		auto game = g_gameMountManager->WaitForGame(*gameIdentifier);
+		return game && game->Exists(path);
+	}
+	auto games = g_gameMountManager->WaitForGames(path);
+	for(auto &game : *games) {
+		if(game->Exists(path))
 			return true;
 	}
 	return false;
 }
 
 void pragma::gamemount::set_steam_root_paths(const std::vector<util::Path> &paths) { g_steamRootPaths = paths; }
+
+void pragma::gamemount::set_mount_worker_count(uint32_t count)
+{
+	setup();
+	g_gameMountManager->SetWorkerCount(count);
+}
+
+void pragma::gamemount::set_lazy_archive_indexing(bool lazy)
+{
+	setup();
+	g_gameMountManager->SetLazyIndexing(lazy);
+}
+
+void pragma::gamemount::set_index_cache_path(const std::string &path) { g_indexCache.SetDirectory(path); }
+std::string pragma::gamemount::get_index_cache_path() { return g_indexCache.GetDirectory(); }
+
+void pragma::gamemount::invalidate_lookup_filter(const std::optional<std::string> &gameIdentifier)
+{
+	setup();
+	initialize(true);
+
+	if(gameIdentifier.has_value()) {
+		auto game = g_gameMountManager->FindMountedGameByIdentifier(*gameIdentifier);
+		if(game)
+			game->RebuildLookupFilter();
+		return;
+	}
+	for(auto &game : *g_gameMountManager->GetMountedGames())
+		game->RebuildLookupFilter();
+}
+
+void pragma::gamemount::set_cache_size(size_t size) { g_entryCache.SetCapacity(size); }
+size_t pragma::gamemount::get_cache_size() { return g_entryCache.GetCapacity(); }
+void pragma::gamemount::flush_cache() { g_entryCache.Flush(); }
+pragma::gamemount::CacheStats pragma::gamemount::get_cache_stats()
+{
+	auto stats = g_entryCache.GetStats();
+	CacheStats result {};
+	result.hits = stats.hits;
+	result.misses = stats.misses;
+	result.evictions = stats.evictions;
+	result.size = stats.size;
+	result.capacity = stats.capacity;
+	result.entryCount = stats.entryCount;
+	return result;
+}
+
+#ifdef UTIL_ARCHIVE_BENCHMARK
+std::string pragma::gamemount::benchmark::get_legacy_index_path(const std::string &path)
+{
+	auto indexPath = GameMountManager::GetNormalizedPath(GameMountManager::GetNormalizedSourceEnginePath(path));
+	std::replace(indexPath.begin(), indexPath.end(), '\\', '/');
+	return indexPath;
+}
+#endif
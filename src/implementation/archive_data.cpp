@@ -4,33 +4,272 @@
 
 module;
 
-#include <sharedutils/util_string.h>
-#include <sharedutils/util_path.hpp>
 #include <algorithm>
 #include <memory>
+#include <unordered_set>
+#include <string_view>
+#include <limits>
 
 module pragma.gamemount;
 
 import :archivedata;
 
-pragma::gamemount::ArchiveFileTable::Item::Item(const std::string &pname, bool pbDir) : name(pname), directory(pbDir) {}
-void pragma::gamemount::ArchiveFileTable::Item::Add(const std::string &fpath, bool bDir)
+struct pragma::gamemount::ArchiveFileTable::Builder {
+	struct Node {
+		uint32_t nameOffset = 0;
+		uint32_t nameLength = 0;
+		NodeIndex parent = INVALID_NODE;
+		bool directory = false;
+	};
+	struct DirectoryKey {
+		NodeIndex parent;
+		std::string_view name;
+	};
+	// Hash set of directory node indices, which can be queried by (parent, name) without allocating
+	struct DirectoryHash {
+		using is_transparent = void;
+		const Builder *builder;
+		size_t operator()(const DirectoryKey &key) const { return std::hash<std::string_view> {}(key.name) ^ (static_cast<size_t>(key.parent) * 0x9E3779B97F4A7C15ull); }
+		size_t operator()(NodeIndex idx) const { return operator()(builder->GetKey(idx)); }
+	};
+	struct DirectoryEqual {
+		using is_transparent = void;
+		const Builder *builder;
+		bool operator()(const DirectoryKey &a, NodeIndex b) const
+		{
+			auto keyB = builder->GetKey(b);
+			return a.parent == keyB.parent && a.name == keyB.name;
+		}
+		bool operator()(NodeIndex a, const DirectoryKey &b) const { return operator()(b, a); }
+		bool operator()(NodeIndex a, NodeIndex b) const { return a == b; }
+	};
+	Builder(const std::string &namePool) : namePool {&namePool}, directories {0, DirectoryHash {this}, DirectoryEqual {this}} {}
+	std::string_view GetName(const Node &node) const { return std::string_view {*namePool}.substr(node.nameOffset, node.nameLength); }
+	DirectoryKey GetKey(NodeIndex idx) const { return {nodes[idx].parent, GetName(nodes[idx])}; }
+	const std::string *namePool;
+	std::vector<Node> nodes;
+	std::unordered_set<NodeIndex, DirectoryHash, DirectoryEqual> directories;
+};
+
+pragma::gamemount::ArchiveFileTable::ArchiveFileTable(const std::shared_ptr<void> &phandle) : m_handleState {std::make_shared<HandleState>()}
 {
-	util::Path path {fpath};
-	auto pathList = path.ToComponents();
-	if(pathList.empty() == true)
-		return;
-	Add(pathList.data(), pathList.size() - 1, bDir);
+	m_handleState->handle = phandle;
+	m_handleState->loaded = true;
+}
+pragma::gamemount::ArchiveFileTable::ArchiveFileTable(ArchiveFileTable &&other) { operator=(std::move(other)); }
+pragma::gamemount::ArchiveFileTable &pragma::gamemount::ArchiveFileTable::operator=(ArchiveFileTable &&other)
+{
+	identifier = std::move(other.identifier);
+	type = other.type;
+	m_namePool = std::move(other.m_namePool);
+	m_nodes = std::move(other.m_nodes);
+	m_storage = std::move(other.m_storage);
+	m_nodeView = other.m_nodeView;
+	m_nameView = other.m_nameView;
+	m_handleState = std::move(other.m_handleState);
+	m_builder = std::move(other.m_builder);
+	if(m_builder)
+		m_builder->namePool = &m_namePool;
+	// Short names may be stored within the string object itself, so the views have to be updated
+	if(m_storage == nullptr)
+		UpdateViews();
+	return *this;
+}
+pragma::gamemount::ArchiveFileTable::~ArchiveFileTable() {}
+void pragma::gamemount::ArchiveFileTable::UpdateViews()
+{
+	m_nodeView = m_nodes;
+	m_nameView = m_namePool;
+}
+const std::shared_ptr<void> &pragma::gamemount::ArchiveFileTable::GetHandle() const
+{
+	auto &state = *m_handleState;
+	if(state.loaded.load(std::memory_order_acquire))
+		return state.handle;
+	std::scoped_lock lock {state.mutex};
+	if(state.loaded == false) {
+		if(state.loader)
+			state.handle = state.loader();
+		state.loader = nullptr;
+		state.loaded.store(true, std::memory_order_release);
+	}
+	return state.handle;
+}
+const void *pragma::gamemount::ArchiveFileTable::GetLoadedHandle() const
+{
+	auto &state = *m_handleState;
+	if(state.loaded.load(std::memory_order_acquire) == false)
+		return nullptr;
+	return state.handle.get();
+}
+void pragma::gamemount::ArchiveFileTable::SetHandleLoader(const HandleLoader &loader)
+{
+	auto &state = *m_handleState;
+	std::scoped_lock lock {state.mutex};
+	state.handle = nullptr;
+	state.loader = loader;
+	state.loaded = false;
+}
+void pragma::gamemount::ArchiveFileTable::SetData(const std::shared_ptr<const void> &storage, std::span<const Node> nodes, std::string_view namePool)
+{
+	m_builder = nullptr;
+	m_nodes.clear();
+	m_namePool.clear();
+	m_storage = storage;
+	m_nodeView = nodes;
+	m_nameView = namePool;
+}
+pragma::gamemount::ArchiveFileTable pragma::gamemount::ArchiveFileTable::Share(const std::shared_ptr<const void> &owner) const
+{
+	ArchiveFileTable table {nullptr};
+	table.identifier = identifier;
+	table.type = type;
+	// Tables that share externally provided data don't depend on the owner of this table
+	table.m_storage = m_storage ? m_storage : owner;
+	table.m_nodeView = m_nodeView;
+	table.m_nameView = m_nameView;
+	table.m_handleState = m_handleState;
+	++m_handleState->shareCount;
+	return table;
+}
+bool pragma::gamemount::ArchiveFileTable::ReleaseShare() { return --m_handleState->shareCount == 0; }
+pragma::gamemount::ArchiveFileTable::Builder &pragma::gamemount::ArchiveFileTable::GetBuilder()
+{
+	if(m_builder == nullptr) {
+		m_builder = std::make_unique<Builder>(m_namePool);
+		m_builder->nodes.push_back({0, 0, INVALID_NODE, true});
+	}
+	return *m_builder;
 }
-void pragma::gamemount::ArchiveFileTable::Item::Add(const std::string *path, uint32_t dirCount, bool bDir)
+void pragma::gamemount::ArchiveFileTable::Add(std::string_view fpath, bool bDir)
 {
-	auto it = std::find_if(children.begin(), children.end(), [path](const Item &item) { return (item.name == *path) ? true : false; });
-	if(it == children.end()) {
-		children.push_back({*path, (dirCount > 0) ? true : bDir});
-		it = children.end() - 1;
+	constexpr std::string_view separators = "/\\";
+	auto parent = GetRoot();
+	size_t start = 0;
+	while(start < fpath.size()) {
+		auto end = fpath.find_first_of(separators, start);
+		if(end == std::string_view::npos)
+			end = fpath.size();
+		auto component = fpath.substr(start, end - start);
+		start = end + 1;
+		if(component.empty() || component == ".")
+			continue;
+		auto isLast = (fpath.find_first_not_of(separators, end) == std::string_view::npos);
+		parent = AddChild(parent, component, isLast ? bDir : true);
 	}
-	if(dirCount == 0)
+}
+pragma::gamemount::ArchiveFileTable::NodeIndex pragma::gamemount::ArchiveFileTable::AddChild(NodeIndex parent, std::string_view name, bool bDir)
+{
+	// Directories are deduplicated and share their names in the pool. File names are mostly unique,
+	// so duplicate files are only removed when the table is finalized.
+	auto &builder = GetBuilder();
+	if(bDir) {
+		auto it = builder.directories.find(Builder::DirectoryKey {parent, name});
+		if(it != builder.directories.end())
+			return *it;
+	}
+	auto offset = m_namePool.size();
+	m_namePool += name;
+	auto idx = static_cast<NodeIndex>(builder.nodes.size());
+	builder.nodes.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(name.length()), parent, bDir});
+	if(bDir)
+		builder.directories.insert(idx);
+	return idx;
+}
+void pragma::gamemount::ArchiveFileTable::Finalize()
+{
+	if(m_builder == nullptr && m_nodeView.empty() == false)
+		return;
+	auto &builder = GetBuilder();
+	auto &buildNodes = builder.nodes;
+	m_nameView = m_namePool;
+
+	// Group all nodes by parent (counting sort), then sort each group by name
+	std::vector<uint32_t> groupStart(buildNodes.size() + 1, 0);
+	for(auto i = decltype(buildNodes.size()) {1u}; i < buildNodes.size(); ++i)
+		++groupStart[buildNodes[i].parent + 1];
+	for(auto i = decltype(buildNodes.size()) {0u}; i < buildNodes.size(); ++i)
+		groupStart[i + 1] += groupStart[i];
+	std::vector<NodeIndex> order(buildNodes.size() - 1);
+	{
+		auto offsets = groupStart;
+		for(auto i = decltype(buildNodes.size()) {1u}; i < buildNodes.size(); ++i)
+			order[offsets[buildNodes[i].parent]++] = static_cast<NodeIndex>(i);
+	}
+	for(auto i = decltype(buildNodes.size()) {0u}; i < buildNodes.size(); ++i) {
+		if(groupStart[i + 1] - groupStart[i] < 2)
+			continue;
+		std::sort(order.begin() + groupStart[i], order.begin() + groupStart[i + 1], [&builder](NodeIndex a, NodeIndex b) {
+			auto &na = builder.nodes[a];
+			auto &nb = builder.nodes[b];
+			auto nameA = builder.GetName(na);
+			auto nameB = builder.GetName(nb);
+			if(nameA != nameB)
+				return nameA < nameB;
+			return na.directory > nb.directory;
+		});
+	}
+
+	// Breadth-first layout, which places the children of each node next to each other.
+	// Files with the same name as a preceding sibling are skipped.
+	std::vector<NodeIndex> buildIndices(buildNodes.size());
+	m_nodes.resize(buildNodes.size());
+	m_nodes[0] = {0, 0, 0, 0, true};
+	buildIndices[0] = 0;
+	NodeIndex next = 1;
+	for(NodeIndex i = 0; i < next; ++i) {
+		auto buildIdx = buildIndices[i];
+		m_nodes[i].firstChild = next;
+		for(auto j = groupStart[buildIdx]; j < groupStart[buildIdx + 1]; ++j) {
+			auto &buildChild = buildNodes[order[j]];
+			if(next > m_nodes[i].firstChild && buildChild.directory == false && builder.GetName(buildChild) == GetName(m_nodes[next - 1]))
+				continue;
+			buildIndices[next] = order[j];
+			m_nodes[next++] = {buildChild.nameOffset, buildChild.nameLength, 0, 0, buildChild.directory};
+		}
+		m_nodes[i].childCount = next - m_nodes[i].firstChild;
+	}
+	m_nodes.resize(next);
+	m_nodes.shrink_to_fit();
+	m_namePool.shrink_to_fit();
+	m_builder = nullptr;
+	UpdateViews();
+}
+pragma::gamemount::ArchiveFileTable::NodeIndex pragma::gamemount::ArchiveFileTable::FindChild(NodeIndex parent, std::string_view name) const
+{
+	auto children = GetChildren(GetNode(parent));
+	auto it = std::lower_bound(children.begin(), children.end(), name, [this](const Node &node, std::string_view name) { return GetName(node) < name; });
+	if(it == children.end() || GetName(*it) != name)
+		return INVALID_NODE;
+	return GetIndex(*it);
+}
+size_t pragma::gamemount::ArchiveFileTable::GetFileCount() const
+{
+	return std::count_if(m_nodeView.begin(), m_nodeView.end(), [](const Node &node) { return node.directory == false; });
+}
+void pragma::gamemount::ArchiveFileTable::GetFilePaths(const std::function<void(const std::string &)> &callback) const
+{
+	if(m_nodeView.empty())
 		return;
-	it->Add(path + 1, dirCount - 1, bDir);
+	std::string path;
+	path.reserve(256);
+	GetFilePaths(GetNode(GetRoot()), path, callback);
+}
+void pragma::gamemount::ArchiveFileTable::GetFilePaths(const Node &node, std::string &path, const std::function<void(const std::string &)> &callback) const
+{
+	auto len = path.length();
+	for(auto &child : GetChildren(node)) {
+		auto name = GetName(child);
+		if(name.empty())
+			continue;
+		if(len > 0)
+			path += '/';
+		path += name;
+		if(child.directory)
+			GetFilePaths(child, path, callback);
+		else
+			callback(path);
+		path.resize(len);
+	}
 }
-pragma::gamemount::ArchiveFileTable::ArchiveFileTable(const std::shared_ptr<void> &phandle) : handle(phandle) {}
+size_t pragma::gamemount::ArchiveFileTable::GetMemoryUsage() const { return sizeof(*this) + m_namePool.capacity() + m_nodes.capacity() * sizeof(Node); }
@@ -5,25 +5,96 @@
 module;
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <span>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <limits>
+#include <cinttypes>
 
 export module pragma.gamemount:archivedata;
 
 export namespace pragma::gamemount {
+	enum class ArchiveType : uint8_t {
+		HLLib = 0,
+		Vpk,
+		Bsa,
+		Ba2,
+	};
+	// Flat file tree of an archive. All names are stored in a single string pool and the children
+	// of each directory occupy a contiguous range of nodes, sorted by name.
+	// Nodes can only be queried after Finalize has been called.
+	// The node and name data can also be provided externally (e.g. mapped from an index cache file), in which
+	// case the archive handle is only opened once it is first requested.
 	struct ArchiveFileTable {
-		struct Item {
-			Item(const std::string &name, bool bDir);
-			std::vector<Item> children;
-			std::string name;
-			void Add(const std::string &fpath, bool bDir);
+		using NodeIndex = uint32_t;
+		static constexpr NodeIndex INVALID_NODE = std::numeric_limits<NodeIndex>::max();
+		struct Node {
+			uint32_t nameOffset = 0;
+			uint32_t nameLength = 0;
+			NodeIndex firstChild = 0;
+			uint32_t childCount = 0;
 			bool directory = false;
-		  private:
-			void Add(const std::string *path, uint32_t dirCount, bool bDir);
 		};
+		using HandleLoader = std::function<std::shared_ptr<void>()>;
 		ArchiveFileTable(const std::shared_ptr<void> &phandle);
+		ArchiveFileTable(ArchiveFileTable &&other);
+		ArchiveFileTable &operator=(ArchiveFileTable &&other);
+		~ArchiveFileTable();
 		std::string identifier;
-		std::shared_ptr<void> handle = nullptr;
-		Item root = {"", true};
+		ArchiveType type = ArchiveType::HLLib;
+
+		// Returns nullptr if the archive could not be opened
+		const std::shared_ptr<void> &GetHandle() const;
+		// Returns nullptr if the archive has not been opened yet, without opening it
+		const void *GetLoadedHandle() const;
+		void SetHandleLoader(const HandleLoader &loader);
+		// Uses externally owned data instead of building the table. storage has to keep nodes and namePool alive.
+		void SetData(const std::shared_ptr<const void> &storage, std::span<const Node> nodes, std::string_view namePool);
+		// Returns a table that uses the same data and archive handle. owner has to keep this table alive, unless its
+		// data is provided externally.
+		ArchiveFileTable Share(const std::shared_ptr<const void> &owner) const;
+		// Returns true if no other table shares the archive handle anymore. Has to be called at most once per table.
+		bool ReleaseShare();
+
+		void Add(std::string_view fpath, bool bDir);
+		NodeIndex AddChild(NodeIndex parent, std::string_view name, bool bDir);
+		void Finalize();
+
+		NodeIndex GetRoot() const { return 0; }
+		const Node &GetNode(NodeIndex idx) const { return m_nodeView[idx]; }
+		std::string_view GetName(const Node &node) const { return m_nameView.substr(node.nameOffset, node.nameLength); }
+		std::span<const Node> GetChildren(const Node &node) const { return m_nodeView.subspan(node.firstChild, node.childCount); }
+		NodeIndex GetIndex(const Node &node) const { return static_cast<NodeIndex>(&node - m_nodeView.data()); }
+		NodeIndex FindChild(NodeIndex parent, std::string_view name) const;
+		size_t GetNodeCount() const { return m_nodeView.size(); }
+		std::span<const Node> GetNodes() const { return m_nodeView; }
+		std::string_view GetNamePool() const { return m_nameView; }
+		size_t GetFileCount() const;
+		// Calls the callback with the full path of every file, using '/' as separator
+		void GetFilePaths(const std::function<void(const std::string &)> &callback) const;
+		size_t GetMemoryUsage() const;
+	  private:
+		struct Builder;
+		void GetFilePaths(const Node &node, std::string &path, const std::function<void(const std::string &)> &callback) const;
+		Builder &GetBuilder();
+		struct HandleState {
+			std::mutex mutex;
+			std::atomic<bool> loaded = false;
+			std::shared_ptr<void> handle = nullptr;
+			HandleLoader loader = nullptr;
+			std::atomic<uint32_t> shareCount = 1;
+		};
+		void UpdateViews();
+		std::string m_namePool;
+		std::vector<Node> m_nodes;
+		std::shared_ptr<const void> m_storage = nullptr;
+		std::span<const Node> m_nodeView;
+		std::string_view m_nameView;
+		std::shared_ptr<HandleState> m_handleState;
+		std::unique_ptr<Builder> m_builder;
 	};
 };
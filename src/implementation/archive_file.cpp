@@ -0,0 +1,57 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <fsys/filesystem.h>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :archivefile;
+
+pragma::gamemount::ArchiveEntryFile::ArchiveEntryFile(std::shared_ptr<const void> owner, std::span<const uint8_t> data) : m_owner {std::move(owner)}, m_data {data}, m_size {data.size()}
+{
+	m_type = VFILE_VIRTUAL;
+}
+pragma::gamemount::ArchiveEntryFile::ArchiveEntryFile(Reader reader, size_t size) : m_reader {std::move(reader)}, m_size {size}
+{
+	m_type = VFILE_VIRTUAL;
+}
+pragma::gamemount::ArchiveEntryFile::ArchiveEntryFile(std::shared_ptr<const std::vector<uint8_t>> data) : m_data {data->data(), data->size()}, m_size {data->size()}
+{
+	m_type = VFILE_VIRTUAL;
+	m_owner = std::move(data);
+}
+
+size_t pragma::gamemount::ArchiveEntryFile::Read(void *ptr, size_t size)
+{
+	if(m_offset >= m_size)
+		return 0;
+	size = std::min(size, m_size - m_offset);
+	size_t numRead;
+	if(m_reader)
+		numRead = m_reader(ptr, m_offset, size);
+	else {
+		memcpy(ptr, m_data.data() + m_offset, size);
+		numRead = size;
+	}
+	m_offset += numRead;
+	return numRead;
+}
+unsigned long long pragma::gamemount::ArchiveEntryFile::Tell() { return m_offset; }
+void pragma::gamemount::ArchiveEntryFile::Seek(unsigned long long offset) { m_offset = std::min<size_t>(offset, m_size); }
+int pragma::gamemount::ArchiveEntryFile::Eof() { return (m_offset >= m_size) ? EOF : 0; }
+int pragma::gamemount::ArchiveEntryFile::ReadChar()
+{
+	uint8_t c;
+	if(Read(&c, 1) != 1)
+		return EOF;
+	return c;
+}
+unsigned long long pragma::gamemount::ArchiveEntryFile::GetSize() { return m_size; }
@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <fsys/filesystem.h>
+#include <vector>
+#include <memory>
+#include <span>
+#include <functional>
+#include <cinttypes>
+
+export module pragma.gamemount:archivefile;
+
+export namespace pragma::gamemount {
+	// File handle for an archive entry. The data is either accessed in-place (e.g. a memory-mapped range),
+	// read lazily from the archive on demand or owned by the handle. Nothing is registered with the
+	// virtual file system, the entry is released once the last handle has been dropped.
+	class ArchiveEntryFile : public VFilePtrInternal {
+	  public:
+		// Reads up to len bytes starting at offset into dst and returns the number of bytes read
+		using Reader = std::function<size_t(void *dst, size_t offset, size_t len)>;
+		// owner has to keep the memory referenced by data alive
+		ArchiveEntryFile(std::shared_ptr<const void> owner, std::span<const uint8_t> data);
+		ArchiveEntryFile(Reader reader, size_t size);
+		ArchiveEntryFile(std::shared_ptr<const std::vector<uint8_t>> data);
+		virtual size_t Read(void *ptr, size_t size) override;
+		virtual unsigned long long Tell() override;
+		virtual void Seek(unsigned long long offset) override;
+		virtual int Eof() override;
+		virtual int ReadChar() override;
+		virtual unsigned long long GetSize() override;
+	  private:
+		std::shared_ptr<const void> m_owner = nullptr;
+		std::span<const uint8_t> m_data;
+		Reader m_reader = nullptr;
+		size_t m_size = 0;
+		size_t m_offset = 0;
+	};
+};
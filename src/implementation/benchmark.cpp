@@ -0,0 +1,545 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#ifdef UTIL_ARCHIVE_BENCHMARK
+#include <chrono>
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <span>
+#include <cstring>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include <HLLib.h>
+#include <Wrapper.h>
+#include "../../benchmark/archive_generator.hpp"
+
+#ifdef ENABLE_BETHESDA_FORMATS
+#include <libbsa/libbsa.h>
+#endif
+#endif
+
+module pragma.gamemount;
+
+import :benchmark;
+
+#ifdef UTIL_ARCHIVE_BENCHMARK
+import :archive;
+import :archivedata;
+import :bsaarchive;
+import :bufferpool;
+import :pathnormalizer;
+import :vpkarchive;
+
+namespace pragma::gamemount::benchmark {
+	using Clock = std::chrono::steady_clock;
+	static double to_seconds(Clock::duration dt) { return std::chrono::duration<double>(dt).count(); }
+	static double to_mib(double bytes) { return bytes / (1024.0 * 1024.0); }
+	static bool verify_file(std::span<const uint8_t> data, uint64_t fileIdx, uint64_t offset = 0, uint32_t seed = 0)
+	{
+		for(size_t i = 0; i < data.size(); ++i) {
+			if(data[i] != get_file_byte(fileIdx, offset + i, seed))
+				return false;
+		}
+		return true;
+	}
+
+	// Resident set size of the process in bytes
+	static size_t get_resident_size()
+	{
+#ifdef __linux__
+		std::ifstream f {"/proc/self/statm"};
+		size_t size = 0;
+		size_t resident = 0;
+		f >> size >> resident;
+		return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+		return 0;
+#endif
+	}
+
+	// Compares the normalization of index paths with the previous one through GameMountManager::GetNormalizedPath and
+	// GetNormalizedSourceEnginePath. Both have to produce the same index paths.
+	static std::optional<ComponentResult> benchmark_path_normalization(const std::string &)
+	{
+		constexpr std::array<std::string_view, 6> paths {"models\\props_c17\\awning001a.mdl", "Materials/Models/Props_C17/Awning001a.vmt", "sounds/ambient/levels/citadel/field_loop1.wav", "../maps/background01.bsp", "particles/./fire_01.pcf",
+		  "materials/nature/../concrete/concretefloor001a.vtf"};
+		constexpr uint32_t numIterations = 1'000'000;
+		ComponentResult result {};
+		for(auto path : paths) {
+			if(NormalizedPath {path}.GetString() != get_legacy_index_path(std::string {path}))
+				++result.verificationErrors;
+		}
+		// The input strings are created outside of the measurements, since callers already have them
+		std::array<std::string, paths.size()> inputs;
+		std::copy(paths.begin(), paths.end(), inputs.begin());
+		uint64_t checksum = 0;
+		auto t0 = Clock::now();
+		for(auto i = decltype(numIterations) {0u}; i < numIterations; ++i) {
+			NormalizedPath path {inputs[i % inputs.size()]};
+			checksum += path.GetHash();
+		}
+		auto t1 = Clock::now();
+		for(auto i = decltype(numIterations) {0u}; i < numIterations; ++i)
+			checksum += get_legacy_index_path(inputs[i % inputs.size()]).length();
+		auto t2 = Clock::now();
+		// Keeps the loops from being optimized away
+		result.verificationErrors += (checksum == 0) ? 1 : 0;
+		auto toNs = [](Clock::duration dt) { return to_seconds(dt) * 1'000'000'000.0 / numIterations; };
+		result.metrics.push_back({"NormalizedPath", toNs(t1 - t0), "ns/path"});
+		result.metrics.push_back({"GetNormalizedPath(GetNormalizedSourceEnginePath)", toNs(t2 - t1), "ns/path"});
+		return result;
+	}
+
+	// Builds file tables with 1M files in different layouts. The numbers of the item tree that was used before
+	// ArchiveFileTable was flattened can be measured by running this against that revision, with the calls to Add
+	// and Finalize replaced by table.root.Add. Freed memory isn't necessarily returned to the system, so the resident
+	// size is only accurate for the first layout.
+	static std::optional<ComponentResult> benchmark_file_table(const std::string &)
+	{
+		struct Layout {
+			std::string_view name;
+			// Number of entries per level, the last level consists of files
+			std::vector<uint32_t> counts;
+		};
+		const std::array<Layout, 3> layouts {{{"10000 directories x 100 files", {10'000, 100}}, {"1000 directories x 1000 files", {1'000, 1'000}}, {"100 x 100 directories x 100 files", {100, 100, 100}}}};
+		ComponentResult result {};
+		for(auto &layout : layouts) {
+			uint64_t fileCount = 1;
+			for(auto count : layout.counts)
+				fileCount *= count;
+			auto residentSize = get_resident_size();
+			auto t0 = Clock::now();
+			ArchiveFileTable table {nullptr};
+			std::string path;
+			for(uint64_t fileIdx = 0; fileIdx < fileCount; ++fileIdx) {
+				path.clear();
+				auto idx = fileIdx;
+				for(auto level = layout.counts.size(); level-- > 0;) {
+					auto component = std::to_string(idx % layout.counts[level]);
+					idx /= layout.counts[level];
+					path.insert(0, (level + 1 == layout.counts.size()) ? ("file" + component + ".vtf") : ("dir" + component + "/"));
+				}
+				table.Add(path, false);
+			}
+			table.Finalize();
+			auto t1 = Clock::now();
+			result.verificationErrors += (table.GetFileCount() != fileCount) ? 1 : 0;
+			std::string name {layout.name};
+			result.metrics.push_back({name + ": build time", to_seconds(t1 - t0), "s"});
+			result.metrics.push_back({name + ": resident size", to_mib(get_resident_size() - std::min(get_resident_size(), residentSize)), "MiB"});
+			result.metrics.push_back({name + ": table size", to_mib(table.GetMemoryUsage()), "MiB"});
+			result.metrics.push_back({name + ": nodes", static_cast<double>(table.GetNodeCount()), "nodes"});
+		}
+		return result;
+	}
+
+	// Reads every file of synthetic BSAs with the native reader and with libbsa: uncompressed and zlib-compressed
+	// version 104 archives, and a version 105 archive with LZ4 frames. Every entry is verified, and the entries read by
+	// libbsa have to be identical to the ones read by the native reader. An archive without names has to be rejected.
+	static std::optional<ComponentResult> benchmark_bsa(const std::string &workDir)
+	{
+		struct Variant {
+			std::string_view name;
+			BsaOptions options;
+		};
+		const std::array<Variant, 3> variants {{{"v104", {104, false}}, {"v104 zlib", {104, true}}, {"v105 lz4", {105, true}}}};
+		const ArchiveLayout layout {100, 200, 16 * 1024};
+		constexpr uint32_t numRounds = 5;
+		auto path = (std::filesystem::path {workDir} / "component_bsa.bsa").string();
+		ComponentResult result {};
+		for(auto &variant : variants) {
+			auto paths = write_bsa(path, layout, variant.options);
+			std::string err;
+			auto archive = paths.empty() ? nullptr : bsa::Archive::Create(path, &err);
+			if(archive == nullptr) {
+				std::filesystem::remove(path);
+				return {};
+			}
+			std::string name {variant.name};
+			std::vector<std::vector<uint8_t>> entries(paths.size());
+			std::vector<uint8_t> data;
+			auto t0 = Clock::now();
+			for(uint32_t round = 0; round < numRounds; ++round) {
+				for(size_t i = 0; i < paths.size(); ++i) {
+					auto *entry = archive->FindEntry(NormalizedPath {paths[i], PathConvention::Gamebryo});
+					if(entry == nullptr || archive->Read(*entry, data) == false) {
+						++result.verificationErrors;
+						continue;
+					}
+					if(round == 0)
+						entries[i] = data;
+				}
+			}
+			auto t1 = Clock::now();
+			auto numReads = static_cast<double>(paths.size() * numRounds);
+			result.metrics.push_back({name + ": native reader", numReads / to_seconds(t1 - t0), "files/s"});
+			for(size_t i = 0; i < paths.size(); ++i) {
+				if(entries[i].size() != layout.fileSize || verify_file(entries[i], i) == false)
+					++result.verificationErrors;
+			}
+			archive = nullptr;
+
+#ifdef ENABLE_BETHESDA_FORMATS
+			bsa_handle hBsa = nullptr;
+			if(bsa_open(&hBsa, path.c_str()) == LIBBSA_OK) {
+				std::vector<std::string> bsaPaths;
+				bsaPaths.reserve(paths.size());
+				for(auto &filePath : paths) {
+					auto &bsaPath = bsaPaths.emplace_back(filePath);
+					std::replace(bsaPath.begin(), bsaPath.end(), '/', '\\');
+				}
+				uint64_t mismatches = 0;
+				t0 = Clock::now();
+				for(uint32_t round = 0; round < numRounds; ++round) {
+					for(size_t i = 0; i < bsaPaths.size(); ++i) {
+						bool contained;
+						const uint8_t *pdata = nullptr;
+						size_t size = 0;
+						if(bsa_contains_asset(hBsa, bsaPaths[i].c_str(), &contained) != LIBBSA_OK || contained == false || bsa_extract_asset_to_memory(hBsa, bsaPaths[i].c_str(), &pdata, &size) != LIBBSA_OK) {
+							++mismatches;
+							continue;
+						}
+						data.resize(size);
+						memcpy(data.data(), pdata, size);
+						if(round == 0 && data != entries[i])
+							++mismatches;
+					}
+				}
+				t1 = Clock::now();
+				bsa_close(hBsa);
+				result.metrics.push_back({name + ": libbsa", numReads / to_seconds(t1 - t0), "files/s"});
+				result.metrics.push_back({name + ": libbsa mismatches", static_cast<double>(mismatches), "entries"});
+				result.verificationErrors += mismatches;
+			}
+			else
+				result.notes.push_back(name + ": libbsa could not open the archive");
+#endif
+		}
+
+		// Archives without names are rejected with a reason instead of being mounted without any entries
+		BsaOptions unnamedOptions {};
+		unnamedOptions.includeNames = false;
+		std::string err;
+		if(write_bsa(path, layout, unnamedOptions).empty() || bsa::Archive::Create(path, &err) != nullptr || err.empty())
+			++result.verificationErrors;
+		std::filesystem::remove(path);
+		return result;
+	}
+
+	// Allocation pattern of many small asset loads, each buffer is filled and released shortly after
+	static std::optional<ComponentResult> benchmark_buffer_pool(const std::string &)
+	{
+		constexpr uint32_t numIterations = 1'000'000;
+		constexpr uint32_t numLive = 64;
+		auto getSize = [](uint32_t i) -> size_t { return 512 + (i * 7919u) % (256 * 1024); };
+		ComponentResult result {};
+		uint64_t checksum = 0;
+		auto t0 = Clock::now();
+		{
+			std::vector<std::shared_ptr<std::vector<uint8_t>>> live(numLive);
+			for(auto i = decltype(numIterations) {0u}; i < numIterations; ++i) {
+				auto data = std::make_shared<std::vector<uint8_t>>();
+				data->resize(getSize(i));
+				(*data)[data->size() - 1] = static_cast<uint8_t>(i);
+				checksum += data->back();
+				live[i % numLive] = std::move(data);
+			}
+		}
+		auto t1 = Clock::now();
+		auto pool = std::make_shared<BufferPool>();
+		{
+			std::vector<std::shared_ptr<PooledBuffer>> live(numLive);
+			for(auto i = decltype(numIterations) {0u}; i < numIterations; ++i) {
+				auto buffer = pool->Acquire(getSize(i));
+				buffer->GetData()[buffer->GetSize() - 1] = static_cast<uint8_t>(i);
+				checksum -= buffer->GetData()[buffer->GetSize() - 1];
+				live[i % numLive] = std::move(buffer);
+			}
+		}
+		auto t2 = Clock::now();
+		result.verificationErrors += (checksum != 0) ? 1 : 0;
+		auto toNs = [](Clock::duration dt) { return to_seconds(dt) * 1'000'000'000.0 / numIterations; };
+		auto stats = pool->GetStats();
+		result.metrics.push_back({"std::vector", toNs(t1 - t0), "ns/buffer"});
+		result.metrics.push_back({"BufferPool", toNs(t2 - t1), "ns/buffer"});
+		result.metrics.push_back({"BufferPool allocations", static_cast<double>(stats.allocations), "allocations"});
+		result.metrics.push_back({"BufferPool reuses", static_cast<double>(stats.reuses), "reuses"});
+		return result;
+	}
+
+	// Reads all entries of synthetic VPKs with 1 KiB, 1 MiB and 64 MiB files through HLLib, once with a per-byte
+	// hlStreamReadChar loop (the previous implementation of Stream::Read) and once through Stream::Read. The
+	// verification is included in both measurements.
+	static std::optional<ComponentResult> benchmark_hl_stream(const std::string &workDir)
+	{
+		struct Case {
+			std::string_view name;
+			ArchiveLayout layout;
+		};
+		const std::array<Case, 3> cases {{{"1 KiB", {1, 1024, 1024}}, {"1 MiB", {1, 64, 1024 * 1024}}, {"64 MiB", {1, 2, 64 * 1024 * 1024}}}};
+		auto dir = (std::filesystem::path {workDir} / "component_hlstream").string();
+		std::filesystem::create_directories(dir);
+		// HLLib is shut down by close()
+		hlInitialize();
+		ComponentResult result {};
+		for(auto &c : cases) {
+			auto paths = write_vpk(dir, "hlstream", c.layout);
+			auto archivePath = dir + "/hlstream_dir.vpk";
+			auto archive = paths.empty() ? nullptr : hl::Archive::Create(archivePath);
+			if(archive == nullptr) {
+				std::filesystem::remove_all(dir);
+				return {};
+			}
+			std::vector<uint8_t> data;
+
+			// The package for the per-byte reads is opened separately, since the handles of Archive are private
+			hlUInt package = 0;
+			hlCreatePackage(hlGetPackageTypeFromName(archivePath.c_str()), &package);
+			hlBindPackage(package);
+			hlPackageOpenFile(archivePath.c_str(), HL_MODE_READ);
+			auto *root = hlPackageGetRoot();
+			auto t0 = Clock::now();
+			for(size_t i = 0; i < paths.size(); ++i) {
+				auto *item = hlFolderGetItemByPath(root, paths[i].c_str(), HLFindType::HL_FIND_FILES);
+				HLStream *stream = nullptr;
+				if(item == nullptr || hlFileCreateStream(item, &stream) == hlFalse || hlStreamOpen(stream, HL_MODE_READ) == hlFalse) {
+					++result.verificationErrors;
+					continue;
+				}
+				data.resize(hlStreamGetStreamSize(stream));
+				for(size_t j = 0; j < data.size(); ++j) {
+					hlChar c;
+					hlStreamReadChar(stream, &c);
+					data.at(j) = static_cast<uint8_t>(c);
+				}
+				hlStreamClose(stream);
+				hlFileReleaseStream(item, stream);
+				result.verificationErrors += verify_file(data, i) ? 0 : 1;
+			}
+			auto t1 = Clock::now();
+			hlPackageClose();
+			hlDeletePackage(package);
+
+			auto t2 = Clock::now();
+			for(size_t i = 0; i < paths.size(); ++i) {
+				auto stream = archive->OpenFile(paths[i]);
+				if(stream == nullptr || stream->Read(data) == false) {
+					++result.verificationErrors;
+					continue;
+				}
+				result.verificationErrors += verify_file(data, i) ? 0 : 1;
+			}
+			auto t3 = Clock::now();
+			archive = nullptr;
+
+			auto totalSize = to_mib(static_cast<double>(c.layout.GetFileCount()) * c.layout.fileSize);
+			std::string name {c.name};
+			result.metrics.push_back({name + " files: hlStreamReadChar", totalSize / to_seconds(t1 - t0), "MiB/s"});
+			result.metrics.push_back({name + " files: Stream::Read", totalSize / to_seconds(t3 - t2), "MiB/s"});
+		}
+		std::filesystem::remove_all(dir);
+		return result;
+	}
+
+	// Reads every entry of a synthetic VPK through HLLib, through the native reader and through views into the mapped
+	// archive. The sum of all bytes is computed for each, so the views are read as well. HLLib is skipped if it can't
+	// open the archive.
+	static std::optional<ComponentResult> benchmark_vpk(const std::string &workDir)
+	{
+		auto dir = (std::filesystem::path {workDir} / "component_vpk").string();
+		std::filesystem::create_directories(dir);
+		const ArchiveLayout layout {16, 256, 16 * 1024};
+		auto paths = write_vpk(dir, "bench", layout);
+		auto archivePath = dir + "/bench_dir.vpk";
+		hlInitialize();
+		auto hlArchive = paths.empty() ? nullptr : hl::Archive::Create(archivePath);
+		auto vpkArchive = paths.empty() ? nullptr : vpk::Archive::Create(archivePath);
+		if(vpkArchive == nullptr) {
+			hlArchive = nullptr;
+			std::filesystem::remove_all(dir);
+			return {};
+		}
+		uint64_t expectedChecksum = 0;
+		for(size_t i = 0; i < paths.size(); ++i) {
+			for(uint32_t j = 0; j < layout.fileSize; ++j)
+				expectedChecksum += get_file_byte(i, j);
+		}
+		auto sum = [](std::span<const uint8_t> data) {
+			uint64_t checksum = 0;
+			for(auto b : data)
+				checksum += b;
+			return checksum;
+		};
+		ComponentResult result {};
+		std::vector<uint8_t> data;
+		auto measure = [&](std::string_view name, const std::function<uint64_t(const std::string &)> &read) {
+			uint64_t checksum = 0;
+			auto t0 = Clock::now();
+			for(auto &path : paths)
+				checksum += read(path);
+			auto seconds = to_seconds(Clock::now() - t0);
+			result.verificationErrors += (checksum != expectedChecksum) ? 1 : 0;
+			result.metrics.push_back({std::string {name}, paths.size() / seconds, "files/s"});
+			result.metrics.push_back({std::string {name}, to_mib(paths.size() * static_cast<double>(layout.fileSize)) / seconds, "MiB/s"});
+		};
+		if(hlArchive) {
+			measure("HLLib", [&hlArchive, &data, &sum](const std::string &path) -> uint64_t {
+				auto stream = hlArchive->OpenFile(path);
+				if(stream == nullptr || stream->Read(data) == false)
+					return 0;
+				return sum(data);
+			});
+		}
+		measure("Native (copy)", [&vpkArchive, &data, &sum](const std::string &path) -> uint64_t {
+			auto *entry = vpkArchive->FindEntry(path);
+			if(entry == nullptr || vpkArchive->Read(*entry, data) == false)
+				return 0;
+			return sum(data);
+		});
+		measure("Native (view)", [&vpkArchive, &sum](const std::string &path) -> uint64_t {
+			auto *entry = vpkArchive->FindEntry(path);
+			std::span<const uint8_t> view;
+			if(entry == nullptr || vpkArchive->GetView(*entry, view) == false)
+				return 0;
+			return sum(view);
+		});
+		hlArchive = nullptr;
+		vpkArchive = nullptr;
+		std::filesystem::remove_all(dir);
+		return result;
+	}
+
+	// Reads random entries of two synthetic VPKs with different contents through HLLib from multiple threads and
+	// verifies them against the archive they were read from. Every other read is a ranged read at a random offset.
+	// The threads first spread their reads across both archives, then all of them read from the same archive.
+	static std::optional<ComponentResult> stress_test_hl_archive(const std::string &workDir)
+	{
+		auto threadCount = std::max(std::thread::hardware_concurrency(), 2u);
+		constexpr uint32_t readsPerThread = 10'000;
+		auto dir = (std::filesystem::path {workDir} / "component_stress_hl").string();
+		std::filesystem::create_directories(dir);
+		ArchiveLayout layout {16, 64, 16 * 1024};
+		hlInitialize();
+		std::vector<std::shared_ptr<hl::Archive>> archives;
+		std::vector<uint32_t> seeds;
+		std::vector<std::string> paths;
+		for(auto name : {"stress_a", "stress_b"}) {
+			layout.seed = static_cast<uint32_t>(archives.size()) + 1;
+			paths = write_vpk(dir, name, layout);
+			auto archivePath = dir + "/" + name + "_dir.vpk";
+			auto archive = paths.empty() ? nullptr : hl::Archive::Create(archivePath);
+			if(archive == nullptr) {
+				archives.clear();
+				std::filesystem::remove_all(dir);
+				return {};
+			}
+			archives.push_back(std::move(archive));
+			seeds.push_back(layout.seed);
+		}
+
+		ComponentResult result {};
+		result.metrics.push_back({"Threads", static_cast<double>(threadCount), "threads"});
+		auto run = [&](std::string_view name, uint32_t archiveCount) {
+			std::atomic<uint64_t> errors = 0;
+			std::atomic<uint64_t> bytesRead = 0;
+			auto worker = [&](uint32_t threadIdx) {
+				std::mt19937 rng {threadIdx};
+				std::vector<uint8_t> data;
+				for(auto i = decltype(readsPerThread) {0u}; i < readsPerThread; ++i) {
+					auto archiveIdx = rng() % archiveCount;
+					auto fileIdx = rng() % paths.size();
+					auto stream = archives[archiveIdx]->OpenFile(paths[fileIdx]);
+					if(stream == nullptr) {
+						++errors;
+						continue;
+					}
+					size_t offset = 0;
+					if(i % 2 == 1) {
+						offset = rng() % layout.fileSize;
+						data.resize(rng() % (layout.fileSize - offset) + 1);
+						if(stream->Read(data.data(), offset, data.size()) != data.size()) {
+							++errors;
+							continue;
+						}
+					}
+					else if(stream->Read(data) == false || data.size() != layout.fileSize) {
+						++errors;
+						continue;
+					}
+					if(verify_file(data, fileIdx, offset, seeds[archiveIdx]) == false) {
+						++errors;
+						continue;
+					}
+					bytesRead += data.size();
+				}
+			};
+			auto t0 = Clock::now();
+			std::vector<std::thread> threads;
+			threads.reserve(threadCount);
+			for(auto i = decltype(threadCount) {0u}; i < threadCount; ++i)
+				threads.push_back(std::thread {worker, i});
+			for(auto &t : threads)
+				t.join();
+			auto seconds = to_seconds(Clock::now() - t0);
+			result.verificationErrors += errors;
+			std::string metricName {name};
+			result.metrics.push_back({metricName, (threadCount * static_cast<double>(readsPerThread)) / seconds, "reads/s"});
+			result.metrics.push_back({metricName, to_mib(bytesRead) / seconds, "MiB/s"});
+		};
+		run("Two archives", static_cast<uint32_t>(archives.size()));
+		run("Same archive", 1);
+		archives.clear();
+		std::filesystem::remove_all(dir);
+		return result;
+	}
+
+	struct Component {
+		std::string_view name;
+		std::optional<ComponentResult> (*run)(const std::string &workDir);
+	};
+	static constexpr std::array<Component, 7> g_components {{
+	  {"normalize", &benchmark_path_normalization},
+	  {"table", &benchmark_file_table},
+	  {"hlstream", &benchmark_hl_stream},
+	  {"stress_hl", &stress_test_hl_archive},
+	  {"vpk", &benchmark_vpk},
+	  {"bsa", &benchmark_bsa},
+	  {"pool", &benchmark_buffer_pool},
+	}};
+};
+
+std::vector<std::string> pragma::gamemount::benchmark::get_component_benchmarks()
+{
+	std::vector<std::string> names;
+	names.reserve(g_components.size());
+	for(auto &component : g_components)
+		names.push_back(std::string {component.name});
+	return names;
+}
+std::optional<pragma::gamemount::benchmark::ComponentResult> pragma::gamemount::benchmark::run_component_benchmark(const std::string &name, const std::string &workDir)
+{
+	auto it = std::find_if(g_components.begin(), g_components.end(), [&name](const Component &component) { return component.name == name; });
+	if(it == g_components.end())
+		return {};
+	std::filesystem::create_directories(workDir);
+	auto result = it->run(workDir);
+	if(result.has_value())
+		result->name = name;
+	return result;
+}
+#endif
@@ -0,0 +1,66 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string_view>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+module pragma.gamemount;
+
+import :bloomfilter;
+import :pathnormalizer;
+
+pragma::gamemount::BloomFilter::BloomFilter(size_t expectedCount, double falsePositiveRate)
+{
+	// Optimal number of bits and hash functions for the requested false-positive rate
+	constexpr auto ln2 = 0.6931471805599453;
+	expectedCount = std::max<size_t>(expectedCount, 1);
+	auto bitCount = static_cast<uint64_t>(std::ceil(-static_cast<double>(expectedCount) * std::log(falsePositiveRate) / (ln2 * ln2)));
+	m_bits.resize((bitCount + 63) / 64, 0);
+	m_bitCount = m_bits.size() * 64;
+	m_hashCount = std::clamp<uint32_t>(static_cast<uint32_t>(std::round(static_cast<double>(m_bitCount) / expectedCount * ln2)), 1, 16);
+}
+
+pragma::gamemount::BloomFilter::BloomFilter(std::vector<uint64_t> bits, uint32_t hashCount) : m_bits {std::move(bits)}, m_bitCount {m_bits.size() * 64}, m_hashCount {hashCount} {}
+
+std::pair<uint64_t, uint64_t> pragma::gamemount::BloomFilter::Hash(uint64_t hash)
+{
+	// The second hash is derived from the first one (splitmix64 finalizer) and has to be odd
+	auto h1 = hash;
+	auto h2 = h1 + 0x9e3779b97f4a7c15ull;
+	h2 = (h2 ^ (h2 >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h2 = (h2 ^ (h2 >> 27)) * 0x94d049bb133111ebull;
+	h2 ^= h2 >> 31;
+	return {h1, h2 | 1};
+}
+
+void pragma::gamemount::BloomFilter::Add(std::string_view value)
+{
+	if(m_bitCount == 0)
+		return;
+	auto [h1, h2] = Hash(hash_path(value));
+	for(auto i = decltype(m_hashCount) {0u}; i < m_hashCount; ++i) {
+		auto bit = (h1 + i * h2) % m_bitCount;
+		m_bits[bit / 64] |= (uint64_t {1} << (bit % 64));
+	}
+}
+
+bool pragma::gamemount::BloomFilter::MayContain(std::string_view value) const { return MayContainHash(hash_path(value)); }
+
+bool pragma::gamemount::BloomFilter::MayContainHash(uint64_t hash) const
+{
+	if(m_bitCount == 0)
+		return true;
+	auto [h1, h2] = Hash(hash);
+	for(auto i = decltype(m_hashCount) {0u}; i < m_hashCount; ++i) {
+		auto bit = (h1 + i * h2) % m_bitCount;
+		if((m_bits[bit / 64] & (uint64_t {1} << (bit % 64))) == 0)
+			return false;
+	}
+	return true;
+}
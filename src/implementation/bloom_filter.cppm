@@ -0,0 +1,36 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cinttypes>
+
+export module pragma.gamemount:bloomfilter;
+
+export namespace pragma::gamemount {
+	// Probabilistic set of strings. MayContain never returns false for a string that was added,
+	// but may return true for strings that were not.
+	class BloomFilter {
+	  public:
+		BloomFilter() = default;
+		BloomFilter(size_t expectedCount, double falsePositiveRate = 0.01);
+		// Restores a filter from the bits and hash count of another filter
+		BloomFilter(std::vector<uint64_t> bits, uint32_t hashCount);
+		void Add(std::string_view value);
+		bool MayContain(std::string_view value) const;
+		// The hash has to have been computed with hash_path
+		bool MayContainHash(uint64_t hash) const;
+		size_t GetMemoryUsage() const { return m_bits.size() * sizeof(m_bits.front()); }
+		const std::vector<uint64_t> &GetBits() const { return m_bits; }
+		uint32_t GetHashCount() const { return m_hashCount; }
+	  private:
+		static std::pair<uint64_t, uint64_t> Hash(uint64_t hash);
+		std::vector<uint64_t> m_bits;
+		uint64_t m_bitCount = 0;
+		uint32_t m_hashCount = 0;
+	};
+};
@@ -0,0 +1,273 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <cstring>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :bsaarchive;
+import :mappedfile;
+import :pathnormalizer;
+import :decompressstream;
+
+namespace pragma::gamemount::bsa {
+	static constexpr uint32_t SIGNATURE = 0x415342; // "BSA\0"
+	static constexpr size_t HEADER_SIZE = 36;
+	static constexpr size_t FOLDER_RECORD_SIZE = 16;
+	static constexpr size_t FOLDER_RECORD_SIZE_V105 = 24;
+	static constexpr size_t FILE_RECORD_SIZE = 16;
+	static constexpr uint32_t VERSION_OBLIVION = 103;
+	static constexpr uint32_t VERSION_SKYRIM_SE = 105;
+	enum ArchiveFlags : uint32_t {
+		INCLUDE_DIRECTORY_NAMES = 0x1,
+		INCLUDE_FILE_NAMES = 0x2,
+		COMPRESSED = 0x4,
+		EMBED_FILE_NAMES = 0x100,
+	};
+	// Inverts the default compression of the archive for this entry
+	static constexpr uint32_t SIZE_COMPRESSION_TOGGLE = 0x40000000;
+	static constexpr uint32_t SIZE_MASK = 0x3fffffff;
+	template<typename T>
+	static T read_value(const uint8_t *data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+};
+
+std::shared_ptr<pragma::gamemount::bsa::Archive> pragma::gamemount::bsa::Archive::Create(const std::string &path, std::string *optOutError)
+{
+	auto archive = std::shared_ptr<Archive> {new Archive {}};
+	std::string err;
+	if(archive->Load(path, err) == false) {
+		if(optOutError)
+			*optOutError = std::move(err);
+		return nullptr;
+	}
+	return archive;
+}
+
+bool pragma::gamemount::bsa::Archive::Load(const std::string &path, std::string &outError)
+{
+	m_file = MappedFile::Open(path);
+	if(m_file == nullptr) {
+		outError = "Unable to open file";
+		return false;
+	}
+	outError = "Not a BSA archive";
+	if(m_file->GetSize() < HEADER_SIZE)
+		return false;
+	auto *data = m_file->GetData();
+	auto size = m_file->GetSize();
+	if(read_value<uint32_t>(data) != SIGNATURE)
+		return false;
+	m_version = read_value<uint32_t>(data + 4);
+	if(m_version < VERSION_OBLIVION || m_version > VERSION_SKYRIM_SE) {
+		outError = "Unsupported BSA version " + std::to_string(m_version);
+		return false;
+	}
+	auto folderRecordOffset = read_value<uint32_t>(data + 8);
+	auto flags = read_value<uint32_t>(data + 12);
+	auto folderCount = read_value<uint32_t>(data + 16);
+	auto fileCount = read_value<uint32_t>(data + 20);
+	auto totalFileNameLength = read_value<uint32_t>(data + 28);
+	// Entries can't be addressed by path without names, only by the hashes of their paths. Such archives can't be
+	// indexed either, so they aren't supported.
+	if((flags & INCLUDE_DIRECTORY_NAMES) == 0 || (flags & INCLUDE_FILE_NAMES) == 0) {
+		outError = "Archive doesn't contain directory or file names, which are required to look up its entries";
+		return false;
+	}
+	outError = "Archive is truncated or malformed";
+	m_embeddedNames = (m_version > VERSION_OBLIVION && (flags & EMBED_FILE_NAMES));
+	auto defaultCompressed = (flags & COMPRESSED) != 0;
+
+	// The file records of each folder follow the folder records, prefixed by the name of the folder.
+	// The file names are stored in a separate block afterwards, in the same order.
+	auto folderRecordSize = (m_version == VERSION_SKYRIM_SE) ? FOLDER_RECORD_SIZE_V105 : FOLDER_RECORD_SIZE;
+	size_t pos = folderRecordOffset;
+	if(pos + static_cast<uint64_t>(folderCount) * folderRecordSize > size)
+		return false;
+	std::vector<uint32_t> folderFileCounts;
+	folderFileCounts.reserve(folderCount);
+	for(auto i = decltype(folderCount) {0u}; i < folderCount; ++i)
+		folderFileCounts.push_back(read_value<uint32_t>(data + pos + i * folderRecordSize + 8));
+	pos += folderCount * folderRecordSize;
+
+	std::vector<std::string_view> folderNames;
+	std::vector<uint32_t> entryFolders;
+	folderNames.reserve(folderCount);
+	m_entries.reserve(fileCount);
+	entryFolders.reserve(fileCount);
+	for(auto i = decltype(folderCount) {0u}; i < folderCount; ++i) {
+		if(pos >= size)
+			return false;
+		// Length includes the null-terminator
+		auto nameLength = data[pos];
+		if(nameLength == 0 || pos + 1 + nameLength > size)
+			return false;
+		folderNames.push_back({reinterpret_cast<const char *>(data + pos + 1), static_cast<size_t>(nameLength - 1)});
+		pos += 1 + nameLength;
+		if(pos + static_cast<uint64_t>(folderFileCounts[i]) * FILE_RECORD_SIZE > size)
+			return false;
+		for(uint32_t j = 0; j < folderFileCounts[i]; ++j) {
+			auto sizeField = read_value<uint32_t>(data + pos + 8);
+			Entry entry {};
+			entry.size = sizeField & SIZE_MASK;
+			entry.offset = read_value<uint32_t>(data + pos + 12);
+			entry.compressed = ((sizeField & SIZE_COMPRESSION_TOGGLE) != 0) != defaultCompressed;
+			m_entries.push_back(entry);
+			entryFolders.push_back(i);
+			pos += FILE_RECORD_SIZE;
+		}
+	}
+
+	if(pos + totalFileNameLength > size)
+		return false;
+	auto *names = reinterpret_cast<const char *>(data + pos);
+	auto *namesEnd = names + totalFileNameLength;
+	m_pathToEntry.reserve(m_entries.size());
+	std::string filePath;
+	for(auto i = decltype(m_entries.size()) {0u}; i < m_entries.size(); ++i) {
+		auto *nameEnd = static_cast<const char *>(memchr(names, '\0', namesEnd - names));
+		if(nameEnd == nullptr)
+			return false;
+		filePath.assign(folderNames[entryFolders[i]]);
+		filePath += '\\';
+		filePath.append(names, nameEnd);
+		names = nameEnd + 1;
+		m_pathToEntry.emplace(NormalizedPath {filePath, PathConvention::Gamebryo}.GetString(), static_cast<uint32_t>(i));
+	}
+	return true;
+}
+
+const pragma::gamemount::bsa::Archive::Entry *pragma::gamemount::bsa::Archive::FindEntry(const NormalizedPath &path) const
+{
+	auto it = m_pathToEntry.find(path);
+	return (it != m_pathToEntry.end()) ? &m_entries[it->second] : nullptr;
+}
+
+void pragma::gamemount::bsa::Archive::GetFiles(const std::function<void(std::string_view, const Entry &)> &callback) const
+{
+	for(auto &[path, entryIdx] : m_pathToEntry)
+		callback(path, m_entries[entryIdx]);
+}
+
+bool pragma::gamemount::bsa::Archive::GetData(const Entry &entry, std::span<const uint8_t> &outData, uint32_t &outSize) const
+{
+	auto view = m_file->GetView();
+	if(entry.offset + entry.size > view.size())
+		return false;
+	auto data = view.subspan(entry.offset, entry.size);
+	if(m_embeddedNames) {
+		// Length-prefixed copy of the full path, without null-terminator
+		if(data.empty() || data.size() < 1u + data[0])
+			return false;
+		data = data.subspan(1u + data[0]);
+	}
+	if(entry.compressed) {
+		if(data.size() < sizeof(uint32_t))
+			return false;
+		outSize = read_value<uint32_t>(data.data());
+		data = data.subspan(sizeof(uint32_t));
+	}
+	else
+		outSize = static_cast<uint32_t>(data.size());
+	outData = data;
+	return true;
+}
+
+std::optional<uint32_t> pragma::gamemount::bsa::Archive::GetSize(const Entry &entry) const
+{
+	std::span<const uint8_t> data;
+	uint32_t size;
+	if(GetData(entry, data, size) == false)
+		return {};
+	return size;
+}
+
+bool pragma::gamemount::bsa::Archive::GetView(const Entry &entry, std::span<const uint8_t> &outView) const
+{
+	uint32_t size;
+	return entry.compressed == false && GetData(entry, outView, size);
+}
+
+std::optional<uint32_t> pragma::gamemount::bsa::Archive::GetStoredSize(const Entry &entry) const
+{
+	std::span<const uint8_t> data;
+	uint32_t size;
+	if(GetData(entry, data, size) == false)
+		return {};
+	return static_cast<uint32_t>(data.size());
+}
+
+pragma::gamemount::DecompressStream::Format pragma::gamemount::bsa::Archive::GetCompressionFormat() const
+{
+	// Skyrim Special Edition uses LZ4 frames
+	return (m_version == VERSION_SKYRIM_SE) ? DecompressStream::Format::Lz4Frame : DecompressStream::Format::Zlib;
+}
+
+std::unique_ptr<pragma::gamemount::DecompressStream> pragma::gamemount::bsa::Archive::OpenStream(const Entry &entry) const
+{
+	std::span<const uint8_t> data;
+	uint32_t size;
+	if(entry.compressed == false || GetData(entry, data, size) == false)
+		return nullptr;
+	return std::make_unique<DecompressStream>(GetCompressionFormat(), data, size);
+}
+
+bool pragma::gamemount::bsa::Archive::Extract(const Entry &entry, std::span<uint8_t> dst) const
+{
+	std::span<const uint8_t> data;
+	uint32_t size;
+	if(GetData(entry, data, size) == false || dst.size() != size)
+		return false;
+	if(entry.compressed == false) {
+		if(size > 0)
+			memcpy(dst.data(), data.data(), size);
+		return true;
+	}
+	DecompressStream stream {GetCompressionFormat(), data, size};
+	return stream.Read(dst) == dst.size() && stream.HasFailed() == false;
+}
+
+std::optional<size_t> pragma::gamemount::bsa::Archive::Read(const Entry &entry, void *dst, size_t offset, size_t len) const
+{
+	std::span<const uint8_t> data;
+	uint32_t size;
+	if(GetData(entry, data, size) == false)
+		return {};
+	if(offset >= size)
+		return 0;
+	len = std::min<size_t>(len, size - offset);
+	if(entry.compressed == false) {
+		memcpy(dst, data.data() + offset, len);
+		return len;
+	}
+	// The data before the range is decompressed as well, but discarded
+	DecompressStream stream {GetCompressionFormat(), data, size};
+	if(stream.Skip(offset) != offset)
+		return {};
+	auto numRead = stream.Read({static_cast<uint8_t *>(dst), len});
+	if(stream.HasFailed())
+		return {};
+	return numRead;
+}
+
+bool pragma::gamemount::bsa::Archive::Read(const Entry &entry, std::vector<uint8_t> &data) const
+{
+	auto size = GetSize(entry);
+	if(size.has_value() == false)
+		return false;
+	data.resize(*size);
+	return Extract(entry, data);
+}
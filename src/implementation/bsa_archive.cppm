@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <span>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <cinttypes>
+
+export module pragma.gamemount:bsaarchive;
+
+import :mappedfile;
+import :pathnormalizer;
+import :decompressstream;
+
+export namespace pragma::gamemount::bsa {
+	// Native reader for BSA archives (version 103, 104 and 105). The archive is memory-mapped, so uncompressed
+	// entries can be accessed without copying, and compressed entries are decompressed straight into the
+	// destination buffer. Decompression is only available if the Bethesda formats are enabled.
+	class Archive {
+	  public:
+		struct Entry {
+			// Offset of the entry data within the archive, including the embedded name and size prefixes
+			uint64_t offset = 0;
+			uint32_t size = 0;
+			bool compressed = false;
+		};
+		// Returns nullptr if the archive could not be opened, optOutError receives the reason
+		static std::shared_ptr<Archive> Create(const std::string &path, std::string *optOutError = nullptr);
+
+		// Path has to be normalized with the Gamebryo path convention
+		const Entry *FindEntry(const NormalizedPath &path) const;
+		// Size of the entry once decompressed, or an empty optional if the entry is out of bounds
+		std::optional<uint32_t> GetSize(const Entry &entry) const;
+		// Size of the data as stored in the archive, without the name and size prefixes
+		std::optional<uint32_t> GetStoredSize(const Entry &entry) const;
+		// Returns the entry data without copying, which is only possible for uncompressed entries
+		bool GetView(const Entry &entry, std::span<const uint8_t> &outView) const;
+		// Writes the entire entry into dst, which has to be exactly GetSize() bytes large
+		bool Extract(const Entry &entry, std::span<uint8_t> dst) const;
+		bool Read(const Entry &entry, std::vector<uint8_t> &data) const;
+		// Reads up to len bytes starting at offset into dst and returns the number of bytes read, or an empty optional
+		// if the entry could not be read. Compressed entries are only decompressed up to the end of the range.
+		std::optional<size_t> Read(const Entry &entry, void *dst, size_t offset, size_t len) const;
+		// Incremental decoder for a compressed entry. Returns nullptr for uncompressed entries, which can be
+		// accessed with GetView instead. The archive has to outlive the stream.
+		std::unique_ptr<DecompressStream> OpenStream(const Entry &entry) const;
+		// Calls the callback with the normalized path of every entry
+		void GetFiles(const std::function<void(std::string_view, const Entry &)> &callback) const;
+		uint32_t GetVersion() const { return m_version; }
+	  private:
+		Archive() = default;
+		bool Load(const std::string &path, std::string &outError);
+		// Resolves the prefixes of the entry. outData is the stored (possibly compressed) data.
+		bool GetData(const Entry &entry, std::span<const uint8_t> &outData, uint32_t &outSize) const;
+		DecompressStream::Format GetCompressionFormat() const;
+		std::unique_ptr<MappedFile> m_file;
+		uint32_t m_version = 0;
+		bool m_embeddedNames = false;
+		std::vector<Entry> m_entries;
+		std::unordered_map<std::string, uint32_t, PathHash, PathEqual> m_pathToEntry;
+	};
+};
@@ -0,0 +1,196 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <bit>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :bufferpool;
+
+pragma::gamemount::PooledBuffer::PooledBuffer(std::shared_ptr<BufferPool> pool, uint8_t *data, size_t size, uint32_t sizeClass) : m_pool {std::move(pool)}, m_data {data}, m_size {size}, m_sizeClass {sizeClass} {}
+pragma::gamemount::PooledBuffer::~PooledBuffer()
+{
+	if(m_pool)
+		m_pool->Release(m_data, m_size, m_sizeClass);
+}
+
+uint32_t pragma::gamemount::BufferPool::GetSizeClass(size_t size)
+{
+	if(size <= MIN_BLOCK_SIZE)
+		return 0;
+	// Largest power of two multiple of the minimum size below the size, followed by the step within that doubling.
+	// A step of CLASSES_PER_DOUBLING is the first class of the next doubling.
+	auto doubling = static_cast<uint32_t>(std::bit_width((size - 1) / MIN_BLOCK_SIZE) - 1);
+	auto base = MIN_BLOCK_SIZE << doubling;
+	auto stepSize = base / CLASSES_PER_DOUBLING;
+	auto step = static_cast<uint32_t>((size - base + stepSize - 1) / stepSize);
+	return doubling * CLASSES_PER_DOUBLING + step;
+}
+size_t pragma::gamemount::BufferPool::GetBlockSize(uint32_t sizeClass)
+{
+	auto base = MIN_BLOCK_SIZE << (sizeClass / CLASSES_PER_DOUBLING);
+	return base + (base / CLASSES_PER_DOUBLING) * (sizeClass % CLASSES_PER_DOUBLING);
+}
+
+pragma::gamemount::BufferPool::~BufferPool() { Flush(); }
+uint8_t *pragma::gamemount::BufferPool::Allocate(uint32_t sizeClass)
+{
+	++m_allocations;
+	auto blockSize = GetBlockSize(sizeClass);
+	if(blockSize > MAX_SLAB_BLOCK_SIZE)
+		return new uint8_t[blockSize];
+	// The first block is returned, the remaining blocks of the slab go into the free list
+	auto slab = std::make_unique_for_overwrite<uint8_t[]>(SLAB_SIZE);
+	auto *data = slab.get();
+	auto blockCount = SLAB_SIZE / blockSize;
+	auto &sc = m_sizeClasses[sizeClass];
+	for(auto i = blockCount; i > 1; --i)
+		sc.freeBlocks.push_back(data + (i - 1) * blockSize);
+	m_idleCount += blockCount - 1;
+	m_idleSize += (blockCount - 1) * blockSize;
+	m_slabSize += SLAB_SIZE;
+	sc.slabs.push_back(std::move(slab));
+	return data;
+}
+std::shared_ptr<pragma::gamemount::PooledBuffer> pragma::gamemount::BufferPool::Acquire(size_t size)
+{
+	if(size > MAX_BLOCK_SIZE) {
+		++m_oversizeAllocations;
+		++m_liveCount;
+		m_liveSize += size;
+		return std::make_shared<PooledBuffer>(shared_from_this(), new uint8_t[size], size, OVERSIZE_CLASS);
+	}
+	auto sizeClass = GetSizeClass(size);
+	auto blockSize = GetBlockSize(sizeClass);
+	uint8_t *data = nullptr;
+	{
+		auto &sc = m_sizeClasses[sizeClass];
+		std::scoped_lock lock {sc.mutex};
+		if(sc.freeBlocks.empty() == false) {
+			data = sc.freeBlocks.back();
+			sc.freeBlocks.pop_back();
+			++m_reuses;
+			--m_idleCount;
+			m_idleSize -= blockSize;
+			if(blockSize > MAX_SLAB_BLOCK_SIZE)
+				m_idleHeapSize -= blockSize;
+		}
+		else
+			data = Allocate(sizeClass);
+	}
+	++m_liveCount;
+	m_liveSize += blockSize;
+	return std::make_shared<PooledBuffer>(shared_from_this(), data, size, sizeClass);
+}
+void pragma::gamemount::BufferPool::Release(uint8_t *data, size_t size, uint32_t sizeClass)
+{
+	--m_liveCount;
+	if(sizeClass == OVERSIZE_CLASS) {
+		m_liveSize -= size;
+		delete[] data;
+		return;
+	}
+	auto blockSize = GetBlockSize(sizeClass);
+	m_liveSize -= blockSize;
+	if(blockSize > MAX_SLAB_BLOCK_SIZE) {
+		// The block is only kept if it can be reserved within the capacity, releases on other threads may be competing
+		// for the same space
+		auto idleHeapSize = m_idleHeapSize.load();
+		do {
+			if(idleHeapSize + blockSize > m_capacity) {
+				++m_discards;
+				delete[] data;
+				return;
+			}
+		} while(m_idleHeapSize.compare_exchange_weak(idleHeapSize, idleHeapSize + blockSize) == false);
+	}
+	auto &sc = m_sizeClasses[sizeClass];
+	std::scoped_lock lock {sc.mutex};
+	sc.freeBlocks.push_back(data);
+	++m_idleCount;
+	m_idleSize += blockSize;
+}
+void pragma::gamemount::BufferPool::SetCapacity(size_t capacity)
+{
+	m_capacity = capacity;
+	if(m_idleSize > capacity)
+		Flush();
+}
+void pragma::gamemount::BufferPool::FreeIdleSlabs(uint32_t sizeClass)
+{
+	auto &sc = m_sizeClasses[sizeClass];
+	if(sc.slabs.empty())
+		return;
+	auto blockSize = GetBlockSize(sizeClass);
+	auto blockCount = SLAB_SIZE / blockSize;
+	// With both lists sorted by address, the free blocks of each slab form a contiguous range
+	std::sort(sc.freeBlocks.begin(), sc.freeBlocks.end());
+	std::sort(sc.slabs.begin(), sc.slabs.end());
+	std::vector<uint8_t *> freeBlocks;
+	freeBlocks.reserve(sc.freeBlocks.size());
+	size_t slabCount = 0;
+	auto itBlock = sc.freeBlocks.begin();
+	for(auto &slab : sc.slabs) {
+		auto *begin = slab.get();
+		auto *end = begin + SLAB_SIZE;
+		while(itBlock != sc.freeBlocks.end() && *itBlock < begin)
+			freeBlocks.push_back(*itBlock++);
+		auto itSlabBlocks = itBlock;
+		while(itBlock != sc.freeBlocks.end() && *itBlock < end)
+			++itBlock;
+		if(static_cast<size_t>(itBlock - itSlabBlocks) == blockCount) {
+			slab = nullptr;
+			continue;
+		}
+		freeBlocks.insert(freeBlocks.end(), itSlabBlocks, itBlock);
+		sc.slabs[slabCount++] = std::move(slab);
+	}
+	freeBlocks.insert(freeBlocks.end(), itBlock, sc.freeBlocks.end());
+	auto freedSlabCount = sc.slabs.size() - slabCount;
+	sc.slabs.resize(slabCount);
+	sc.freeBlocks = std::move(freeBlocks);
+	m_idleCount -= freedSlabCount * blockCount;
+	m_idleSize -= freedSlabCount * blockCount * blockSize;
+	m_slabSize -= freedSlabCount * SLAB_SIZE;
+}
+void pragma::gamemount::BufferPool::Flush()
+{
+	auto firstHeapClass = GetSizeClass(MAX_SLAB_BLOCK_SIZE + 1);
+	for(auto sizeClass = decltype(firstHeapClass) {0u}; sizeClass < firstHeapClass; ++sizeClass) {
+		std::scoped_lock lock {m_sizeClasses[sizeClass].mutex};
+		FreeIdleSlabs(sizeClass);
+	}
+	for(auto sizeClass = firstHeapClass; sizeClass < SIZE_CLASS_COUNT; ++sizeClass) {
+		auto blockSize = GetBlockSize(sizeClass);
+		auto &sc = m_sizeClasses[sizeClass];
+		std::scoped_lock lock {sc.mutex};
+		for(auto *data : sc.freeBlocks)
+			delete[] data;
+		m_idleCount -= sc.freeBlocks.size();
+		m_idleSize -= sc.freeBlocks.size() * blockSize;
+		m_idleHeapSize -= sc.freeBlocks.size() * blockSize;
+		sc.freeBlocks.clear();
+	}
+}
+pragma::gamemount::BufferPoolStats pragma::gamemount::BufferPool::GetStats() const
+{
+	BufferPoolStats stats {};
+	stats.allocations = m_allocations;
+	stats.reuses = m_reuses;
+	stats.oversizeAllocations = m_oversizeAllocations;
+	stats.discards = m_discards;
+	stats.liveCount = m_liveCount;
+	stats.liveSize = m_liveSize;
+	stats.idleCount = m_idleCount;
+	stats.idleSize = m_idleSize;
+	stats.capacity = m_capacity;
+	stats.slabSize = m_slabSize;
+	return stats;
+}
@@ -0,0 +1,254 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <span>
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+#ifdef ENABLE_BETHESDA_FORMATS
+#include <zlib.h>
+#include <lz4frame.h>
+#endif
+
+module pragma.gamemount;
+
+import :decompressstream;
+
+pragma::gamemount::DecompressStream::DecompressStream(Format format, std::span<const uint8_t> data, size_t size) : m_format {format}, m_data {data}, m_size {size} { Begin(); }
+pragma::gamemount::DecompressStream::~DecompressStream() { End(); }
+void pragma::gamemount::DecompressStream::Begin()
+{
+	m_consumed = 0;
+	m_position = 0;
+	m_failed = false;
+	m_finished = false;
+#ifdef ENABLE_BETHESDA_FORMATS
+	switch(m_format) {
+	case Format::Zlib:
+		{
+			auto *stream = new z_stream {};
+			stream->next_in = const_cast<Bytef *>(m_data.data());
+			stream->avail_in = static_cast<uInt>(std::min<size_t>(m_data.size(), std::numeric_limits<uInt>::max()));
+			if(inflateInit(stream) != Z_OK) {
+				delete stream;
+				m_failed = true;
+				return;
+			}
+			m_context = stream;
+			break;
+		}
+	case Format::Lz4Frame:
+		{
+			LZ4F_dctx *ctx = nullptr;
+			if(LZ4F_isError(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION))) {
+				m_failed = true;
+				return;
+			}
+			m_context = ctx;
+			break;
+		}
+	}
+#else
+	m_failed = true;
+#endif
+}
+void pragma::gamemount::DecompressStream::End()
+{
+	if(m_context == nullptr)
+		return;
+#ifdef ENABLE_BETHESDA_FORMATS
+	switch(m_format) {
+	case Format::Zlib:
+		{
+			auto *stream = static_cast<z_stream *>(m_context);
+			inflateEnd(stream);
+			delete stream;
+			break;
+		}
+	case Format::Lz4Frame:
+		LZ4F_freeDecompressionContext(static_cast<LZ4F_dctx *>(m_context));
+		break;
+	}
+#endif
+	m_context = nullptr;
+}
+size_t pragma::gamemount::DecompressStream::Read(std::span<uint8_t> dst)
+{
+	if(m_failed || m_context == nullptr)
+		return 0;
+	dst = dst.first(std::min(dst.size(), m_size - m_position));
+	if(dst.empty())
+		return 0;
+	size_t written = 0;
+#ifdef ENABLE_BETHESDA_FORMATS
+	switch(m_format) {
+	case Format::Zlib:
+		{
+			auto *stream = static_cast<z_stream *>(m_context);
+			auto result = Z_OK;
+			while(result == Z_OK && written < dst.size()) {
+				stream->next_out = dst.data() + written;
+				stream->avail_out = static_cast<uInt>(std::min<size_t>(dst.size() - written, std::numeric_limits<uInt>::max()));
+				auto avail = stream->avail_out;
+				result = inflate(stream, Z_NO_FLUSH);
+				written += avail - stream->avail_out;
+			}
+			if(result == Z_STREAM_END)
+				m_finished = true;
+			break;
+		}
+	case Format::Lz4Frame:
+		{
+			auto *ctx = static_cast<LZ4F_dctx *>(m_context);
+			size_t result = 1;
+			while(result != 0 && m_consumed < m_data.size() && written < dst.size()) {
+				auto dstSize = dst.size() - written;
+				auto srcSize = m_data.size() - m_consumed;
+				result = LZ4F_decompress(ctx, dst.data() + written, &dstSize, m_data.data() + m_consumed, &srcSize, nullptr);
+				if(LZ4F_isError(result))
+					break;
+				written += dstSize;
+				m_consumed += srcSize;
+			}
+			if(result == 0)
+				m_finished = true;
+			break;
+		}
+	}
+#endif
+	m_position += written;
+	// The data ended before the expected size was reached
+	if(written < dst.size())
+		m_failed = true;
+	else if(m_position == m_size)
+		VerifyEnd();
+	return written;
+}
+void pragma::gamemount::DecompressStream::VerifyEnd()
+{
+	if(m_finished)
+		return;
+	// The output may be complete before the decoder has processed the end of the stream, so the decoder is run once
+	// more with room for a single byte. Any output means the data is larger than expected.
+	std::array<uint8_t, 1> probe;
+#ifdef ENABLE_BETHESDA_FORMATS
+	switch(m_format) {
+	case Format::Zlib:
+		{
+			auto *stream = static_cast<z_stream *>(m_context);
+			stream->next_out = probe.data();
+			stream->avail_out = static_cast<uInt>(probe.size());
+			m_finished = (inflate(stream, Z_NO_FLUSH) == Z_STREAM_END && stream->avail_out == probe.size());
+			break;
+		}
+	case Format::Lz4Frame:
+		{
+			auto *ctx = static_cast<LZ4F_dctx *>(m_context);
+			while(m_consumed < m_data.size()) {
+				auto dstSize = probe.size();
+				auto srcSize = m_data.size() - m_consumed;
+				auto result = LZ4F_decompress(ctx, probe.data(), &dstSize, m_data.data() + m_consumed, &srcSize, nullptr);
+				if(LZ4F_isError(result) || dstSize > 0)
+					break;
+				m_consumed += srcSize;
+				if(result == 0) {
+					m_finished = true;
+					break;
+				}
+				if(srcSize == 0)
+					break;
+			}
+			break;
+		}
+	}
+#endif
+	if(m_finished == false)
+		m_failed = true;
+}
+size_t pragma::gamemount::DecompressStream::Skip(size_t len)
+{
+	std::array<uint8_t, 16 * 1024> window;
+	size_t skipped = 0;
+	while(skipped < len) {
+		auto n = Read(std::span<uint8_t> {window}.first(std::min(window.size(), len - skipped)));
+		if(n == 0)
+			break;
+		skipped += n;
+	}
+	return skipped;
+}
+bool pragma::gamemount::DecompressStream::Seek(size_t offset)
+{
+	if(offset > m_size)
+		return false;
+	if(offset < m_position) {
+		End();
+		Begin();
+	}
+	Skip(offset - m_position);
+	return m_position == offset;
+}
+
+pragma::gamemount::SegmentedStream::SegmentedStream(std::vector<uint8_t> prefix, std::vector<Segment> segments, DecompressStream::Format format) : m_prefix {std::move(prefix)}, m_format {format}
+{
+	m_segments.reserve(segments.size() + 1);
+	m_segments.push_back({m_prefix, m_prefix.size(), false});
+	m_segments.insert(m_segments.end(), segments.begin(), segments.end());
+	m_offsets.reserve(m_segments.size() + 1);
+	m_offsets.push_back(0);
+	for(auto &segment : m_segments) {
+		// Stored segments can't be larger than their data
+		if(segment.compressed == false && segment.size > segment.data.size())
+			m_failed = true;
+		m_offsets.push_back(m_offsets.back() + segment.size);
+	}
+}
+size_t pragma::gamemount::SegmentedStream::Read(std::span<uint8_t> dst)
+{
+	size_t written = 0;
+	while(m_failed == false && written < dst.size() && m_position < GetSize()) {
+		auto segmentIdx = static_cast<size_t>(std::upper_bound(m_offsets.begin(), m_offsets.end(), m_position) - m_offsets.begin()) - 1;
+		auto &segment = m_segments[segmentIdx];
+		auto segmentOffset = m_position - m_offsets[segmentIdx];
+		auto len = std::min(dst.size() - written, segment.size - segmentOffset);
+		auto *out = dst.data() + written;
+		if(segment.compressed == false)
+			memcpy(out, segment.data.data() + segmentOffset, len);
+		else {
+			if(m_stream == nullptr || m_streamSegment != segmentIdx) {
+				m_stream = std::make_unique<DecompressStream>(m_format, segment.data, segment.size);
+				m_streamSegment = segmentIdx;
+			}
+			if(m_stream->Tell() != segmentOffset)
+				m_stream->Seek(segmentOffset);
+			auto numRead = (m_stream->Tell() == segmentOffset) ? m_stream->Read({out, len}) : 0;
+			if(m_stream->HasFailed() || numRead != len)
+				m_failed = true;
+			len = numRead;
+		}
+		written += len;
+		m_position += len;
+	}
+	return written;
+}
+size_t pragma::gamemount::SegmentedStream::Skip(size_t len)
+{
+	// Compressed segments are only decoded up to the new position once they are read
+	len = std::min(len, GetSize() - m_position);
+	m_position += len;
+	return len;
+}
+bool pragma::gamemount::SegmentedStream::Seek(size_t offset)
+{
+	if(offset > GetSize())
+		return false;
+	m_position = offset;
+	return true;
+}
@@ -0,0 +1,96 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <span>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cinttypes>
+
+export module pragma.gamemount:decompressstream;
+
+export namespace pragma::gamemount {
+	// Incremental decoder for compressed archive entries, which only keeps the state of the decompressor in memory.
+	// The compressed data is referenced rather than copied (it is usually part of a memory-mapped archive), so it
+	// has to outlive the stream. Decoding is only available if the Bethesda formats are enabled.
+	class DecompressStream {
+	  public:
+		enum class Format : uint8_t {
+			Zlib = 0,
+			Lz4Frame,
+		};
+		// size is the size of the decompressed data
+		DecompressStream(Format format, std::span<const uint8_t> data, size_t size);
+		DecompressStream(const DecompressStream &) = delete;
+		DecompressStream &operator=(const DecompressStream &) = delete;
+		~DecompressStream();
+
+		// Decompresses the next bytes into dst and returns the number of bytes written. Fewer bytes than requested
+		// are only returned at the end of the data, or if the data is corrupt. Once the last byte has been read, the
+		// stream is marked as failed unless the compressed data ends there as well.
+		size_t Read(std::span<uint8_t> dst);
+		// Decompresses the next len bytes through a small window on the stack and discards them
+		size_t Skip(size_t len);
+		// Seeking backwards restarts decompression at the beginning of the data
+		bool Seek(size_t offset);
+		size_t Tell() const { return m_position; }
+		size_t GetSize() const { return m_size; }
+		bool HasFailed() const { return m_failed; }
+	  private:
+		void Begin();
+		void End();
+		// Called once the expected size has been decompressed, fails the stream if the compressed data continues
+		void VerifyEnd();
+		Format m_format;
+		std::span<const uint8_t> m_data;
+		size_t m_size = 0;
+		size_t m_consumed = 0;
+		size_t m_position = 0;
+		bool m_failed = false;
+		// The end of the compressed stream has been reached
+		bool m_finished = false;
+		// z_stream or LZ4F_dctx, depending on the format
+		void *m_context = nullptr;
+	};
+
+	// Entry that is made up of consecutive segments, each of which is stored or compressed on its own (e.g. the mip
+	// chunks of a BA2 texture), optionally preceded by a prefix that is owned by the stream (e.g. a synthesized file
+	// header). Only the segment that is being read is decoded, so seeking backwards restarts the decompression of that
+	// segment rather than of the entire entry.
+	class SegmentedStream {
+	  public:
+		struct Segment {
+			// Has to outlive the stream
+			std::span<const uint8_t> data;
+			// Decoded size of the segment
+			size_t size = 0;
+			bool compressed = false;
+		};
+		SegmentedStream(std::vector<uint8_t> prefix, std::vector<Segment> segments, DecompressStream::Format format);
+		SegmentedStream(const SegmentedStream &) = delete;
+		SegmentedStream &operator=(const SegmentedStream &) = delete;
+
+		// Same semantics as for DecompressStream
+		size_t Read(std::span<uint8_t> dst);
+		size_t Skip(size_t len);
+		bool Seek(size_t offset);
+		size_t Tell() const { return m_position; }
+		size_t GetSize() const { return m_offsets.back(); }
+		bool HasFailed() const { return m_failed; }
+	  private:
+		std::vector<uint8_t> m_prefix;
+		// The prefix is the first segment
+		std::vector<Segment> m_segments;
+		// Decoded offset of each segment, followed by the total size
+		std::vector<size_t> m_offsets;
+		DecompressStream::Format m_format;
+		// Decoder of the compressed segment that was read last
+		std::unique_ptr<DecompressStream> m_stream = nullptr;
+		size_t m_streamSegment = 0;
+		size_t m_position = 0;
+		bool m_failed = false;
+	};
+};
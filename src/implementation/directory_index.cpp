@@ -0,0 +1,182 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :directoryindex;
+
+pragma::gamemount::DirectoryIndex::DirectoryIndex() { Clear(); }
+void pragma::gamemount::DirectoryIndex::Clear()
+{
+	m_directories.clear();
+	m_directories.emplace_back();
+}
+void pragma::gamemount::DirectoryIndex::AddArchiveFileTable(const ArchiveFileTable &table, uint32_t provider)
+{
+	if(table.GetNodeCount() == 0)
+		return;
+	Merge(GetRoot(), table, table.GetNode(table.GetRoot()), provider);
+}
+void pragma::gamemount::DirectoryIndex::AddDirectoryIndex(const DirectoryIndex &other, uint32_t provider) { Merge(GetRoot(), other, other.GetRoot(), provider); }
+template<typename TChild, typename TGetName, typename TIsDirectory>
+std::vector<std::pair<pragma::gamemount::DirectoryIndex::DirectoryId, const TChild *>> pragma::gamemount::DirectoryIndex::MergeEntries(DirectoryId dir, std::span<const TChild> children, const TGetName &getName, const TIsDirectory &isDirectory,
+  uint32_t provider)
+{
+	// Both the entries and the children are sorted, so they can be merged in linear time
+	auto compare = [](std::string_view name0, bool dir0, std::string_view name1, bool dir1) -> int {
+		if(name0 != name1)
+			return (name0 < name1) ? -1 : 1;
+		if(dir0 != dir1)
+			return dir0 ? -1 : 1;
+		return 0;
+	};
+	std::vector<Entry> merged;
+	std::vector<std::pair<DirectoryId, const TChild *>> subDirectories;
+	size_t newDirectoryCount = 0;
+	{
+		auto &entries = m_directories[dir];
+		merged.reserve(entries.size() + children.size());
+		auto itEntry = entries.begin();
+		auto itChild = children.begin();
+		while(itEntry != entries.end() || itChild != children.end()) {
+			if(itChild == children.end()) {
+				merged.push_back(std::move(*itEntry++));
+				continue;
+			}
+			auto childName = getName(*itChild);
+			auto childIsDirectory = isDirectory(*itChild);
+			if(itEntry != entries.end()) {
+				auto cmp = compare(itEntry->name, itEntry->IsDirectory(), childName, childIsDirectory);
+				if(cmp < 0) {
+					merged.push_back(std::move(*itEntry++));
+					continue;
+				}
+				if(cmp == 0) {
+					// The name has already been provided by a source with a higher priority
+					if(childIsDirectory)
+						subDirectories.push_back({itEntry->directory, &*itChild});
+					merged.push_back(std::move(*itEntry++));
+					++itChild;
+					continue;
+				}
+			}
+			Entry entry {};
+			entry.name = childName;
+			entry.provider = provider;
+			if(childIsDirectory) {
+				// New directories are allocated once the entries are no longer referenced
+				entry.directory = static_cast<DirectoryId>(m_directories.size() + newDirectoryCount++);
+				subDirectories.push_back({entry.directory, &*itChild});
+			}
+			merged.push_back(std::move(entry));
+			++itChild;
+		}
+	}
+	m_directories[dir] = std::move(merged);
+	m_directories.resize(m_directories.size() + newDirectoryCount);
+	return subDirectories;
+}
+void pragma::gamemount::DirectoryIndex::Merge(DirectoryId dir, const ArchiveFileTable &table, const ArchiveFileTable::Node &node, uint32_t provider)
+{
+	auto subDirectories = MergeEntries(
+	  dir, table.GetChildren(node), [&table](const ArchiveFileTable::Node &child) { return table.GetName(child); }, [](const ArchiveFileTable::Node &child) { return child.directory; }, provider);
+	for(auto &[subDir, child] : subDirectories)
+		Merge(subDir, table, *child, provider);
+}
+void pragma::gamemount::DirectoryIndex::Merge(DirectoryId dir, const DirectoryIndex &other, DirectoryId otherDir, uint32_t provider)
+{
+	auto subDirectories = MergeEntries(
+	  dir, other.GetEntries(otherDir), [](const Entry &child) -> std::string_view { return child.name; }, [](const Entry &child) { return child.IsDirectory(); }, provider);
+	for(auto &[subDir, child] : subDirectories)
+		Merge(subDir, other, child->directory, provider);
+}
+pragma::gamemount::DirectoryIndex::DirectoryId pragma::gamemount::DirectoryIndex::FindDirectory(DirectoryId parent, std::string_view name) const
+{
+	auto &entries = m_directories[parent];
+	auto it = std::lower_bound(entries.begin(), entries.end(), name, [](const Entry &entry, std::string_view name) { return entry.name < name; });
+	if(it == entries.end() || it->name != name || it->IsDirectory() == false)
+		return INVALID_DIRECTORY;
+	return it->directory;
+}
+std::span<const pragma::gamemount::DirectoryIndex::Entry> pragma::gamemount::DirectoryIndex::GetEntries(DirectoryId dir, std::string_view prefix) const
+{
+	auto &entries = m_directories[dir];
+	if(prefix.empty())
+		return entries;
+	auto itBegin = std::lower_bound(entries.begin(), entries.end(), prefix, [](const Entry &entry, std::string_view prefix) { return entry.name < prefix; });
+	auto itEnd = std::partition_point(itBegin, entries.end(), [prefix](const Entry &entry) { return entry.name.starts_with(prefix); });
+	return std::span<const Entry> {entries}.subspan(itBegin - entries.begin(), itEnd - itBegin);
+}
+void pragma::gamemount::DirectoryIndex::Find(const GlobPattern &pattern, const FindCallback &callback) const
+{
+	auto &components = pattern.GetComponents();
+	if(components.empty())
+		return;
+	// The literal directories are resolved directly, only the remaining components have to be matched
+	auto dir = GetRoot();
+	for(auto i = decltype(pattern.GetLiteralDirectoryCount()) {0u}; i < pattern.GetLiteralDirectoryCount(); ++i) {
+		dir = FindDirectory(dir, components[i].matcher.GetLiteralPrefix());
+		if(dir == INVALID_DIRECTORY)
+			return;
+	}
+	std::string path;
+	Find(dir, pattern, pattern.GetLiteralDirectoryCount(), path, callback);
+}
+void pragma::gamemount::DirectoryIndex::Find(DirectoryId dir, const GlobPattern &pattern, size_t componentIdx, std::string &path, const FindCallback &callback) const
+{
+	auto &components = pattern.GetComponents();
+	auto &component = components[componentIdx];
+	auto isLast = (componentIdx + 1 == components.size());
+	auto pathLength = path.length();
+	if(component.recursive) {
+		if(isLast) {
+			FindRecursive(dir, path, callback);
+			return;
+		}
+		Find(dir, pattern, componentIdx + 1, path, callback);
+		for(auto &entry : GetEntries(dir)) {
+			if(entry.IsDirectory() == false)
+				continue;
+			path += entry.name;
+			path += '/';
+			Find(entry.directory, pattern, componentIdx, path, callback);
+			path.resize(pathLength);
+		}
+		return;
+	}
+	// Only names starting with the literal prefix of the component can match
+	for(auto &entry : GetEntries(dir, component.matcher.GetLiteralPrefix())) {
+		if((isLast == false && entry.IsDirectory() == false) || component.matcher.Matches(entry.name) == false)
+			continue;
+		path += entry.name;
+		if(isLast)
+			callback(path, entry);
+		else {
+			path += '/';
+			Find(entry.directory, pattern, componentIdx + 1, path, callback);
+		}
+		path.resize(pathLength);
+	}
+}
+void pragma::gamemount::DirectoryIndex::FindRecursive(DirectoryId dir, std::string &path, const FindCallback &callback) const
+{
+	auto pathLength = path.length();
+	for(auto &entry : GetEntries(dir)) {
+		path += entry.name;
+		callback(path, entry);
+		if(entry.IsDirectory()) {
+			path += '/';
+			FindRecursive(entry.directory, path, callback);
+		}
+		path.resize(pathLength);
+	}
+}
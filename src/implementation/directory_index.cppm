@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <limits>
+#include <functional>
+#include <cinttypes>
+#include <utility>
+
+export module pragma.gamemount:directoryindex;
+
+import :archivedata;
+import :globpattern;
+
+export namespace pragma::gamemount {
+	// Merged directory tree of multiple archives. Each name is stored once per directory, together with the
+	// first provider that added it, so sources should be added in order of their priority.
+	// The entries of each directory are sorted by name, with directories before files of the same name.
+	class DirectoryIndex {
+	  public:
+		using DirectoryId = uint32_t;
+		static constexpr DirectoryId INVALID_DIRECTORY = std::numeric_limits<DirectoryId>::max();
+		struct Entry {
+			std::string name;
+			// Only valid for directories
+			DirectoryId directory = INVALID_DIRECTORY;
+			uint32_t provider = 0;
+			bool IsDirectory() const { return directory != INVALID_DIRECTORY; }
+		};
+		// Called with the path of the entry relative to the first non-literal directory of the pattern
+		using FindCallback = std::function<void(std::string_view path, const Entry &entry)>;
+
+		DirectoryIndex();
+		void AddArchiveFileTable(const ArchiveFileTable &table, uint32_t provider);
+		// Adds all entries of another index under the specified provider
+		void AddDirectoryIndex(const DirectoryIndex &other, uint32_t provider);
+		void Clear();
+
+		DirectoryId GetRoot() const { return 0; }
+		DirectoryId FindDirectory(DirectoryId parent, std::string_view name) const;
+		std::span<const Entry> GetEntries(DirectoryId dir) const { return m_directories[dir]; }
+		// Entries whose name starts with the prefix
+		std::span<const Entry> GetEntries(DirectoryId dir, std::string_view prefix) const;
+		void Find(const GlobPattern &pattern, const FindCallback &callback) const;
+		size_t GetDirectoryCount() const { return m_directories.size(); }
+	  private:
+		// Merges the sorted children of a source directory into a directory. Returns the merged directories paired
+		// with the corresponding source children, which have to be merged next.
+		template<typename TChild, typename TGetName, typename TIsDirectory>
+		std::vector<std::pair<DirectoryId, const TChild *>> MergeEntries(DirectoryId dir, std::span<const TChild> children, const TGetName &getName, const TIsDirectory &isDirectory, uint32_t provider);
+		void Merge(DirectoryId dir, const ArchiveFileTable &table, const ArchiveFileTable::Node &node, uint32_t provider);
+		void Merge(DirectoryId dir, const DirectoryIndex &other, DirectoryId otherDir, uint32_t provider);
+		void Find(DirectoryId dir, const GlobPattern &pattern, size_t componentIdx, std::string &path, const FindCallback &callback) const;
+		void FindRecursive(DirectoryId dir, std::string &path, const FindCallback &callback) const;
+		std::vector<std::vector<Entry>> m_directories;
+	};
+};
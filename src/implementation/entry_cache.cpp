@@ -0,0 +1,105 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+module pragma.gamemount;
+
+import :entrycache;
+
+void pragma::gamemount::EntryCache::SetCapacity(size_t capacity)
+{
+	std::scoped_lock lock {m_mutex};
+	m_capacity = capacity;
+	Evict(m_capacity);
+}
+size_t pragma::gamemount::EntryCache::GetCapacity() const { return m_capacity; }
+bool pragma::gamemount::EntryCache::IsEnabled() const { return GetCapacity() > 0; }
+
+pragma::gamemount::EntryCache::Buffer pragma::gamemount::EntryCache::Find(const void *archive, std::string_view path)
+{
+	if(!IsEnabled())
+		return nullptr;
+	std::scoped_lock lock {m_mutex};
+	auto it = m_lookup.find(KeyView {archive, path});
+	if(it == m_lookup.end()) {
+		++m_misses;
+		return nullptr;
+	}
+	++m_hits;
+	m_items.splice(m_items.begin(), m_items, it->second);
+	return it->second->buffer;
+}
+
+void pragma::gamemount::EntryCache::Insert(const void *archive, std::string_view path, const Buffer &buffer)
+{
+	if(!IsEnabled())
+		return;
+	std::scoped_lock lock {m_mutex};
+	// Entries that would take up more than the entire budget are not cached
+	size_t capacity = m_capacity;
+	if(buffer == nullptr || buffer->size() > capacity)
+		return;
+	auto it = m_lookup.find(KeyView {archive, path});
+	if(it != m_lookup.end())
+		Erase(it->second);
+	Evict(capacity - buffer->size());
+	m_items.push_front(Item {Key {archive, std::string {path}}, buffer});
+	m_lookup.insert(std::make_pair(m_items.front().key, m_items.begin()));
+	m_size += buffer->size();
+}
+
+void pragma::gamemount::EntryCache::Erase(std::list<Item>::iterator it)
+{
+	m_size -= it->buffer->size();
+	m_lookup.erase(it->key);
+	m_items.erase(it);
+}
+
+void pragma::gamemount::EntryCache::Evict(size_t capacity)
+{
+	while(m_size > capacity && m_items.empty() == false) {
+		Erase(std::prev(m_items.end()));
+		++m_evictions;
+	}
+}
+
+void pragma::gamemount::EntryCache::Flush()
+{
+	std::scoped_lock lock {m_mutex};
+	m_items.clear();
+	m_lookup.clear();
+	m_size = 0;
+}
+
+void pragma::gamemount::EntryCache::Flush(const void *archive)
+{
+	std::scoped_lock lock {m_mutex};
+	for(auto it = m_items.begin(); it != m_items.end();) {
+		auto itNext = std::next(it);
+		if(it->key.archive == archive)
+			Erase(it);
+		it = itNext;
+	}
+}
+
+pragma::gamemount::EntryCache::Stats pragma::gamemount::EntryCache::GetStats() const
+{
+	std::scoped_lock lock {m_mutex};
+	Stats stats {};
+	stats.hits = m_hits;
+	stats.misses = m_misses;
+	stats.evictions = m_evictions;
+	stats.size = m_size;
+	stats.capacity = m_capacity;
+	stats.entryCount = m_items.size();
+	return stats;
+}
@@ -0,0 +1,82 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cinttypes>
+
+export module pragma.gamemount:entrycache;
+
+export namespace pragma::gamemount {
+	// Least-recently-used cache of archive entry contents, limited by the total number of bytes.
+	// Entries are identified by their archive handle and normalized path. Buffers are shared, so
+	// evicting an entry does not invalidate buffers that are still in use.
+	class EntryCache {
+	  public:
+		using Buffer = std::shared_ptr<const std::vector<uint8_t>>;
+		struct Stats {
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			uint64_t evictions = 0;
+			size_t size = 0;
+			size_t capacity = 0;
+			size_t entryCount = 0;
+		};
+		// A capacity of 0 disables the cache
+		void SetCapacity(size_t capacity);
+		size_t GetCapacity() const;
+		bool IsEnabled() const;
+
+		Buffer Find(const void *archive, std::string_view path);
+		void Insert(const void *archive, std::string_view path, const Buffer &buffer);
+		void Flush();
+		// Removes all entries of the specified archive
+		void Flush(const void *archive);
+		Stats GetStats() const;
+	  private:
+		struct Key {
+			const void *archive = nullptr;
+			std::string path;
+		};
+		struct KeyView {
+			const void *archive = nullptr;
+			std::string_view path;
+		};
+		struct KeyHash {
+			using is_transparent = void;
+			size_t operator()(const KeyView &key) const { return std::hash<std::string_view> {}(key.path) ^ (std::hash<const void *> {}(key.archive) * 31); }
+			size_t operator()(const Key &key) const { return operator()(KeyView {key.archive, key.path}); }
+		};
+		struct KeyEqual {
+			using is_transparent = void;
+			bool operator()(const KeyView &a, const KeyView &b) const { return a.archive == b.archive && a.path == b.path; }
+			bool operator()(const Key &a, const Key &b) const { return operator()(KeyView {a.archive, a.path}, KeyView {b.archive, b.path}); }
+			bool operator()(const KeyView &a, const Key &b) const { return operator()(a, KeyView {b.archive, b.path}); }
+			bool operator()(const Key &a, const KeyView &b) const { return operator()(KeyView {a.archive, a.path}, b); }
+		};
+		struct Item {
+			Key key;
+			Buffer buffer;
+		};
+		void Evict(size_t capacity);
+		void Erase(std::list<Item>::iterator it);
+
+		std::list<Item> m_items; // Most recently used first
+		std::unordered_map<Key, std::list<Item>::iterator, KeyHash, KeyEqual> m_lookup;
+		size_t m_size = 0;
+		std::atomic<size_t> m_capacity = 0; // Read without the lock, so a disabled cache costs nothing
+		uint64_t m_hits = 0;
+		uint64_t m_misses = 0;
+		uint64_t m_evictions = 0;
+		mutable std::mutex m_mutex;
+	};
+};
@@ -0,0 +1,154 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <optional>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :globpattern;
+
+static char to_lower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+template<typename TCallback>
+static void split_path(std::string_view path, const TCallback &callback)
+{
+	size_t start = 0;
+	while(start <= path.length()) {
+		auto end = path.find_first_of("/\\", start);
+		if(end == std::string_view::npos)
+			end = path.length();
+		if(end > start)
+			callback(path.substr(start, end - start));
+		start = end + 1;
+	}
+}
+
+pragma::gamemount::GlobMatcher::GlobMatcher(std::string_view pattern) : m_pattern {pattern}
+{
+	std::transform(m_pattern.begin(), m_pattern.end(), m_pattern.begin(), to_lower);
+	m_literalPrefixLength = std::min(m_pattern.find_first_of("*?"), m_pattern.length());
+	size_t start = 0;
+	for(;;) {
+		auto end = std::min(m_pattern.find('*', start), m_pattern.length());
+		Piece piece {};
+		piece.offset = start;
+		piece.length = end - start;
+		piece.hasWildcard = GetPiece(piece).find('?') != std::string_view::npos;
+		m_pieces.push_back(piece);
+		if(end == m_pattern.length())
+			break;
+		m_hasStar = true;
+		start = end + 1;
+	}
+}
+bool pragma::gamemount::GlobMatcher::MatchesPiece(std::string_view str, std::string_view piece, bool hasWildcard)
+{
+	for(auto i = decltype(piece.length()) {0u}; i < piece.length(); ++i) {
+		if(piece[i] != to_lower(str[i]) && (hasWildcard == false || piece[i] != '?'))
+			return false;
+	}
+	return true;
+}
+bool pragma::gamemount::GlobMatcher::Matches(std::string_view str) const
+{
+	auto &first = m_pieces.front();
+	if(m_hasStar == false)
+		return str.length() == first.length && MatchesPiece(str, GetPiece(first), first.hasWildcard);
+	// The first and last piece are anchored, the ones in between are matched at their leftmost position
+	auto &last = m_pieces.back();
+	if(str.length() < first.length + last.length)
+		return false;
+	if(MatchesPiece(str, GetPiece(first), first.hasWildcard) == false || MatchesPiece(str.substr(str.length() - last.length), GetPiece(last), last.hasWildcard) == false)
+		return false;
+	auto remaining = str.substr(first.length, str.length() - first.length - last.length);
+	for(auto i = decltype(m_pieces.size()) {1u}; i + 1 < m_pieces.size(); ++i) {
+		auto &piece = m_pieces[i];
+		if(piece.length == 0)
+			continue;
+		auto pieceStr = GetPiece(piece);
+		auto found = false;
+		for(size_t pos = 0; pos + piece.length <= remaining.length(); ++pos) {
+			if(MatchesPiece(remaining.substr(pos), pieceStr, piece.hasWildcard) == false)
+				continue;
+			remaining = remaining.substr(pos + piece.length);
+			found = true;
+			break;
+		}
+		if(found == false)
+			return false;
+	}
+	return true;
+}
+
+pragma::gamemount::GlobPattern::GlobPattern(std::string_view pattern)
+{
+	split_path(pattern, [this](std::string_view component) {
+		if(component == "**") {
+			// Consecutive recursive components are equivalent to a single one
+			if(m_components.empty() == false && m_components.back().recursive)
+				return;
+			m_components.push_back({GlobMatcher {}, true});
+			return;
+		}
+		m_components.push_back({GlobMatcher {component}, false});
+	});
+	while(m_literalDirectoryCount + 1 < m_components.size() && m_components[m_literalDirectoryCount].IsLiteral())
+		++m_literalDirectoryCount;
+}
+std::string pragma::gamemount::GlobPattern::GetLiteralDirectory() const
+{
+	std::string dir;
+	for(auto i = decltype(m_literalDirectoryCount) {0u}; i < m_literalDirectoryCount; ++i) {
+		dir += m_components[i].matcher.GetLiteralPrefix();
+		dir += '/';
+	}
+	return dir;
+}
+std::optional<std::string> pragma::gamemount::GlobPattern::GetLiteralDirectory(std::string_view path) const
+{
+	std::string dir;
+	size_t componentIdx = 0;
+	auto match = true;
+	split_path(path, [this, &dir, &componentIdx, &match](std::string_view component) {
+		if(componentIdx >= m_literalDirectoryCount)
+			return;
+		auto &matcher = m_components[componentIdx++].matcher;
+		if(matcher.Matches(component) == false)
+			match = false;
+		dir += component;
+		dir += '/';
+	});
+	if(match == false || componentIdx < m_literalDirectoryCount)
+		return {};
+	return dir;
+}
+bool pragma::gamemount::GlobPattern::Matches(std::string_view path, size_t firstComponent) const
+{
+	std::vector<std::string_view> pathComponents;
+	split_path(path, [&pathComponents](std::string_view component) { pathComponents.push_back(component); });
+	return Matches(pathComponents, firstComponent);
+}
+bool pragma::gamemount::GlobPattern::Matches(std::span<const std::string_view> pathComponents, size_t componentIdx) const
+{
+	if(componentIdx == m_components.size())
+		return pathComponents.empty();
+	auto &component = m_components[componentIdx];
+	if(component.recursive) {
+		for(auto i = decltype(pathComponents.size()) {0u}; i <= pathComponents.size(); ++i) {
+			if(Matches(pathComponents.subspan(i), componentIdx + 1))
+				return true;
+		}
+		return false;
+	}
+	if(pathComponents.empty() || component.matcher.Matches(pathComponents.front()) == false)
+		return false;
+	return Matches(pathComponents.subspan(1), componentIdx + 1);
+}
@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <optional>
+#include <cinttypes>
+
+export module pragma.gamemount:globpattern;
+
+export namespace pragma::gamemount {
+	// Matches a single path component against a pattern containing '*' and '?' wildcards (case-insensitive).
+	// The pattern is split at the '*' wildcards once, matching then only has to locate the pieces in order.
+	class GlobMatcher {
+	  public:
+		GlobMatcher() = default;
+		GlobMatcher(std::string_view pattern);
+		bool Matches(std::string_view str) const;
+		// Lowercase text before the first wildcard. Only strings starting with it can match.
+		std::string_view GetLiteralPrefix() const { return std::string_view {m_pattern}.substr(0, m_literalPrefixLength); }
+		bool IsLiteral() const { return m_literalPrefixLength == m_pattern.length(); }
+		bool MatchesAll() const { return m_pattern == "*"; }
+	  private:
+		struct Piece {
+			uint32_t offset = 0;
+			uint32_t length = 0;
+			bool hasWildcard = false;
+		};
+		static bool MatchesPiece(std::string_view str, std::string_view piece, bool hasWildcard);
+		std::string_view GetPiece(const Piece &piece) const { return std::string_view {m_pattern}.substr(piece.offset, piece.length); }
+		std::string m_pattern;
+		// Text between the '*' wildcards. If the pattern contains no '*', there is exactly one piece.
+		std::vector<Piece> m_pieces;
+		size_t m_literalPrefixLength = 0;
+		bool m_hasStar = false;
+	};
+
+	// Path pattern consisting of components separated by '/' or '\', each of which is matched by a GlobMatcher.
+	// A "**" component matches any number of directories, including none.
+	class GlobPattern {
+	  public:
+		struct Component {
+			GlobMatcher matcher;
+			bool recursive = false;
+			bool IsLiteral() const { return recursive == false && matcher.IsLiteral(); }
+		};
+		GlobPattern(std::string_view pattern);
+		const std::vector<Component> &GetComponents() const { return m_components; }
+		// Number of leading literal directory components. These can be resolved directly instead of being matched.
+		size_t GetLiteralDirectoryCount() const { return m_literalDirectoryCount; }
+		std::string GetLiteralDirectory() const;
+		// Same as GetLiteralDirectory, but the case is taken from the path the pattern was created from. Returns an
+		// empty optional if the path doesn't start with the literal directory.
+		std::optional<std::string> GetLiteralDirectory(std::string_view path) const;
+		// Returns true if any directory component contains a wildcard
+		bool HasWildcardDirectories() const { return m_literalDirectoryCount + 1 < m_components.size(); }
+		// Matches a path relative to the specified component against the remaining components
+		bool Matches(std::string_view path, size_t firstComponent = 0) const;
+	  private:
+		bool Matches(std::span<const std::string_view> pathComponents, size_t componentIdx) const;
+		std::vector<Component> m_components;
+		size_t m_literalDirectoryCount = 0;
+	};
+};
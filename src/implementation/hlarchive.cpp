@@ -9,30 +9,59 @@ module;
 #include <memory>
 #include <array>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <mutex>
 
 module pragma.gamemount;
 
 import :archive;
 
+// HLLib operates on a single globally bound package, which is only required to create and destroy packages.
+// Everything else goes through item and stream handles, which only need to be serialized per package.
+static std::mutex g_hlMutex;
+
 pragma::gamemount::hl::Archive::Stream::Stream(Archive &archive, HLDirectoryItem *item, HLStream *stream) : m_archive(archive.shared_from_this()), m_item(item), m_stream(stream) {}
 pragma::gamemount::hl::Archive::Stream::~Stream()
 {
+	std::scoped_lock lock {m_archive->m_mutex};
 	hlStreamClose(m_stream);
 	hlFileReleaseStream(m_item, m_stream);
 }
 uint32_t pragma::gamemount::hl::Archive::Stream::GetSize() const { return hlStreamGetStreamSize(m_stream); }
 bool pragma::gamemount::hl::Archive::Stream::Read(std::vector<uint8_t> &data) const
 {
-	if(m_archive->Bind() == false)
-		return false;
 	auto size = GetSize();
 	data.resize(size);
-	for(auto i = decltype(size) {0}; i < size; ++i) {
-		if(hlStreamReadChar(m_stream, reinterpret_cast<char *>(&data.at(i))) == hlFalse)
-			break;
+	auto numRead = Read(data.data(), 0, size);
+	if(numRead != size) {
+		data.resize(numRead);
+		return false;
 	}
 	return true;
 }
+std::size_t pragma::gamemount::hl::Archive::Stream::Read(void *dst, std::size_t offset, std::size_t len) const
+{
+	std::scoped_lock lock {m_archive->m_mutex};
+	std::size_t size = GetSize();
+	if(offset >= size)
+		return 0;
+	len = std::min(len, size - offset);
+	if(hlStreamSeekEx(m_stream, static_cast<hlLongLong>(offset), HLSeekMode::HL_SEEK_BEGINNING) != offset)
+		return 0;
+	// hlStreamRead is limited to 32-bit lengths, so larger reads are split into blocks
+	auto *pdst = static_cast<uint8_t *>(dst);
+	std::size_t numRead = 0;
+	while(numRead < len) {
+		auto blockSize = static_cast<hlUInt>(std::min<std::size_t>(len - numRead, std::numeric_limits<hlUInt>::max()));
+		auto n = hlStreamRead(m_stream, pdst + numRead, blockSize);
+		if(n == 0)
+			break;
+		numRead += n;
+	}
+	return numRead;
+}
 
 //////////////////
 
@@ -69,8 +98,10 @@ std::shared_ptr<pragma::gamemount::hl::Archive> pragma::gamemount::hl::Archive::
 	if(type == HLPackageType::HL_PACKAGE_NONE)
 		return nullptr;
 	auto parchive = std::shared_ptr<Archive>(new Archive());
+	std::scoped_lock lock {g_hlMutex};
 	if(hlCreatePackage(type, &parchive->m_uiPackage) == hlFalse || parchive->Bind() == false || hlPackageOpenFile(path.c_str(), HL_MODE_READ) == hlFalse)
 		return nullptr;
+	parchive->m_packageRoot = hlPackageGetRoot();
 	return parchive;
 }
 
@@ -80,36 +111,41 @@ bool pragma::gamemount::hl::Archive::Bind() { return static_cast<bool>(hlBindPac
 
 pragma::gamemount::hl::Archive::Directory pragma::gamemount::hl::Archive::GetRoot() const
 {
-	auto *root = hlPackageGetRoot();
+	// The root directory has to match the one used by OpenFile, otherwise indexed paths would not resolve
+	auto *root = m_rootDir ? m_rootDir : m_packageRoot;
 	return Directory(root);
 }
 
 void pragma::gamemount::hl::Archive::SetRootDirectory(const std::string &path)
 {
-	auto *root = hlPackageGetRoot();
-	m_rootDir = hlFolderGetItemByPath(root, path.c_str(), HLFindType::HL_FIND_FOLDERS);
+	m_rootDir = hlFolderGetItemByPath(m_packageRoot, path.c_str(), HLFindType::HL_FIND_FOLDERS);
 }
 
 std::shared_ptr<pragma::gamemount::hl::Archive::Stream> pragma::gamemount::hl::Archive::OpenFile(const std::string &fname)
 {
-	if(Bind() == false)
-		return nullptr;
-	auto *root = m_rootDir ? m_rootDir : hlPackageGetRoot();
+	auto *root = m_rootDir ? m_rootDir : m_packageRoot;
+	std::unique_lock lock {m_mutex};
 	auto *item = hlFolderGetItemByPath(root, fname.c_str(), HLFindType::HL_FIND_FILES);
+	// The contents of a top-level 'root' directory are indexed as if they were located in the archive root
+	if(item == nullptr)
+		item = hlFolderGetItemByPath(root, ("root/" + fname).c_str(), HLFindType::HL_FIND_FILES);
 	if(item == nullptr)
 		return nullptr;
 	HLStream *pStream = nullptr;
 	if(hlFileCreateStream(item, &pStream) == hlFalse)
 		return nullptr;
-	auto stream = std::make_shared<Stream>(*this, item, pStream);
-	if(hlStreamOpen(pStream, HL_MODE_READ) == hlFalse)
+	if(hlStreamOpen(pStream, HL_MODE_READ) == hlFalse) {
+		hlFileReleaseStream(item, pStream);
 		return nullptr;
-	return stream;
+	}
+	lock.unlock();
+	return std::make_shared<Stream>(*this, item, pStream);
 }
 
 pragma::gamemount::hl::Archive::~Archive()
 {
 	if(m_uiPackage != std::numeric_limits<hlUInt>::max()) {
+		std::scoped_lock lock {g_hlMutex};
 		if(Bind() == true)
 			hlPackageClose();
 		hlDeletePackage(m_uiPackage);
@@ -0,0 +1,307 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <array>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <random>
+#include <functional>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :indexcache;
+import :archivedata;
+import :mappedfile;
+import :bloomfilter;
+
+namespace pragma::gamemount {
+	// Cache file layout: header, key (archive path and root directory), padding, nodes, name pool
+	struct IndexCacheHeader {
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint64_t archiveSize;
+		int64_t archiveModificationTime;
+		uint32_t archiveType;
+		uint32_t nodeSize;
+		uint32_t nodeCount;
+		uint32_t keyLength;
+		uint64_t namePoolSize;
+	};
+	static_assert(sizeof(IndexCacheHeader) == 48, "Index cache header must not contain padding");
+	static constexpr std::array<char, 4> INDEX_CACHE_MAGIC = {'U', 'A', 'I', 'X'};
+
+	// Summary file layout: header, key, padding, filter bits, root directory names separated by '\n'
+	struct SummaryCacheHeader {
+		std::array<char, 4> magic;
+		uint32_t version;
+		uint64_t archiveSize;
+		int64_t archiveModificationTime;
+		uint32_t keyLength;
+		uint32_t hashCount;
+		uint64_t wordCount;
+		uint64_t rootDirectoriesSize;
+	};
+	static_assert(sizeof(SummaryCacheHeader) == 48, "Summary cache header must not contain padding");
+	static constexpr std::array<char, 4> SUMMARY_CACHE_MAGIC = {'U', 'A', 'S', 'M'};
+	static constexpr size_t align_index_cache_offset(size_t offset) { return (offset + 7) & ~size_t {7}; }
+};
+
+void pragma::gamemount::IndexCache::SetDirectory(const std::string &path)
+{
+	std::scoped_lock lock {m_mutex};
+	m_directory = path;
+}
+std::string pragma::gamemount::IndexCache::GetDirectory() const
+{
+	std::scoped_lock lock {m_mutex};
+	return m_directory;
+}
+bool pragma::gamemount::IndexCache::IsEnabled() const { return GetDirectory().empty() == false; }
+
+std::optional<pragma::gamemount::IndexCache::SourceInfo> pragma::gamemount::IndexCache::GetSourceInfo(const std::string &archivePath)
+{
+	std::error_code ec;
+	SourceInfo info {};
+	info.fileSize = std::filesystem::file_size(archivePath, ec);
+	if(ec)
+		return {};
+	auto time = std::filesystem::last_write_time(archivePath, ec);
+	if(ec)
+		return {};
+	info.modificationTime = static_cast<int64_t>(time.time_since_epoch().count());
+	return info;
+}
+
+std::string pragma::gamemount::IndexCache::GetKey(const std::string &archivePath, const std::string &rootDir) { return archivePath + '\n' + rootDir; }
+
+std::string pragma::gamemount::IndexCache::GetCacheFilePath(const std::string &key, const char *extension) const
+{
+	// FNV-1a, which is stable across builds and platforms
+	uint64_t hash = 14695981039346656037ull;
+	for(auto c : key) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ull;
+	}
+	std::array<char, 17> name;
+	snprintf(name.data(), name.size(), "%016llx", static_cast<unsigned long long>(hash));
+	auto dir = GetDirectory();
+	if(dir.empty() == false && dir.back() != '/' && dir.back() != '\\')
+		dir += '/';
+	return dir + name.data() + extension;
+}
+
+std::optional<pragma::gamemount::ArchiveFileTable> pragma::gamemount::IndexCache::Load(const std::string &archivePath, const std::string &rootDir) const
+{
+	auto sourceInfo = GetSourceInfo(archivePath);
+	if(sourceInfo.has_value() == false)
+		return {};
+	auto key = GetKey(archivePath, rootDir);
+	std::shared_ptr<MappedFile> file = MappedFile::Open(GetCacheFilePath(key));
+	if(file == nullptr || file->GetSize() < sizeof(IndexCacheHeader))
+		return {};
+	IndexCacheHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if(header.magic != INDEX_CACHE_MAGIC || header.version != VERSION || header.nodeSize != sizeof(ArchiveFileTable::Node) || header.archiveSize != sourceInfo->fileSize || header.archiveModificationTime != sourceInfo->modificationTime
+	  || header.nodeCount == 0 || header.archiveType > static_cast<uint32_t>(ArchiveType::Ba2))
+		return {};
+	auto keyOffset = sizeof(header);
+	auto nodeOffset = align_index_cache_offset(keyOffset + header.keyLength);
+	auto nameOffset = nodeOffset + static_cast<size_t>(header.nodeCount) * header.nodeSize;
+	if(nameOffset + header.namePoolSize != file->GetSize())
+		return {};
+	// The file name is a hash, so the key has to be compared as well
+	if(std::string_view {reinterpret_cast<const char *>(file->GetData() + keyOffset), header.keyLength} != key)
+		return {};
+
+	std::span<const ArchiveFileTable::Node> nodes {reinterpret_cast<const ArchiveFileTable::Node *>(file->GetData() + nodeOffset), header.nodeCount};
+	std::string_view namePool {reinterpret_cast<const char *>(file->GetData() + nameOffset), static_cast<size_t>(header.namePoolSize)};
+	for(size_t i = 0; i < nodes.size(); ++i) {
+		auto &node = nodes[i];
+		if(static_cast<uint64_t>(node.nameOffset) + node.nameLength > namePool.size() || static_cast<uint64_t>(node.firstChild) + node.childCount > nodes.size())
+			return {};
+		// Children always come after their parent, which also rules out cycles
+		if(node.childCount > 0 && node.firstChild <= i)
+			return {};
+		// Checked on the raw byte, any value other than 0 or 1 would not be a valid bool
+		uint8_t directory;
+		memcpy(&directory, file->GetData() + nodeOffset + i * sizeof(ArchiveFileTable::Node) + offsetof(ArchiveFileTable::Node, directory), sizeof(directory));
+		if(directory > 1)
+			return {};
+	}
+	ArchiveFileTable table {nullptr};
+	table.type = static_cast<ArchiveType>(header.archiveType);
+	table.SetData(file, nodes, namePool);
+	return table;
+}
+
+bool pragma::gamemount::IndexCache::Save(const std::string &archivePath, const std::string &rootDir, const ArchiveFileTable &table) const
+{
+	auto sourceInfo = GetSourceInfo(archivePath);
+	if(sourceInfo.has_value() == false)
+		return false;
+	auto key = GetKey(archivePath, rootDir);
+	auto nodes = table.GetNodes();
+	auto namePool = table.GetNamePool();
+	IndexCacheHeader header {};
+	header.magic = INDEX_CACHE_MAGIC;
+	header.version = VERSION;
+	header.archiveSize = sourceInfo->fileSize;
+	header.archiveModificationTime = sourceInfo->modificationTime;
+	header.archiveType = static_cast<uint32_t>(table.type);
+	header.nodeSize = sizeof(ArchiveFileTable::Node);
+	header.nodeCount = static_cast<uint32_t>(nodes.size());
+	header.keyLength = static_cast<uint32_t>(key.length());
+	header.namePoolSize = namePool.size();
+
+	// The nodes are written field by field into zeroed memory, so the padding bytes are zero and the same table always
+	// produces the same file
+	using Node = ArchiveFileTable::Node;
+	std::vector<char> nodeData(nodes.size_bytes(), 0);
+	for(size_t i = 0; i < nodes.size(); ++i) {
+		auto &node = nodes[i];
+		auto *dst = nodeData.data() + i * sizeof(Node);
+		uint8_t directory = node.directory ? 1 : 0;
+		memcpy(dst + offsetof(Node, nameOffset), &node.nameOffset, sizeof(node.nameOffset));
+		memcpy(dst + offsetof(Node, nameLength), &node.nameLength, sizeof(node.nameLength));
+		memcpy(dst + offsetof(Node, firstChild), &node.firstChild, sizeof(node.firstChild));
+		memcpy(dst + offsetof(Node, childCount), &node.childCount, sizeof(node.childCount));
+		memcpy(dst + offsetof(Node, directory), &directory, sizeof(directory));
+	}
+
+	return WriteCacheFile(GetCacheFilePath(key), [&header, &key, &nodeData, &namePool](std::ofstream &f) {
+		std::array<char, 8> padding {};
+		f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		f.write(key.data(), key.length());
+		f.write(padding.data(), align_index_cache_offset(sizeof(header) + key.length()) - (sizeof(header) + key.length()));
+		f.write(nodeData.data(), nodeData.size());
+		f.write(namePool.data(), namePool.size());
+	});
+}
+
+bool pragma::gamemount::IndexCache::WriteCacheFile(const std::string &path, const std::function<void(std::ofstream &)> &write)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path {path}.parent_path(), ec);
+	auto tmpPath = path + ".tmp" + std::to_string(std::random_device {}());
+	{
+		std::ofstream f {tmpPath, std::ios::binary | std::ios::trunc};
+		if(f.is_open() == false)
+			return false;
+		write(f);
+		if(f.good() == false) {
+			f.close();
+			std::filesystem::remove(tmpPath, ec);
+			return false;
+		}
+	}
+	std::filesystem::rename(tmpPath, path, ec);
+	if(ec) {
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+pragma::gamemount::ArchiveSummary pragma::gamemount::ArchiveSummary::Create(const ArchiveFileTable &table)
+{
+	ArchiveSummary summary {};
+	summary.filter = BloomFilter {table.GetFileCount()};
+	table.GetFilePaths([&summary](const std::string &path) { summary.filter.Add(path); });
+	if(table.GetNodeCount() > 0) {
+		for(auto &child : table.GetChildren(table.GetNode(table.GetRoot()))) {
+			if(child.directory)
+				summary.rootDirectories.push_back(std::string {table.GetName(child)});
+		}
+	}
+	std::sort(summary.rootDirectories.begin(), summary.rootDirectories.end());
+	return summary;
+}
+bool pragma::gamemount::ArchiveSummary::ContainsRootDirectory(std::string_view name) const { return std::binary_search(rootDirectories.begin(), rootDirectories.end(), name); }
+
+std::shared_ptr<const pragma::gamemount::ArchiveSummary> pragma::gamemount::IndexCache::LoadSummary(const std::string &archivePath, const std::string &rootDir) const
+{
+	auto sourceInfo = GetSourceInfo(archivePath);
+	if(sourceInfo.has_value() == false)
+		return nullptr;
+	auto key = GetKey(archivePath, rootDir);
+	auto file = MappedFile::Open(GetCacheFilePath(key, ".sum"));
+	if(file == nullptr || file->GetSize() < sizeof(SummaryCacheHeader))
+		return nullptr;
+	SummaryCacheHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if(header.magic != SUMMARY_CACHE_MAGIC || header.version != VERSION || header.archiveSize != sourceInfo->fileSize || header.archiveModificationTime != sourceInfo->modificationTime || header.hashCount == 0
+	  || header.wordCount == 0)
+		return nullptr;
+	auto keyOffset = sizeof(header);
+	auto bitsOffset = align_index_cache_offset(keyOffset + header.keyLength);
+	if(header.wordCount > (file->GetSize() - std::min<size_t>(bitsOffset, file->GetSize())) / sizeof(uint64_t))
+		return nullptr;
+	auto namesOffset = bitsOffset + header.wordCount * sizeof(uint64_t);
+	if(namesOffset + header.rootDirectoriesSize != file->GetSize())
+		return nullptr;
+	if(std::string_view {reinterpret_cast<const char *>(file->GetData() + keyOffset), header.keyLength} != key)
+		return nullptr;
+
+	std::vector<uint64_t> bits(header.wordCount);
+	memcpy(bits.data(), file->GetData() + bitsOffset, bits.size() * sizeof(bits.front()));
+	auto summary = std::make_shared<ArchiveSummary>();
+	summary->filter = BloomFilter {std::move(bits), header.hashCount};
+	std::string_view names {reinterpret_cast<const char *>(file->GetData() + namesOffset), static_cast<size_t>(header.rootDirectoriesSize)};
+	while(names.empty() == false) {
+		auto end = names.find('\n');
+		summary->rootDirectories.push_back(std::string {names.substr(0, end)});
+		names = (end != std::string_view::npos) ? names.substr(end + 1) : std::string_view {};
+	}
+	if(std::is_sorted(summary->rootDirectories.begin(), summary->rootDirectories.end()) == false)
+		return nullptr;
+	return summary;
+}
+
+bool pragma::gamemount::IndexCache::SaveSummary(const std::string &archivePath, const std::string &rootDir, const ArchiveSummary &summary) const
+{
+	auto sourceInfo = GetSourceInfo(archivePath);
+	if(sourceInfo.has_value() == false)
+		return false;
+	auto key = GetKey(archivePath, rootDir);
+	auto &bits = summary.filter.GetBits();
+	std::string names;
+	for(auto &name : summary.rootDirectories) {
+		if(names.empty() == false)
+			names += '\n';
+		names += name;
+	}
+	SummaryCacheHeader header {};
+	header.magic = SUMMARY_CACHE_MAGIC;
+	header.version = VERSION;
+	header.archiveSize = sourceInfo->fileSize;
+	header.archiveModificationTime = sourceInfo->modificationTime;
+	header.keyLength = static_cast<uint32_t>(key.length());
+	header.hashCount = summary.filter.GetHashCount();
+	header.wordCount = bits.size();
+	header.rootDirectoriesSize = names.size();
+	return WriteCacheFile(GetCacheFilePath(key, ".sum"), [&header, &key, &bits, &names](std::ofstream &f) {
+		std::array<char, 8> padding {};
+		f.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		f.write(key.data(), key.length());
+		f.write(padding.data(), align_index_cache_offset(sizeof(header) + key.length()) - (sizeof(header) + key.length()));
+		f.write(reinterpret_cast<const char *>(bits.data()), bits.size() * sizeof(bits.front()));
+		f.write(names.data(), names.size());
+	});
+}
+
+bool pragma::gamemount::IndexCache::HasSummary(const std::string &archivePath, const std::string &rootDir) const
+{
+	std::error_code ec;
+	return std::filesystem::is_regular_file(GetCacheFilePath(GetKey(archivePath, rootDir), ".sum"), ec);
+}
@@ -0,0 +1,64 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <functional>
+#include <fstream>
+#include <cinttypes>
+
+export module pragma.gamemount:indexcache;
+
+import :archivedata;
+import :bloomfilter;
+
+export namespace pragma::gamemount {
+	// Compact description of the contents of an archive, which allows ruling out lookups without indexing it
+	struct ArchiveSummary {
+		static ArchiveSummary Create(const ArchiveFileTable &table);
+		// Contains the index paths of all files
+		BloomFilter filter;
+		// Names of the directories in the archive root, sorted
+		std::vector<std::string> rootDirectories;
+		bool ContainsRootDirectory(std::string_view name) const;
+	};
+
+	// Stores the file tables of archives on disk, so they don't have to be rebuilt on every start.
+	// Each archive gets its own cache file, which is validated against the size and modification time of the
+	// archive and mapped into memory when loaded. Tables loaded from the cache reference the mapped file directly.
+	class IndexCache {
+	  public:
+		static constexpr uint32_t VERSION = 1;
+		// An empty directory disables the cache
+		void SetDirectory(const std::string &path);
+		std::string GetDirectory() const;
+		bool IsEnabled() const;
+
+		std::optional<ArchiveFileTable> Load(const std::string &archivePath, const std::string &rootDir) const;
+		bool Save(const std::string &archivePath, const std::string &rootDir, const ArchiveFileTable &table) const;
+		// Summaries are stored next to the file tables and validated the same way
+		std::shared_ptr<const ArchiveSummary> LoadSummary(const std::string &archivePath, const std::string &rootDir) const;
+		bool SaveSummary(const std::string &archivePath, const std::string &rootDir, const ArchiveSummary &summary) const;
+		bool HasSummary(const std::string &archivePath, const std::string &rootDir) const;
+	  private:
+		struct SourceInfo {
+			uint64_t fileSize = 0;
+			int64_t modificationTime = 0;
+		};
+		static std::optional<SourceInfo> GetSourceInfo(const std::string &archivePath);
+		static std::string GetKey(const std::string &archivePath, const std::string &rootDir);
+		// The extension distinguishes the file tables from the summaries
+		std::string GetCacheFilePath(const std::string &key, const char *extension = ".idx") const;
+		// Writes to a temporary file first, so other processes never see a partially written cache file
+		static bool WriteCacheFile(const std::string &path, const std::function<void(std::ofstream &)> &write);
+		std::string m_directory;
+		mutable std::mutex m_mutex;
+	};
+};
@@ -0,0 +1,137 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <sharedutils/util.h>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :iopool;
+
+pragma::gamemount::IoPool::~IoPool() { Stop(); }
+
+void pragma::gamemount::IoPool::SetWorkerCount(uint32_t count)
+{
+	std::scoped_lock lock {m_mutex};
+	m_workerCount = count;
+}
+
+pragma::gamemount::IoPool::RequestId pragma::gamemount::IoPool::Submit(int32_t priority, const Task &task)
+{
+	std::unique_lock lock {m_mutex};
+	auto id = m_nextId++;
+	QueueKey key {-static_cast<int64_t>(priority), id};
+	m_queue.insert(std::make_pair(key, task));
+	m_queueKeys.insert(std::make_pair(id, key));
+	if(m_workers.empty()) {
+		// Reads are mostly bound by I/O, so a few threads are enough
+		auto count = m_workerCount;
+		if(count == 0)
+			count = std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+		m_stop = false;
+		m_workers.reserve(count);
+		for(auto i = decltype(count) {0u}; i < count; ++i) {
+			m_workers.push_back(std::thread {[this]() { Run(); }});
+			util::set_thread_name(m_workers.back(), "uarch_io_worker");
+		}
+	}
+	lock.unlock();
+	m_condition.notify_one();
+	return id;
+}
+
+bool pragma::gamemount::IoPool::Cancel(RequestId id)
+{
+	Task task;
+	{
+		std::scoped_lock lock {m_mutex};
+		auto itKey = m_queueKeys.find(id);
+		if(itKey == m_queueKeys.end())
+			return false;
+		auto it = m_queue.find(itKey->second);
+		task = std::move(it->second);
+		m_queue.erase(it);
+		m_queueKeys.erase(itKey);
+	}
+	Execute(task, true);
+	return true;
+}
+
+void pragma::gamemount::IoPool::Execute(const Task &task, bool cancelled)
+{
+	try {
+		task(cancelled);
+	}
+	catch(...) {
+	}
+}
+
+void pragma::gamemount::IoPool::Run()
+{
+	for(;;) {
+		Task task;
+		{
+			std::unique_lock lock {m_mutex};
+			m_condition.wait(lock, [this]() { return m_stop || m_queue.empty() == false; });
+			if(m_queue.empty())
+				return;
+			auto it = m_queue.begin();
+			task = std::move(it->second);
+			m_queueKeys.erase(it->first.second);
+			m_queue.erase(it);
+		}
+		Execute(task, false);
+	}
+}
+
+void pragma::gamemount::IoPool::Stop()
+{
+	std::map<QueueKey, Task> queue;
+	std::vector<std::thread> workers;
+	{
+		std::scoped_lock lock {m_mutex};
+		queue = std::move(m_queue);
+		m_queue.clear();
+		m_queueKeys.clear();
+		workers = std::move(m_workers);
+		m_workers.clear();
+		m_stop = true;
+	}
+	m_condition.notify_all();
+	for(auto &[key, task] : queue)
+		Execute(task, true);
+	for(auto &worker : workers)
+		worker.join();
+}
+
+void pragma::gamemount::IoPool::PostCompletion(const std::function<void()> &handler)
+{
+	std::scoped_lock lock {m_completionMutex};
+	m_completions.push_back(handler);
+}
+
+uint32_t pragma::gamemount::IoPool::PollCompletions(uint32_t maxCount)
+{
+	uint32_t count = 0;
+	while(count < maxCount) {
+		std::function<void()> handler;
+		{
+			std::scoped_lock lock {m_completionMutex};
+			if(m_completions.empty())
+				break;
+			handler = std::move(m_completions.front());
+			m_completions.pop_front();
+		}
+		handler();
+		++count;
+	}
+	return count;
+}
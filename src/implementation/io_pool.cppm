@@ -0,0 +1,62 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <limits>
+#include <cinttypes>
+
+export module pragma.gamemount:iopool;
+
+export namespace pragma::gamemount {
+	// Worker threads for asynchronous archive reads. Queued tasks are processed by priority (highest first),
+	// tasks with the same priority in submission order. Completion handlers posted by the tasks are collected
+	// and run by whichever thread calls PollCompletions.
+	class IoPool {
+	  public:
+		using RequestId = uint64_t;
+		// Called with cancelled=true if the request was cancelled before it was started
+		using Task = std::function<void(bool cancelled)>;
+		IoPool() = default;
+		IoPool(const IoPool &) = delete;
+		IoPool &operator=(const IoPool &) = delete;
+		~IoPool();
+		// Takes effect the next time the workers are started. 0 picks a default based on the hardware.
+		void SetWorkerCount(uint32_t count);
+		RequestId Submit(int32_t priority, const Task &task);
+		// Returns false if the task has already been started
+		bool Cancel(RequestId id);
+		// Cancels all queued tasks and waits for the running ones to complete
+		void Stop();
+
+		void PostCompletion(const std::function<void()> &handler);
+		uint32_t PollCompletions(uint32_t maxCount = std::numeric_limits<uint32_t>::max());
+	  private:
+		// Highest priority first, then lowest id
+		using QueueKey = std::pair<int64_t, RequestId>;
+		// Tasks are expected to report their own failures. An exception escaping a task is caught here, so it cannot
+		// terminate the worker thread or the thread calling Stop.
+		static void Execute(const Task &task, bool cancelled);
+		void Run();
+		std::map<QueueKey, Task> m_queue;
+		std::unordered_map<RequestId, QueueKey> m_queueKeys;
+		std::vector<std::thread> m_workers;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		RequestId m_nextId = 1;
+		uint32_t m_workerCount = 0;
+		bool m_stop = false;
+
+		std::deque<std::function<void()>> m_completions;
+		std::mutex m_completionMutex;
+	};
+};
@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <memory>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+module pragma.gamemount;
+
+import :mappedfile;
+
+std::unique_ptr<pragma::gamemount::MappedFile> pragma::gamemount::MappedFile::Open(const std::string &path)
+{
+	auto file = std::unique_ptr<MappedFile> {new MappedFile {}};
+#ifdef _WIN32
+	auto hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return nullptr;
+	file->m_fileHandle = hFile;
+	LARGE_INTEGER size;
+	if(GetFileSizeEx(hFile, &size) == FALSE)
+		return nullptr;
+	file->m_size = static_cast<size_t>(size.QuadPart);
+	if(file->m_size == 0)
+		return file;
+	file->m_mappingHandle = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(file->m_mappingHandle == nullptr)
+		return nullptr;
+	file->m_data = static_cast<const uint8_t *>(MapViewOfFile(file->m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if(file->m_data == nullptr)
+		return nullptr;
+#else
+	auto fd = ::open(path.c_str(), O_RDONLY);
+	if(fd == -1)
+		return nullptr;
+	struct stat st {};
+	if(fstat(fd, &st) != 0) {
+		::close(fd);
+		return nullptr;
+	}
+	file->m_size = static_cast<size_t>(st.st_size);
+	if(file->m_size > 0) {
+		auto *data = mmap(nullptr, file->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED) {
+			::close(fd);
+			return nullptr;
+		}
+		file->m_data = static_cast<const uint8_t *>(data);
+	}
+	// The mapping stays valid after the descriptor has been closed
+	::close(fd);
+#endif
+	return file;
+}
+
+pragma::gamemount::MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if(m_data)
+		UnmapViewOfFile(m_data);
+	if(m_mappingHandle)
+		CloseHandle(m_mappingHandle);
+	if(m_fileHandle)
+		CloseHandle(m_fileHandle);
+#else
+	if(m_data)
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+}
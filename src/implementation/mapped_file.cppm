@@ -0,0 +1,34 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <span>
+#include <memory>
+#include <cinttypes>
+
+export module pragma.gamemount:mappedfile;
+
+export namespace pragma::gamemount {
+	// Read-only memory mapping of an entire file
+	class MappedFile {
+	  public:
+		static std::unique_ptr<MappedFile> Open(const std::string &path);
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+		~MappedFile();
+		const uint8_t *GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+		std::span<const uint8_t> GetView() const { return {m_data, m_size}; }
+	  private:
+		MappedFile() = default;
+		const uint8_t *m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void *m_fileHandle = nullptr;
+		void *m_mappingHandle = nullptr;
+#endif
+	};
+};
@@ -0,0 +1,39 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+module pragma.gamemount;
+
+import :pathindex;
+import :pathnormalizer;
+
+void pragma::gamemount::PathIndex::AddArchiveFileTable(const ArchiveFileTable &table, uint32_t gameMountInfoIdx, uint32_t archiveIdx)
+{
+	Entry entry {gameMountInfoIdx, archiveIdx};
+	table.GetFilePaths([this, &entry](const std::string &path) { Add(path, entry); });
+}
+void pragma::gamemount::PathIndex::Add(const std::string &path, const Entry &entry)
+{
+	auto &entries = m_entries[path];
+	auto it = std::find_if(entries.begin(), entries.end(), [&entry](const Entry &other) { return other.gameMountInfoIndex == entry.gameMountInfoIndex && other.archiveIndex == entry.archiveIndex; });
+	if(it != entries.end())
+		return;
+	entries.push_back(entry);
+}
+void pragma::gamemount::PathIndex::Clear() { m_entries.clear(); }
+const std::vector<pragma::gamemount::PathIndex::Entry> *pragma::gamemount::PathIndex::Find(std::string_view path) const
+{
+	auto it = m_entries.find(path);
+	return (it != m_entries.end()) ? &it->second : nullptr;
+}
+const std::vector<pragma::gamemount::PathIndex::Entry> *pragma::gamemount::PathIndex::Find(const NormalizedPath &path) const
+{
+	auto it = m_entries.find(path);
+	return (it != m_entries.end()) ? &it->second : nullptr;
+}
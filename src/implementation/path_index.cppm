@@ -0,0 +1,38 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include <unordered_map>
+#include <string_view>
+
+export module pragma.gamemount:pathindex;
+
+import :archivedata;
+import :pathnormalizer;
+
+export namespace pragma::gamemount {
+	// Maps normalized archive file paths of a mounted game to the archives that contain them
+	class PathIndex {
+	  public:
+		struct Entry {
+			uint32_t gameMountInfoIndex = 0;
+			uint32_t archiveIndex = 0;
+		};
+		void AddArchiveFileTable(const ArchiveFileTable &table, uint32_t gameMountInfoIdx, uint32_t archiveIdx);
+		void Add(const std::string &path, const Entry &entry);
+		void Clear();
+
+		// Entries are in the order they were added
+		const std::vector<Entry> *Find(std::string_view path) const;
+		// Reuses the hash of the path
+		const std::vector<Entry> *Find(const NormalizedPath &path) const;
+		size_t GetEntryCount() const { return m_entries.size(); }
+	  private:
+		std::unordered_map<std::string, std::vector<Entry>, PathHash, PathEqual> m_entries;
+	};
+};
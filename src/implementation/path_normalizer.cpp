@@ -0,0 +1,135 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UARCH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+module pragma.gamemount;
+
+import :pathnormalizer;
+
+uint64_t pragma::gamemount::hash_path(std::string_view path)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for(auto c : path) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+void pragma::gamemount::fold_path(const char *src, char *dst, size_t length)
+{
+	size_t i = 0;
+#ifdef UARCH_SSE2
+	// 16 characters at a time. Characters outside of the ASCII range are negative and never count as uppercase.
+	auto upperMin = _mm_set1_epi8('A' - 1);
+	auto upperMax = _mm_set1_epi8('Z' + 1);
+	auto caseBit = _mm_set1_epi8(0x20);
+	auto backslash = _mm_set1_epi8('\\');
+	auto slash = _mm_set1_epi8('/');
+	for(; i + 16 <= length; i += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		auto isUpper = _mm_and_si128(_mm_cmpgt_epi8(v, upperMin), _mm_cmplt_epi8(v, upperMax));
+		v = _mm_or_si128(v, _mm_and_si128(isUpper, caseBit));
+		auto isBackslash = _mm_cmpeq_epi8(v, backslash);
+		v = _mm_or_si128(_mm_andnot_si128(isBackslash, v), _mm_and_si128(isBackslash, slash));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+	}
+#endif
+	for(; i < length; ++i) {
+		auto c = src[i];
+		if(c >= 'A' && c <= 'Z')
+			c = static_cast<char>(c + ('a' - 'A'));
+		else if(c == '\\')
+			c = '/';
+		dst[i] = c;
+	}
+}
+
+// Resolves the components of a folded path in place and returns the new length.
+// The buffer has to have room for one character past the end of the path.
+static size_t canonicalize_path(char *data, size_t length, pragma::gamemount::PathConvention convention)
+{
+	// Output before this offset can't be removed by a '..' component
+	size_t base = 0;
+	size_t out = 0;
+	size_t pos = 0;
+	auto first = true;
+	while(pos < length) {
+		auto *sep = static_cast<const char *>(std::memchr(data + pos, '/', length - pos));
+		auto end = sep ? static_cast<size_t>(sep - data) : length;
+		std::string_view component {data + pos, end - pos};
+		if(component == "..") {
+			if(first) {
+				// A leading '..' refers to the directory above the game directory and is kept
+				std::memcpy(data, "../", 3);
+				out = base = 3;
+			}
+			else if(out > base) {
+				--out;
+				while(out > base && data[out - 1] != '/')
+					--out;
+			}
+		}
+		else if(component.empty() == false && component != ".") {
+			std::memmove(data + out, data + pos, component.length());
+			out += component.length();
+			data[out++] = '/';
+		}
+		if(component.empty() == false)
+			first = false;
+		pos = end + 1;
+	}
+	if(out > base && data[out - 1] == '/')
+		--out;
+	if(base > 0)
+		return out;
+
+	// The aliases only apply to the top-level directory and are never longer than the name they replace
+	std::string_view front {data, out};
+	front = front.substr(0, front.find('/'));
+	auto replaceFront = [data, &out, &front](std::string_view replacement) {
+		auto offset = front.length();
+		if(replacement.empty() && offset < out)
+			++offset; // Separator
+		if(replacement.empty() == false)
+			std::memcpy(data, replacement.data(), replacement.length());
+		std::memmove(data + replacement.length(), data + offset, out - offset);
+		out -= offset - replacement.length();
+	};
+	if(front == "sounds")
+		replaceFront("sound");
+	else if(convention == pragma::gamemount::PathConvention::Gamebryo) {
+		if(front == "materials")
+			replaceFront("textures");
+		else if(front == "models")
+			replaceFront({});
+	}
+	return out;
+}
+
+pragma::gamemount::NormalizedPath::NormalizedPath(std::string_view path, PathConvention convention)
+{
+	char *data;
+	if(path.length() < m_buffer.size())
+		data = m_buffer.data();
+	else {
+		m_overflow.resize(path.length() + 1);
+		data = m_overflow.data();
+	}
+	fold_path(path.data(), data, path.length());
+	m_length = canonicalize_path(data, path.length(), convention);
+	if(m_overflow.empty() == false)
+		m_overflow.resize(m_length);
+	m_hash = hash_path(GetString());
+}
@@ -0,0 +1,61 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <array>
+#include <cinttypes>
+
+export module pragma.gamemount:pathnormalizer;
+
+export namespace pragma::gamemount {
+	// Determines which top-level directories are aliases of others
+	enum class PathConvention : uint8_t {
+		// "sounds" -> "sound"
+		Source = 0,
+		// "sounds" -> "sound", "materials" -> "textures", "models" is dropped
+		Gamebryo,
+	};
+
+	// 64-bit FNV-1a. All hashes of index paths have to be computed with this function, so they can be reused by lookups.
+	uint64_t hash_path(std::string_view path);
+	// Copies the path while lowercasing ASCII letters and replacing '\' with '/'. dst may be the same as src.
+	void fold_path(const char *src, char *dst, size_t length);
+
+	// Index path of a file: Lowercase, separated by '/', without '.' components and with '..' components resolved
+	// (except for a leading one), and with the directory aliases of the path convention applied.
+	// Paths that fit into the inline buffer are normalized without allocating.
+	class NormalizedPath {
+	  public:
+		static constexpr size_t INLINE_CAPACITY = 260;
+		explicit NormalizedPath(std::string_view path, PathConvention convention = PathConvention::Source);
+		std::string_view GetString() const { return {GetData(), m_length}; }
+		operator std::string_view() const { return GetString(); }
+		uint64_t GetHash() const { return m_hash; }
+	  private:
+		const char *GetData() const { return m_overflow.empty() ? m_buffer.data() : m_overflow.data(); }
+		std::array<char, INLINE_CAPACITY> m_buffer;
+		// Only used for paths that don't fit into the buffer
+		std::string m_overflow;
+		size_t m_length = 0;
+		uint64_t m_hash = 0;
+	};
+
+	// Hash and equality for containers keyed by index paths. A NormalizedPath can be looked up without rehashing it.
+	struct PathHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view path) const { return static_cast<size_t>(hash_path(path)); }
+		size_t operator()(const NormalizedPath &path) const { return static_cast<size_t>(path.GetHash()); }
+	};
+	struct PathEqual {
+		using is_transparent = void;
+		template<typename T0, typename T1>
+		bool operator()(const T0 &path0, const T1 &path1) const
+		{
+			return std::string_view {path0} == std::string_view {path1};
+		}
+	};
+};
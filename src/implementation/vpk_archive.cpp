@@ -0,0 +1,256 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <sharedutils/util_string.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <array>
+
+module pragma.gamemount;
+
+import :vpkarchive;
+import :mappedfile;
+
+namespace pragma::gamemount::vpk {
+	static constexpr uint32_t SIGNATURE = 0x55aa1234;
+	static constexpr uint16_t ENTRY_TERMINATOR = 0xffff;
+	static constexpr size_t HEADER_SIZE_V1 = 12;
+	static constexpr size_t HEADER_SIZE_V2 = 28;
+	static constexpr size_t ENTRY_SIZE = 18;
+	template<typename T>
+	static T read_value(const uint8_t *data)
+	{
+		T value;
+		memcpy(&value, data, sizeof(T));
+		return value;
+	}
+};
+
+std::shared_ptr<pragma::gamemount::vpk::Archive> pragma::gamemount::vpk::Archive::Create(const std::string &path)
+{
+	auto archive = std::shared_ptr<Archive> {new Archive {}};
+	if(archive->Load(path) == false)
+		return nullptr;
+	return archive;
+}
+
+bool pragma::gamemount::vpk::Archive::Load(const std::string &path)
+{
+	m_directory = MappedFile::Open(path);
+	if(m_directory == nullptr || m_directory->GetSize() < HEADER_SIZE_V1)
+		return false;
+	auto *data = m_directory->GetData();
+	auto size = m_directory->GetSize();
+	if(read_value<uint32_t>(data) != SIGNATURE)
+		return false;
+	auto version = read_value<uint32_t>(data + 4);
+	auto treeSize = read_value<uint32_t>(data + 8);
+	size_t headerSize;
+	switch(version) {
+	case 1:
+		headerSize = HEADER_SIZE_V1;
+		break;
+	case 2:
+		headerSize = HEADER_SIZE_V2;
+		break;
+	default:
+		return false;
+	}
+	if(headerSize + treeSize > size)
+		return false;
+	m_dataOffset = static_cast<uint32_t>(headerSize + treeSize);
+
+	// The directory tree is a sequence of null-terminated strings: extension, path and file name
+	auto *ptr = data + headerSize;
+	auto *end = data + headerSize + treeSize;
+	auto readString = [&ptr, end]() -> std::string_view {
+		auto *strEnd = static_cast<const uint8_t *>(memchr(ptr, '\0', end - ptr));
+		if(strEnd == nullptr) {
+			ptr = end;
+			return {};
+		}
+		std::string_view str {reinterpret_cast<const char *>(ptr), static_cast<size_t>(strEnd - ptr)};
+		ptr = strEnd + 1;
+		return str;
+	};
+	uint16_t maxArchiveIndex = 0;
+	auto hasChunks = false;
+	std::string filePath;
+	for(;;) {
+		auto ext = readString();
+		if(ext.empty())
+			break;
+		for(;;) {
+			auto dir = readString();
+			if(dir.empty())
+				break;
+			for(;;) {
+				auto name = readString();
+				if(name.empty())
+					break;
+				if(end - ptr < static_cast<std::ptrdiff_t>(ENTRY_SIZE))
+					return false;
+				Entry entry {};
+				entry.crc = read_value<uint32_t>(ptr);
+				entry.preloadBytes = read_value<uint16_t>(ptr + 4);
+				entry.archiveIndex = read_value<uint16_t>(ptr + 6);
+				entry.offset = read_value<uint32_t>(ptr + 8);
+				entry.length = read_value<uint32_t>(ptr + 12);
+				if(read_value<uint16_t>(ptr + 16) != ENTRY_TERMINATOR)
+					return false;
+				ptr += ENTRY_SIZE;
+				entry.preloadOffset = static_cast<uint32_t>(ptr - data);
+				if(end - ptr < entry.preloadBytes)
+					return false;
+				ptr += entry.preloadBytes;
+				if(entry.archiveIndex != DIRECTORY_ARCHIVE_INDEX) {
+					maxArchiveIndex = std::max(maxArchiveIndex, entry.archiveIndex);
+					hasChunks = true;
+				}
+
+				// A single space denotes the root directory or a missing extension
+				filePath.clear();
+				if(dir != " ") {
+					filePath += dir;
+					filePath += '/';
+				}
+				filePath += name;
+				if(ext != " ") {
+					filePath += '.';
+					filePath += ext;
+				}
+				ustring::to_lower(filePath);
+				m_pathToEntry.insert(std::make_pair(filePath, static_cast<uint32_t>(m_entries.size())));
+				m_entries.push_back(entry);
+			}
+		}
+	}
+
+	if(hasChunks) {
+		// Data chunks are stored next to the directory file as <name>_000.vpk, <name>_001.vpk, ...
+		constexpr std::string_view dirSuffix = "_dir.vpk";
+		if(path.length() < dirSuffix.length() || ustring::compare<std::string>(path.substr(path.length() - dirSuffix.length()), std::string {dirSuffix}, false) == false)
+			return false;
+		auto basePath = path.substr(0, path.length() - dirSuffix.length());
+		m_chunks.resize(maxArchiveIndex + 1);
+		std::array<char, 8> suffix;
+		for(auto i = decltype(m_chunks.size()) {0u}; i < m_chunks.size(); ++i) {
+			snprintf(suffix.data(), suffix.size(), "_%03u", static_cast<uint32_t>(i));
+			m_chunks[i] = MappedFile::Open(basePath + suffix.data() + ".vpk");
+		}
+	}
+	return true;
+}
+
+void pragma::gamemount::vpk::Archive::SetRootDirectory(const std::string &path)
+{
+	m_rootDir = path;
+	ustring::to_lower(m_rootDir);
+	std::replace(m_rootDir.begin(), m_rootDir.end(), '\\', '/');
+	while(m_rootDir.empty() == false && m_rootDir.back() == '/')
+		m_rootDir.pop_back();
+	if(m_rootDir.empty() == false)
+		m_rootDir += '/';
+}
+
+const pragma::gamemount::vpk::Archive::Entry *pragma::gamemount::vpk::Archive::FindEntry(std::string_view path) const
+{
+	decltype(m_pathToEntry)::const_iterator it;
+	if(m_rootDir.empty())
+		it = m_pathToEntry.find(path);
+	else
+		it = m_pathToEntry.find(m_rootDir + std::string {path});
+	return (it != m_pathToEntry.end()) ? &m_entries[it->second] : nullptr;
+}
+
+void pragma::gamemount::vpk::Archive::GetFiles(const std::function<void(std::string_view, const Entry &)> &callback) const
+{
+	for(auto &[path, entryIdx] : m_pathToEntry) {
+		std::string_view relPath {path};
+		if(m_rootDir.empty() == false) {
+			if(relPath.starts_with(m_rootDir) == false)
+				continue;
+			relPath = relPath.substr(m_rootDir.length());
+		}
+		callback(relPath, m_entries[entryIdx]);
+	}
+}
+
+std::span<const uint8_t> pragma::gamemount::vpk::Archive::GetPreloadData(const Entry &entry) const { return m_directory->GetView().subspan(entry.preloadOffset, entry.preloadBytes); }
+
+std::span<const uint8_t> pragma::gamemount::vpk::Archive::GetChunkData(const Entry &entry) const
+{
+	if(entry.length == 0)
+		return {};
+	const MappedFile *file = nullptr;
+	size_t offset = entry.offset;
+	if(entry.archiveIndex == DIRECTORY_ARCHIVE_INDEX) {
+		file = m_directory.get();
+		offset += m_dataOffset;
+	}
+	else if(entry.archiveIndex < m_chunks.size())
+		file = m_chunks[entry.archiveIndex].get();
+	if(file == nullptr || offset + entry.length > file->GetSize())
+		return {};
+	return file->GetView().subspan(offset, entry.length);
+}
+
+bool pragma::gamemount::vpk::Archive::GetView(const Entry &entry, std::span<const uint8_t> &outView) const
+{
+	if(entry.preloadBytes == 0) {
+		outView = GetChunkData(entry);
+		return outView.size() == entry.length;
+	}
+	if(entry.length == 0) {
+		outView = GetPreloadData(entry);
+		return true;
+	}
+	return false;
+}
+
+size_t pragma::gamemount::vpk::Archive::Read(const Entry &entry, void *dst, size_t offset, size_t len) const
+{
+	size_t size = entry.GetSize();
+	if(offset >= size)
+		return 0;
+	len = std::min(len, size - offset);
+	auto *pdst = static_cast<uint8_t *>(dst);
+	size_t numRead = 0;
+	// Preload data is stored in the directory and precedes the chunk data
+	if(offset < entry.preloadBytes) {
+		auto preload = GetPreloadData(entry).subspan(offset);
+		auto n = std::min(len, preload.size());
+		memcpy(pdst, preload.data(), n);
+		numRead += n;
+		offset = 0;
+	}
+	else
+		offset -= entry.preloadBytes;
+	if(numRead < len) {
+		auto chunk = GetChunkData(entry);
+		if(offset >= chunk.size())
+			return numRead;
+		auto n = std::min(len - numRead, chunk.size() - offset);
+		memcpy(pdst + numRead, chunk.data() + offset, n);
+		numRead += n;
+	}
+	return numRead;
+}
+
+bool pragma::gamemount::vpk::Archive::Read(const Entry &entry, std::vector<uint8_t> &data) const
+{
+	data.resize(entry.GetSize());
+	auto numRead = Read(entry, data.data(), 0, data.size());
+	if(numRead != data.size()) {
+		data.resize(numRead);
+		return false;
+	}
+	return true;
+}
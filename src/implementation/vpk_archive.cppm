@@ -0,0 +1,63 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <span>
+#include <functional>
+#include <unordered_map>
+#include <cinttypes>
+
+export module pragma.gamemount:vpkarchive;
+
+import :mappedfile;
+
+export namespace pragma::gamemount::vpk {
+	// Native reader for VPK v1 and v2 archives. The directory file and all data chunks are memory-mapped,
+	// so uncompressed entries can be accessed without copying and from any number of threads.
+	class Archive : public std::enable_shared_from_this<Archive> {
+	  public:
+		static constexpr uint16_t DIRECTORY_ARCHIVE_INDEX = 0x7fff;
+		struct Entry {
+			uint32_t crc = 0;
+			uint16_t preloadBytes = 0;
+			uint16_t archiveIndex = 0;
+			uint32_t offset = 0;
+			uint32_t length = 0;
+			// Offset of the preload data within the directory file
+			uint32_t preloadOffset = 0;
+			uint32_t GetSize() const { return preloadBytes + length; }
+		};
+		static std::shared_ptr<Archive> Create(const std::string &path);
+		void SetRootDirectory(const std::string &path);
+
+		// Path has to be normalized (lower-case with forward slashes) and relative to the root directory
+		const Entry *FindEntry(std::string_view path) const;
+		// Returns the entry data without copying, which is only possible if the entry is stored in one piece
+		bool GetView(const Entry &entry, std::span<const uint8_t> &outView) const;
+		bool Read(const Entry &entry, std::vector<uint8_t> &data) const;
+		size_t Read(const Entry &entry, void *dst, size_t offset, size_t len) const;
+		void GetFiles(const std::function<void(std::string_view, const Entry &)> &callback) const;
+		const std::vector<Entry> &GetEntries() const { return m_entries; }
+	  private:
+		Archive() = default;
+		bool Load(const std::string &path);
+		std::span<const uint8_t> GetPreloadData(const Entry &entry) const;
+		std::span<const uint8_t> GetChunkData(const Entry &entry) const;
+		struct StringHash {
+			using is_transparent = void;
+			size_t operator()(std::string_view str) const { return std::hash<std::string_view> {}(str); }
+		};
+		std::unique_ptr<MappedFile> m_directory;
+		std::vector<std::unique_ptr<MappedFile>> m_chunks;
+		uint32_t m_dataOffset = 0;
+		std::vector<Entry> m_entries;
+		std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> m_pathToEntry;
+		std::string m_rootDir;
+	};
+};
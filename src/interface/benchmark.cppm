@@ -0,0 +1,41 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cinttypes>
+#include "definitions.hpp"
+
+export module pragma.gamemount:benchmark;
+
+// The component benchmarks measure internals of the library that aren't reachable through the public API, so they are
+// compiled into the library if the benchmark suite is enabled
+#ifdef UTIL_ARCHIVE_BENCHMARK
+export namespace pragma::gamemount::benchmark {
+	struct ComponentMetric {
+		std::string name;
+		double value = 0.0;
+		std::string unit;
+	};
+	struct ComponentResult {
+		std::string name;
+		std::vector<ComponentMetric> metrics;
+		// Parts of the benchmark that were skipped, e.g. because a library wasn't available
+		std::vector<std::string> notes;
+		uint64_t verificationErrors = 0;
+	};
+	DLLARCHLIB std::vector<std::string> get_component_benchmarks();
+	// The archives of the benchmark are generated in workDir. Returns an empty optional if there is no component with
+	// the specified name, or if the benchmark could not be set up.
+	DLLARCHLIB std::optional<ComponentResult> run_component_benchmark(const std::string &name, const std::string &workDir);
+};
+
+namespace pragma::gamemount::benchmark {
+	// Index path of a Source Engine game as it was built by GameMountManager before NormalizedPath
+	std::string get_legacy_index_path(const std::string &path);
+};
+#endif
@@ -0,0 +1,117 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+module;
+
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <span>
+#include <limits>
+#include <cstddef>
+#include <cinttypes>
+#include "definitions.hpp"
+
+export module pragma.gamemount:bufferpool;
+
+export namespace pragma::gamemount {
+	class BufferPool;
+	// Block of memory from a buffer pool. The contents are not zero-initialized. The block is handed back to the
+	// pool once the buffer is destroyed, so it can be reused by later loads.
+	class DLLARCHLIB PooledBuffer {
+	  public:
+		PooledBuffer(std::shared_ptr<BufferPool> pool, uint8_t *data, size_t size, uint32_t sizeClass);
+		PooledBuffer(const PooledBuffer &) = delete;
+		PooledBuffer &operator=(const PooledBuffer &) = delete;
+		~PooledBuffer();
+		uint8_t *GetData() { return m_data; }
+		const uint8_t *GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+		std::span<uint8_t> GetSpan() { return {m_data, m_size}; }
+		std::span<const uint8_t> GetSpan() const { return {m_data, m_size}; }
+	  private:
+		std::shared_ptr<BufferPool> m_pool;
+		uint8_t *m_data = nullptr;
+		size_t m_size = 0;
+		uint32_t m_sizeClass = 0;
+	};
+
+	struct BufferPoolStats {
+		// Blocks or slabs that had to be allocated because the free list of the size class was empty
+		uint64_t allocations = 0;
+		// Buffers served from the free lists
+		uint64_t reuses = 0;
+		// Buffers larger than the largest size class. These are allocated individually and never pooled.
+		uint64_t oversizeAllocations = 0;
+		// Released blocks that were freed because the pool was full
+		uint64_t discards = 0;
+		size_t liveCount = 0;
+		// Bytes of the blocks handed out, which includes the rounding up to the size class
+		size_t liveSize = 0;
+		size_t idleCount = 0;
+		size_t idleSize = 0;
+		size_t capacity = 0;
+		// Bytes reserved by slabs for the small size classes
+		size_t slabSize = 0;
+	};
+
+	// Allocator for load buffers. Sizes are rounded up to a size class (four classes per power of two, so at most
+	// 25% is wasted), and released blocks are kept in a free list per size class. Blocks of the small size classes
+	// are carved from larger slabs, which are freed by Flush once all of their blocks have been released. Larger
+	// blocks are allocated individually and freed once the released blocks exceed the capacity of the pool.
+	class BufferPool : public std::enable_shared_from_this<BufferPool> {
+	  public:
+		static constexpr size_t MIN_BLOCK_SIZE = 256;
+		static constexpr size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+		// Blocks up to this size are carved from slabs
+		static constexpr size_t MAX_SLAB_BLOCK_SIZE = 4 * 1024;
+		static constexpr size_t SLAB_SIZE = 64 * 1024;
+		static constexpr uint32_t CLASSES_PER_DOUBLING = 4;
+		static constexpr uint32_t SIZE_CLASS_COUNT = 16 * CLASSES_PER_DOUBLING + 1; // MIN_BLOCK_SIZE << 16 == MAX_BLOCK_SIZE
+		static constexpr uint32_t OVERSIZE_CLASS = std::numeric_limits<uint32_t>::max();
+		static constexpr size_t DEFAULT_CAPACITY = 64 * 1024 * 1024;
+
+		static uint32_t GetSizeClass(size_t size);
+		static size_t GetBlockSize(uint32_t sizeClass);
+
+		~BufferPool();
+		std::shared_ptr<PooledBuffer> Acquire(size_t size);
+		// Called by PooledBuffer
+		void Release(uint8_t *data, size_t size, uint32_t sizeClass);
+
+		// Maximum number of bytes kept in the free lists of the individually allocated size classes.
+		// Lowering it below the idle bytes flushes the pool.
+		void SetCapacity(size_t capacity);
+		size_t GetCapacity() const { return m_capacity; }
+		// Frees all released blocks that don't belong to a slab, and all slabs whose blocks have all been released
+		void Flush();
+		BufferPoolStats GetStats() const;
+	  private:
+		struct SizeClass {
+			std::vector<uint8_t *> freeBlocks;
+			// Only used by the slab size classes
+			std::vector<std::unique_ptr<uint8_t[]>> slabs;
+			std::mutex mutex;
+		};
+		// Have to be called with the lock of the size class held
+		uint8_t *Allocate(uint32_t sizeClass);
+		void FreeIdleSlabs(uint32_t sizeClass);
+		std::array<SizeClass, SIZE_CLASS_COUNT> m_sizeClasses;
+
+		std::atomic<size_t> m_capacity = DEFAULT_CAPACITY;
+		std::atomic<uint64_t> m_allocations = 0;
+		std::atomic<uint64_t> m_reuses = 0;
+		std::atomic<uint64_t> m_oversizeAllocations = 0;
+		std::atomic<uint64_t> m_discards = 0;
+		std::atomic<size_t> m_liveCount = 0;
+		std::atomic<size_t> m_liveSize = 0;
+		std::atomic<size_t> m_idleCount = 0;
+		std::atomic<size_t> m_idleSize = 0;
+		// Idle bytes of the individually allocated size classes, which are limited by the capacity
+		std::atomic<size_t> m_idleHeapSize = 0;
+		std::atomic<size_t> m_slabSize = 0;
+	};
+};
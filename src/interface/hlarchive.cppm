@@ -9,10 +9,14 @@ module;
 #include <cinttypes>
 #include <vector>
 #include <limits>
+#include <cstddef>
+#include <mutex>
 
 export module pragma.gamemount:archive;
 
 export namespace pragma::gamemount::hl {
+	// Archives and streams can be used from multiple threads. Streams of the same archive are serialized,
+	// streams of different archives are read concurrently.
 	class Archive : public std::enable_shared_from_this<Archive> {
 	  public:
 		class Stream {
@@ -20,6 +24,8 @@ export namespace pragma::gamemount::hl {
 			Stream(Archive &archive, void *item, void *stream);
 			~Stream();
 			bool Read(std::vector<uint8_t> &data) const;
+			// Reads up to len bytes starting at offset into dst and returns the number of bytes read
+			std::size_t Read(void *dst, std::size_t offset, std::size_t len) const;
 			uint32_t GetSize() const;
 		  private:
 			void *m_stream = nullptr;
@@ -47,6 +53,8 @@ export namespace pragma::gamemount::hl {
 		void SetRootDirectory(const std::string &path);
 	  private:
 		uint32_t m_uiPackage = std::numeric_limits<uint32_t>::max();
+		std::mutex m_mutex;
+		void *m_packageRoot = nullptr;
 		void *m_rootDir = nullptr;
 		bool Bind();
 	};
@@ -6,8 +6,12 @@ module;
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
+#include <functional>
+#include <future>
+#include <limits>
 #include <unordered_set>
 #include <fsys/filesystem.h>
 #include <sharedutils/util_log.hpp>
@@ -18,10 +22,98 @@ export module pragma.gamemount;
 
 export import :info;
 export import :archive;
+export import :bufferpool;
+export import :benchmark;
 
 export namespace pragma::gamemount {
 	DLLARCHLIB VFilePtr load(const std::string &path, std::optional<std::string> *optOutSourcePath = nullptr, const std::optional<std::string> &game = {});
+	// Same as load, but compressed BSA and BA2 entries are decompressed incrementally as they are read, instead of
+	// in full when the file is opened. Only the state of the decompressor is kept in memory, so the data can be
+	// read in chunks of any size without holding the entire file. Reading sequentially is cheap, seeking backwards
+	// restarts decompression. BA2 texture entries are still extracted in full.
+	DLLARCHLIB VFilePtr load_streamed(const std::string &path, std::optional<std::string> *optOutSourcePath = nullptr, const std::optional<std::string> &game = {});
 	DLLARCHLIB bool load(const std::string &path, std::vector<uint8_t> &data);
+	// Same as load, but the returned buffer may be shared with the entry cache and must not be modified
+	DLLARCHLIB std::shared_ptr<const std::vector<uint8_t>> load_shared(const std::string &path);
+	// Loads multiple files at once. The reads are grouped by archive and issued in the order the data is stored in.
+	// The result for each path is nullptr if the file could not be found.
+	DLLARCHLIB std::vector<std::shared_ptr<const std::vector<uint8_t>>> load_batch(const std::vector<std::string> &paths);
+	// Same as load, but the data is read into a buffer from the buffer pool, which is not zero-initialized first.
+	// The buffer belongs to the caller. Its memory is recycled for later loads once it has been released.
+	DLLARCHLIB std::shared_ptr<PooledBuffer> load_pooled(const std::string &path);
+	// Maximum number of bytes of released buffers kept for reuse (64 MiB by default). Buffers of up to 4 KiB are
+	// carved from slabs, which are always kept.
+	DLLARCHLIB void set_buffer_pool_capacity(size_t capacity);
+	DLLARCHLIB size_t get_buffer_pool_capacity();
+	// Frees the released buffers that are not part of a slab, and the slabs whose buffers have all been released
+	DLLARCHLIB void flush_buffer_pool();
+	DLLARCHLIB BufferPoolStats get_buffer_pool_stats();
+
+	enum class AsyncLoadStatus : uint8_t {
+		Complete = 0,
+		NotFound,
+		Cancelled,
+		Failed, // Reading the file raised an error
+	};
+	struct AsyncLoadResult {
+		AsyncLoadStatus status = AsyncLoadStatus::NotFound;
+		std::shared_ptr<const std::vector<uint8_t>> data = nullptr;
+	};
+	using AsyncLoadId = uint64_t;
+	using AsyncLoadCallback = std::function<void(const std::string &path, const AsyncLoadResult &result)>;
+	struct AsyncLoadRequest {
+		AsyncLoadId id = 0;
+		std::shared_future<AsyncLoadResult> result;
+	};
+	// Loads the file on an I/O worker thread. Requests with a higher priority are processed first.
+	// The calling thread never blocks, not even if the games are still being mounted.
+	// The callback is optional and is invoked by poll_async_loads on the thread calling it.
+	DLLARCHLIB AsyncLoadRequest load_async(const std::string &path, int32_t priority = 0, const AsyncLoadCallback &callback = nullptr);
+	// Returns false if the request has already been started
+	DLLARCHLIB bool cancel_async_load(AsyncLoadId id);
+	// Runs the callbacks of completed asynchronous loads and returns how many were run
+	DLLARCHLIB uint32_t poll_async_loads(uint32_t maxCount = std::numeric_limits<uint32_t>::max());
+	// Number of I/O worker threads for asynchronous loads. 0 picks a default based on the hardware.
+	// Has to be called before the first asynchronous load.
+	DLLARCHLIB void set_io_worker_count(uint32_t count);
+
+	// Games are mounted in the background in the order of their priority. Lookups are served while mounting is
+	// still in progress and only block if a game that has not been mounted yet could provide the file.
+	enum class GameMountState : uint8_t {
+		Pending = 0,
+		Mounting,
+		Ready,
+		Failed,
+		Unmounted,
+	};
+	// Returns an empty optional if no game with that identifier has been registered
+	DLLARCHLIB std::optional<GameMountState> get_game_mount_state(const std::string &game);
+	// Progress is in the range [0,1]. The callback is invoked on the mount threads.
+	using MountProgressCallback = std::function<void(const std::string &game, GameMountState state, float progress)>;
+	DLLARCHLIB void set_mount_progress_callback(const MountProgressCallback &callback);
+
+	DLLARCHLIB bool exists(const std::string &path, const std::optional<std::string> &game = {});
+	struct FileStat {
+		// Size of the file contents
+		uint64_t size = 0;
+		// Number of bytes the file occupies within its archive or on disk
+		uint64_t storedSize = 0;
+		bool compressed = false;
+		// False for files on disk
+		bool archived = false;
+	};
+	// Size and compression of a file, without reading its contents. Entries of BA2 texture archives are the
+	// exception and have to be extracted. Returns an empty optional if the file could not be found.
+	DLLARCHLIB std::optional<FileStat> stat_file(const std::string &path, const std::optional<std::string> &game = {});
+	// Reads up to len bytes starting at offset into dst and returns the number of bytes read, or an empty optional
+	// if the file could not be found. Only the range is read, compressed entries are decompressed up to the end
+	// of the range. BA2 texture entries are extracted in full.
+	DLLARCHLIB std::optional<size_t> read_range(const std::string &path, size_t offset, void *dst, size_t len, const std::optional<std::string> &game = {});
+	// Supports '*' and '?' wildcards in every path component, as well as "**" for any number of directories.
+	// Found paths are relative to the first directory containing a wildcard. Each path is only reported once,
+	// even if several archives or games provide it.
+	using FindFilesCallback = std::function<void(std::string_view path, bool isDirectory)>;
+	DLLARCHLIB bool find_files(const std::string &path, const FindFilesCallback &callback, bool keepAbsPaths = false, const std::optional<std::string> &game = {});
 	DLLARCHLIB bool find_files(const std::string &path, std::vector<std::string> *files, std::vector<std::string> *dirs, bool keepAbsPaths = false, const std::optional<std::string> &game = {});
 	DLLARCHLIB bool get_mounted_game_paths(const std::string &game, std::vector<std::string> &outPaths);
 	DLLARCHLIB std::optional<int32_t> get_mounted_game_priority(const std::string &game);
@@ -31,9 +123,57 @@ export namespace pragma::gamemount {
 	DLLARCHLIB void close();
 
 	struct GameMountInfo;
+	// Games can be mounted and unmounted at any time. Games mounted after initialization are mounted in the
+	// background, only the new game is indexed. Returns false if a game with the same identifier is already mounted.
 	DLLARCHLIB bool mount_game(const GameMountInfo &mountInfo);
-	DLLARCHLIB const std::vector<GameMountInfo> &get_game_mount_infos();
-	DLLARCHLIB const std::unordered_map<std::string, util::Path> &get_mounted_vpk_archives();
+	// Removes the game from the lookups. Loads that are in progress are not affected. VPK archives that other games have
+	// skipped because this game provided an archive with the same name are mounted into those games in the background.
+	DLLARCHLIB bool unmount_game(const std::string &game);
+	// Mounts an additional archive, or all archives in a directory (e.g. a workshop addon that has just been downloaded),
+	// into a game that has already been mounted. Only the new archives are indexed, lookups keep using the previous state
+	// of the game until they are ready. The archives are not added to the mount info, so they have to be mounted again
+	// if the game is remounted. Blocks until the archives have been mounted. Returns false if the game isn't mounted or
+	// no archive could be mounted.
+	DLLARCHLIB bool mount_game_archive(const std::string &game, const std::string &path);
+	// Games can be mounted and unmounted at any time, so these return a copy instead of a reference to the current state
+	DLLARCHLIB std::vector<GameMountInfo> get_game_mount_infos();
+	DLLARCHLIB std::unordered_map<std::string, util::Path> get_mounted_vpk_archives();
 	DLLARCHLIB void initialize();
 	DLLARCHLIB void set_steam_root_paths(const std::vector<util::Path> &paths);
+	// Number of threads used to open and index archives while mounting. 0 uses one thread per hardware thread.
+	// Has to be called before initialization.
+	DLLARCHLIB void set_mount_worker_count(uint32_t count);
+	// If enabled, archives are only located when a game is mounted. They are opened and indexed the first time a
+	// lookup reaches the game. Lookups of existing files stop at the first game that contains them, but a missing
+	// file has to be checked against every game, so the first miss indexes all games that haven't been indexed yet.
+	// With the index cache enabled, a summary of each archive is cached as well. Games whose archives all have a
+	// summary are only indexed once a lookup or a find_files pattern may match their archives, at the cost of
+	// probing their mounted paths on disk until then.
+	// Disabled by default. Has to be called before the games are mounted.
+	DLLARCHLIB void set_lazy_archive_indexing(bool lazy);
+	// Directory for cached archive file tables. Archives whose cache is up to date are not parsed on startup and
+	// only opened once a file is loaded from them. An empty path (default) disables the cache.
+	// Has to be called before initialization.
+	DLLARCHLIB void set_index_cache_path(const std::string &path);
+	DLLARCHLIB std::string get_index_cache_path();
+
+	// Missing files are rejected early by a filter built from the files of each mounted game. This has to be
+	// called if files have been added to the directories of a mounted game after it was mounted. Until then,
+	// load, load_streamed, exists, stat and read_range report those files as missing without probing the disk.
+	// Files that have been removed are detected regardless, since hits are always verified.
+	DLLARCHLIB void invalidate_lookup_filter(const std::optional<std::string> &game = {});
+
+	struct CacheStats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		size_t size = 0;
+		size_t capacity = 0;
+		size_t entryCount = 0;
+	};
+	// Maximum number of bytes used to cache loaded archive entries. The cache is disabled by default (size 0).
+	DLLARCHLIB void set_cache_size(size_t size);
+	DLLARCHLIB size_t get_cache_size();
+	DLLARCHLIB void flush_cache();
+	DLLARCHLIB CacheStats get_cache_stats();
 };